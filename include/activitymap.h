@@ -0,0 +1,195 @@
+/*! \file activitymap.h
+ *
+ * Widget showing the activity on every electrode of the array as a heatmap.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_ACTIVITY_MAP_H_
+#define _MEAVIEW_ACTIVITY_MAP_H_
+
+#include "settings.h"
+#include "channelstats.h"
+#include "displayconfig.h"
+
+#include <QWidget>
+#include <QSettings>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+
+namespace meaview {
+
+/*! \namespace activitymap
+ *
+ * The activitymap namespace contains the ActivityMap class, an alternative
+ * to the grid of traces showing only the activity on each electrode.
+ */
+namespace activitymap {
+
+/*! Measures by which the cells of an activity map may be colored. */
+enum class Measure {
+	Rms,        //!< Root mean square deviation of the samples from their mean.
+	SpikeRate   //!< Rate of detected spikes, in spikes per second.
+};
+
+/*! Return the measure with the given name, from MeasureNames, or the
+ * default measure if the name is unknown.
+ */
+Measure measureFromName(const QString& name);
+
+/*! \class ActivityMap
+ *
+ * The ActivityMap class draws one colored cell per electrode, placed
+ * where the electrode is on the array, and colored by the recent activity
+ * on its channel.
+ *
+ * Electrodes of a HiDens array are placed at their positions in the
+ * configuration, "data/hidens-configuration", if there is one, and
+ * otherwise in a square grid in channel order. Electrodes of an MCS array
+ * are placed as in the current channel view. Channels which are not
+ * electrodes, such as the photodiode, have no cell.
+ *
+ * The map is fed with the activity measured in the transfer threads, so
+ * it never touches the samples. The activity on each channel is averaged
+ * exponentially over `TimeConstant` seconds of data, and the map is
+ * repainted at most at the display frame rate, and only when visible. The
+ * color scale runs from no activity to the largest activity on any
+ * channel, decaying slowly when the activity falls.
+ */
+class ActivityMap : public QWidget {
+	Q_OBJECT
+
+	public:
+		/*! Construct an ActivityMap. */
+		ActivityMap(QWidget* parent = nullptr);
+
+		/*! Destroy an ActivityMap. */
+		~ActivityMap();
+
+		/*! Set up the map for an array with the given number of channels.
+		 *
+		 * \param array The type of array from which data is recorded.
+		 * \param nchannels The number of channels in the data.
+		 */
+		void setupMap(const QString& array, int nchannels);
+
+		/*! Return the measure by which cells are colored. */
+		inline Measure measure() const { return currentMeasure; }
+
+		/*! Set the measure by which cells are colored. */
+		void setMeasure(Measure measure);
+
+		/*! Set the rate at which the map is repainted, in frames per second. */
+		void setFrameRate(double rate);
+
+		/*! Return the current value of the measure on a channel, in the
+		 * units of the display, or 0 if the channel is unknown.
+		 */
+		double value(int channel) const;
+
+	public slots:
+
+		/*! Add the activity on a range of channels during one chunk of data. */
+		void handleActivity(const channelstats::ActivityList& activity);
+
+		/*! Place the cells again, e.g., after the channel view changes. */
+		void updateLayout();
+
+		/*! Remove all cells and activity. */
+		void clear();
+
+	protected:
+
+		/*! Paint the cells and the color scale. */
+		void paintEvent(QPaintEvent* event) override;
+
+		/*! Place the cells in the new size of the widget. */
+		void resizeEvent(QResizeEvent* event) override;
+
+		/*! Start repainting at the frame rate. */
+		void showEvent(QShowEvent* event) override;
+
+		/*! Stop repainting while the map cannot be seen. */
+		void hideEvent(QHideEvent* event) override;
+
+		/*! Show the channel and activity of the cell under the mouse. */
+		bool event(QEvent* event) override;
+
+	private slots:
+
+		/*! Repaint the map if any activity has arrived since the last frame. */
+		void handleFrameTick();
+
+	private:
+
+		/*! Compute the position of each channel's electrode, in units of
+		 * the distance between neighboring electrodes.
+		 */
+		void computePositions();
+
+		/*! Compute the rectangle of each channel's cell in the widget. */
+		void computeCells();
+
+		/*! Return the channel whose cell contains a point, or -1 if none does. */
+		int channelAt(const QPointF& point) const;
+
+		/*! Return the color of a fraction of the color scale. */
+		static QColor colorAt(double fraction);
+
+		/*! Format a value of the current measure, with its units. */
+		QString formatValue(double value) const;
+
+		/*! Type of array from which data is recorded. */
+		QString array;
+
+		/*! Number of channels. */
+		int nchannels = 0;
+
+		/*! Position of each channel's electrode. */
+		QVector<QPointF> positions;
+
+		/*! True for each channel which is an electrode, and so has a cell. */
+		QVector<bool> hasCell;
+
+		/*! Rectangle of each channel's cell in the widget. */
+		QVector<QRectF> cells;
+
+		/*! Average variance of each channel's raw samples. */
+		QVector<double> meanSquare;
+
+		/*! Average rate of spikes on each channel. */
+		QVector<double> spikeRate;
+
+		/*! Measure by which cells are colored. */
+		Measure currentMeasure;
+
+		/*! Factor converting the root of a raw variance to the units
+		 * of the display, as of the last activity received.
+		 */
+		double rmsScale = 1.0;
+
+		/*! Top of the color scale, in units of the display. */
+		double scaleTop = 0.0;
+
+		/*! True if activity has arrived since the map was last repainted. */
+		bool dirty = false;
+
+		/*! Timer ticking at the frame rate. */
+		QTimer* frameTimer;
+
+		/*! Snapshot of the display settings. */
+		displayconfig::Reader config;
+
+		/*! Global settings. */
+		QSettings settings;
+
+}; // end ActivityMap class
+
+}; // end activitymap namespace
+}; // end meaview namespace
+
+#endif
+
@@ -0,0 +1,165 @@
+/*! \file bandpass.h
+ *
+ * Streaming bandpass filter applied to every channel of each frame of data.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_BANDPASS_H_
+#define _MEAVIEW_BANDPASS_H_
+
+#include "sampleframe.h"
+
+#include "data-frame.h" // for DataFrame::DataType type alias
+
+#include <QVector>
+
+namespace meaview {
+
+/*! \namespace bandpass
+ *
+ * The bandpass namespace contains the FilterBank class, which removes
+ * the slow drift and high-frequency noise from the raw samples of every
+ * channel before they are plotted.
+ */
+namespace bandpass {
+
+/*! \struct Biquad
+ *
+ * The coefficients of one second-order section of a filter, normalized
+ * so that the leading coefficient of the denominator is 1.
+ */
+struct Biquad {
+	float b0, b1, b2;   //!< Coefficients of the numerator.
+	float a1, a2;       //!< Coefficients of the denominator.
+}; // end Biquad struct
+
+/*! Design a Butterworth bandpass filter, as a cascade of second-order
+ * sections: a highpass of the given order at the low cutoff, followed by
+ * a lowpass of the same order at the high cutoff.
+ *
+ * \param sampleRate The sample rate of the data.
+ * \param low The low cutoff frequency, in Hz.
+ * \param high The high cutoff frequency, in Hz.
+ * \param order The order of each of the highpass and lowpass, which
+ * 	must be even.
+ *
+ * The cutoffs are clamped to `MinLowCutoff` and `MaxCutoffFraction` of
+ * the sample rate, and the high cutoff is kept above the low one.
+ */
+QVector<Biquad> design(double sampleRate, double low, double high, int order);
+
+/*! \class FilterBank
+ *
+ * The FilterBank class filters every channel of successive frames of data
+ * with the same cascade of biquads, keeping the state of each channel's
+ * filter from one frame to the next, so that a stream of frames is
+ * filtered as though it were one.
+ *
+ * The state is stored as a structure of arrays, with one array of each
+ * state variable of each section, indexed by channel. Frames are filtered
+ * in tiles of `ChannelsPerTile` channels and `SamplesPerTile` samples:
+ * each tile is gathered into a small buffer with the samples of each time
+ * point consecutive, filtered one vector of channels at a time, and then
+ * written out with the samples of each channel consecutive. The filter
+ * itself thus never waits on the previous output of a channel, whichever
+ * layout the frame has, and the whole tile fits in the L1 cache.
+ *
+ * The state is primed from the first frame filtered after a reset, as
+ * though each channel had been at its first sample forever, so that the
+ * raw offset of the samples doesn't ring through the filter.
+ *
+ * Some channels, such as the photodiode, are not electrodes and are
+ * passed through unfiltered.
+ */
+class FilterBank {
+
+	public:
+		/*! Construct an unconfigured FilterBank, which passes frames through. */
+		FilterBank();
+
+		/*! Set the sample rate and cutoffs of the filter.
+		 *
+		 * Nothing changes if these are the same as the current ones.
+		 * Otherwise the filter is designed again and reset.
+		 */
+		void configure(double sampleRate, double low, double high);
+
+		/*! Return true if the filter has been configured. */
+		inline bool isConfigured() const { return !m_sections.isEmpty(); }
+
+		/*! Return the sections of the filter. */
+		inline const QVector<Biquad>& sections() const { return m_sections; }
+
+		/*! Set the channels which are passed through unfiltered. */
+		void setPassthrough(const QVector<int>& channels);
+
+		/*! Forget the state of every channel, which is primed again
+		 * from the next frame filtered.
+		 */
+		void reset();
+
+		/*! Filter a frame of data.
+		 *
+		 * \param frame The next frame in the stream.
+		 * \return A frame, with each channel contiguous, holding the filtered
+		 * 	samples, or `frame` itself if the filter is not configured.
+		 */
+		sampleframe::SampleFrame filter(const sampleframe::SampleFrame& frame);
+
+	private:
+
+		/* Allocate the state for the given number of channels. */
+		void allocate(int nchannels);
+
+		/* Set each channel's state to the steady state for its first sample. */
+		void prime(const sampleframe::SampleFrame& frame);
+
+		/* Filter a tile of samples in place.
+		 *
+		 * The tile holds `nsamples` rows of `width` consecutive channels,
+		 * starting from channel `first`. `width` is a multiple of the
+		 * vector size.
+		 */
+		void filterTile(float* tile, int nsamples, int width, int first);
+
+		/* Sections of the filter. */
+		QVector<Biquad> m_sections;
+
+		/* Sample rate and cutoffs for which the filter was designed. */
+		double m_sampleRate = 0.0;
+		double m_low = 0.0;
+		double m_high = 0.0;
+
+		/* Number of channels whose state is allocated. */
+		int m_nchannels = 0;
+
+		/* Length of each array of state, rounded up to a whole number of
+		 * vectors. The extra channels are always zero.
+		 */
+		int m_stride = 0;
+
+		/* State of each channel, as two arrays per section, each of
+		 * `m_stride` values.
+		 */
+		QVector<float> m_state;
+
+		/* True if the state has been primed since the last reset. */
+		bool m_primed = false;
+
+		/* Channels passed through unfiltered. */
+		QVector<int> m_passthroughChannels;
+
+		/* True for each channel passed through unfiltered. */
+		QVector<bool> m_passthrough;
+
+		/* Buffer for one tile of samples. */
+		QVector<float> m_tile;
+
+}; // end FilterBank class
+
+}; // end bandpass namespace
+}; // end meaview namespace
+
+#endif
+
@@ -11,12 +11,16 @@
 
 #include "settings.h"
 #include "qcustomplot.h"
+#include "tracegraph.h"
+#include "lodpyramid.h"
+#include "displayconfig.h"
 
 #include <QGridLayout>
 #include <QWidget>
 #include <QSettings>
 #include <QCloseEvent>
 #include <QRect>
+#include <QSharedPointer>
 
 namespace meaview {
 namespace channelinspector {
@@ -28,6 +32,12 @@ namespace channelinspector {
  * data from that channel. This is useful for data from an intracellular
  * electrode, where the values of the data may vary widely over time,
  * and yet small fluctuations may be relevant.
+ *
+ * The inspector draws from the channel's multi-resolution history, so
+ * that users can drag and zoom along the time axis, from the full extent
+ * of the history down to individual samples. By default, the inspector
+ * follows the most recent data. Dragging or zooming stops following, and
+ * double-clicking resumes it.
  */
 class ChannelInspector : public QWidget {
 	Q_OBJECT
@@ -37,11 +47,13 @@ class ChannelInspector : public QWidget {
 		 *
 		 * \param parentPlot The main QCustomPlot object from which data will be copied.
 		 * \param sourceGraph The line graph from which data will be copied.
+		 * \param history The multi-resolution history of the channel.
 		 * \param channel The channel number for this inspector.
 		 * \param label The label for this channel. Often but not always the channel number.
 		 * \param parent Parent widget.
 		 */
-		ChannelInspector(QCustomPlot* parentPlot, QCPGraph* sourceGraph,
+		ChannelInspector(QCustomPlot* parentPlot, tracegraph::TraceGraph* sourceGraph,
+				QSharedPointer<lodpyramid::LodPyramid> history,
 				int channel, const QString& label, QWidget* parent = 0);
 		
 		/*! Destroy an inspector. */
@@ -71,12 +83,27 @@ class ChannelInspector : public QWidget {
 
 	public slots:
 
-		/*! Replot this inspector, drawing its data from the source graph.
+		/*! Replot this inspector.
 		 *
-		 * The ChannelInspector simply copies the data from the source graph.
+		 * If following the most recent data, this moves the time axis
+		 * to the end of the channel's history. Until the history has any
+		 * data, the ChannelInspector simply copies the data from the
+		 * source graph.
 		 */
 		void replot();
 
+		/*! Resume following the most recent data. */
+		void follow();
+
+	private slots:
+
+		/*! Load the portion of the history visible on the time axis,
+		 * at a resolution matching the width of the plot. Nothing is read
+		 * if the range, width, gain and length of the history are the same
+		 * as when it was last loaded.
+		 */
+		void loadHistory();
+
 	private:
 
 		/* Handler function for a close event, which causes emission of the 
@@ -95,10 +122,24 @@ class ChannelInspector : public QWidget {
 		QCPAxisRect* m_rect;
 
 		/*! This plot's graph, which manages the data. */
-		QCPGraph* m_graph;
+		tracegraph::TraceGraph* m_graph;
 
 		/*! This plot's source graph, from which the data is copied. */
-		QCPGraph* m_sourceGraph;
+		tracegraph::TraceGraph* m_sourceGraph;
+
+		/*! Multi-resolution history of the inspected channel. */
+		QSharedPointer<lodpyramid::LodPyramid> m_history;
+
+		/*! True if the time axis follows the most recent data. */
+		bool m_following = true;
+
+		/*! Time range, width, gain and length of the history when it was
+		 * last loaded, so that each frame queries the history only once.
+		 */
+		QCPRange m_loadedRange;
+		int m_loadedWidth = 0;
+		double m_loadedGain = 0.0;
+		qint64 m_loadedCount = -1;
 
 		/*! The channel number associated with this inspector. */
 		int m_channel;
@@ -106,6 +147,9 @@ class ChannelInspector : public QWidget {
 		/*! Global settings */
 		QSettings m_settings;
 
+		/*! Snapshot of the settings read on each replot. */
+		displayconfig::Reader m_config;
+
 		/*! Vector of ticks, upper/lower range and 0 */
 		QVector<double> m_ticks;
 
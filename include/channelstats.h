@@ -0,0 +1,114 @@
+/*! \file channelstats.h
+ *
+ * Statistics of the samples of a single channel, and the activity of each
+ * channel reported to views of the whole array.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_CHANNEL_STATS_H_
+#define _MEAVIEW_CHANNEL_STATS_H_
+
+#include "samplekernels.h"
+
+#include <QMetaType>
+#include <QVector>
+#include <QtGlobal>
+
+namespace meaview {
+
+/*! \namespace channelstats
+ *
+ * The channelstats namespace contains the SummaryStats class, which
+ * computes the statistics of a run of a channel's samples from their
+ * summary, and the Activity of each channel reported to views of the
+ * whole array.
+ */
+namespace channelstats {
+
+/*! \class SummaryStats
+ *
+ * The SummaryStats class holds the count, mean, variance and extrema of
+ * a run of raw samples, such as a block or a single chunk of data.
+ *
+ * The statistics are computed from the exact sums accumulated by the
+ * sample kernels as the data is transferred, so that the samples are
+ * never scanned again. The sum of squared deviations is computed from
+ * these sums in integer arithmetic, so that it doesn't cancel when the
+ * samples sit far from zero.
+ *
+ * All values are in raw units, and are converted to physical units by
+ * multiplying by the channel's gain, as for the samples themselves.
+ */
+class SummaryStats {
+
+	public:
+		/*! Return the statistics of the samples in a single summary. */
+		static SummaryStats fromSummary(const samplekernels::Summary& summary);
+
+		/*! Return the number of samples. */
+		inline qint64 count() const { return m_count; }
+
+		/*! Return the mean of the samples, or 0 if there are none. */
+		inline double mean() const { return m_mean; }
+
+		/*! Return the population variance of the samples, or 0 if there are none. */
+		double variance() const;
+
+		/*! Return the smallest sample, or 0 if there are none. */
+		inline double min() const { return m_count ? m_min : 0.0; }
+
+		/*! Return the largest sample, or 0 if there are none. */
+		inline double max() const { return m_count ? m_max : 0.0; }
+
+	private:
+
+		/* Number of samples. */
+		qint64 m_count = 0;
+
+		/* Mean of the samples. */
+		double m_mean = 0.0;
+
+		/* Sum of squared deviations of the samples from their mean. */
+		double m_m2 = 0.0;
+
+		/* Extrema of the samples. */
+		double m_min = 0.0;
+		double m_max = 0.0;
+
+}; // end SummaryStats class
+
+/*! \struct Activity
+ *
+ * A summary of the activity on one channel during one chunk of data,
+ * reported by the transfer threads for each frame. This is all that
+ * views of the activity of the whole array need, rather than the samples.
+ */
+struct Activity {
+
+	/*! Data channel. */
+	qint32 channel;
+
+	/*! Number of samples in the chunk. */
+	qint32 samples;
+
+	/*! Number of spikes detected in the chunk. */
+	qint32 spikes;
+
+	/*! Variance of the raw samples of the chunk, or a negative value if
+	 * it was not measured.
+	 */
+	float variance;
+
+}; // end Activity struct
+
+/*! The activity of a range of channels during one chunk of data. */
+typedef QVector<Activity> ActivityList;
+
+}; // end channelstats namespace
+}; // end meaview namespace
+
+Q_DECLARE_METATYPE(meaview::channelstats::ActivityList);
+
+#endif
+
@@ -0,0 +1,151 @@
+/*! \file decimator.h
+ *
+ * Class for reducing a block of samples to a min/max envelope, with one
+ * column per pixel of the subplot in which it is drawn.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_DECIMATOR_H_
+#define _MEAVIEW_DECIMATOR_H_
+
+#include "data-frame.h" // for DataFrame::DataType type alias
+#include "samplekernels.h"
+
+#include <QVector>
+
+namespace meaview {
+
+/*! \namespace decimator
+ *
+ * The decimator namespace contains classes used to reduce blocks of
+ * data to the number of points which can actually be drawn.
+ */
+namespace decimator {
+
+/*! \class Envelope
+ *
+ * An Envelope stores the minimum and maximum raw sample value within
+ * each of a fixed number of columns, which together span one plot block.
+ * Column `i` covers the samples in `[key(i), key(i + 1))`. The block
+ * starts at sample `offset`, which is 0 except for envelopes of a
+ * channel's history. The envelope also carries a summary of all the
+ * samples reduced into it, if it was filled by a Decimator.
+ */
+class Envelope {
+
+	public:
+		/*! Return the number of columns in the envelope. */
+		inline int columns() const { return min.size(); }
+
+		/*! Return the index of the first sample in the given column. */
+		inline double key(int column) const
+		{
+			return offset + (static_cast<double>(column) * blockSize) / min.size();
+		}
+
+		/*! Remove all columns from the envelope. */
+		inline void clear()
+		{
+			min.clear();
+			max.clear();
+			offset = 0;
+			blockSize = 0;
+			size = 0;
+			summary.clear();
+		}
+
+		/*! Minimum sample in each column. */
+		QVector<float> min;
+
+		/*! Maximum sample in each column. */
+		QVector<float> max;
+
+		/*! Index of the first sample spanned by the envelope. */
+		double offset = 0;
+
+		/*! Number of samples spanned by all columns of the envelope. */
+		int blockSize = 0;
+
+		/*! Number of columns which have been completely filled. */
+		int size = 0;
+
+		/*! Extrema and sum of the samples reduced into the envelope. */
+		samplekernels::Summary summary;
+
+}; // end Envelope class
+
+/*! \class Decimator
+ *
+ * The Decimator class incrementally reduces the samples of a plot block
+ * to an Envelope, as chunks of data arrive.
+ *
+ * The Decimator runs in the same background thread as the Subplot which
+ * owns it, so that the cost of decimation is paid once per sample as data
+ * is transferred, rather than on each replot. The number of columns is
+ * chosen to match the width in pixels of the subplot, so that the cost
+ * of drawing the envelope depends only on the size of the screen, not
+ * on the sample rate. The extrema of each column, and the sum of the
+ * block, are computed together in a single vectorized pass.
+ */
+class Decimator {
+
+	public:
+		/*! Construct a Decimator. */
+		Decimator();
+
+		/*! Reset the decimator to start a new plot block.
+		 *
+		 * \param blockSize The number of samples in a full plot block.
+		 * \param columns The number of columns in the envelope, usually the
+		 * 	width of the subplot in pixels. This is clamped to `blockSize`.
+		 */
+		void reset(int blockSize, int columns);
+
+		/*! Reduce a chunk of samples into the current envelope.
+		 *
+		 * Samples beyond the end of the current plot block are ignored.
+		 */
+		void append(const DataFrame::DataType* data, int n);
+
+		/*! Return the envelope computed so far. */
+		inline const Envelope& envelope() const { return m_envelope; }
+
+		/*! Return the number of columns in the envelope. */
+		inline int columns() const { return m_envelope.columns(); }
+
+		/*! Return true if every column of the current block has been filled. */
+		inline bool isComplete() const { return m_column >= m_envelope.columns(); }
+
+		/*! Swap the current envelope with another. The decimator should be
+		 * reset before new data is appended.
+		 */
+		void swapEnvelope(Envelope& other);
+
+	private:
+
+		/* Return the index of the sample following the given column. */
+		int columnEnd(int column) const;
+
+		/* The envelope being computed. */
+		Envelope m_envelope;
+
+		/* The column currently being filled. */
+		int m_column = 0;
+
+		/* Index of the next sample in the block. */
+		int m_position = 0;
+
+		/* Index of the sample following the current column. */
+		int m_columnEnd = 0;
+
+		/* True if the current column contains any samples. */
+		bool m_columnStarted = false;
+
+}; // end Decimator class
+
+}; // end decimator namespace
+}; // end meaview namespace
+
+#endif
+
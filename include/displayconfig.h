@@ -0,0 +1,155 @@
+/*! \file displayconfig.h
+ *
+ * Immutable snapshot of the display and data settings read while plotting.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_DISPLAY_CONFIG_H_
+#define _MEAVIEW_DISPLAY_CONFIG_H_
+
+#include <QSettings>
+#include <QString>
+
+#include <memory>
+
+namespace meaview {
+
+/*! \namespace displayconfig
+ *
+ * The displayconfig namespace contains the DisplayConfig class, a typed
+ * copy of the settings which are read while data is transferred and
+ * plotted, and functions for publishing and reading it across threads.
+ *
+ * Looking up a value in QSettings takes a lock and converts a QVariant,
+ * which is too expensive to do for every chunk of every channel. Instead,
+ * the GUI thread publishes a new, immutable DisplayConfig each time it
+ * changes one of these settings, and consumers read the most recent one.
+ */
+namespace displayconfig {
+
+/*! \class DisplayConfig
+ *
+ * The DisplayConfig class holds the values of the settings used while
+ * plotting. It is never modified after it is published.
+ */
+class DisplayConfig {
+
+	public:
+		/*! Read a DisplayConfig from the given settings. */
+		static DisplayConfig fromSettings(const QSettings& settings);
+
+		/*! Return the number of samples in a plot block. */
+		inline int plotBlockSize() const
+		{
+			return static_cast<int>(refresh * sampleRate);
+		}
+
+		/*! Type of array from which data is recorded, "data/array". */
+		QString array;
+
+		/*! Gain converting raw samples to volts, "data/gain". */
+		double gain = 1.0;
+
+		/*! Sample rate of the data, "data/sample-rate". */
+		double sampleRate = 0.0;
+
+		/*! Duration of a plot block, in seconds, "display/refresh". */
+		double refresh = 0.0;
+
+		/*! Half-range of the y-axis of each plot, "display/scale". */
+		double scale = 0.0;
+
+		/*! Multiplier converting volts to displayed units, "display/scale-multiplier". */
+		double scaleMultiplier = 1.0;
+
+		/*! True if every subplot autoscales its y-axis, "display/autoscale". */
+		bool autoscale = false;
+
+		/*! True if each chunk is drawn as it arrives, sweeping across
+		 * the subplots, "display/sweep".
+		 */
+		bool sweep = false;
+
+		/*! True if subplots are rasterized in the transfer threads, 
+		 * "display/tile-rendering".
+		 */
+		bool tileRendering = false;
+
+		/*! True if the traces of each channel are drawn, rather than only
+		 * a summary of their activity, "display/traces".
+		 */
+		bool traces = true;
+
+		/*! True if spikes are detected in the transfer threads,
+		 * "display/spike-detection".
+		 */
+		bool spikeDetection = false;
+
+		/*! Threshold for detecting spikes, in multiples of each channel's
+		 * noise level, "display/spike-threshold".
+		 */
+		double spikeThreshold = 0.0;
+
+		/*! True if the raw samples are bandpass filtered before they are
+		 * plotted, "display/filter".
+		 */
+		bool filter = false;
+
+		/*! Low and high cutoff frequencies of the bandpass filter, in Hz,
+		 * "display/filter-low" and "display/filter-high".
+		 */
+		double filterLow = 0.0;
+		double filterHigh = 0.0;
+
+}; // end DisplayConfig class
+
+/*! A shared, immutable DisplayConfig. */
+typedef std::shared_ptr<const DisplayConfig> Snapshot;
+
+/*! Publish a new snapshot, read from the given settings. This should be
+ * called by the GUI thread after changing any of the settings in the
+ * DisplayConfig.
+ */
+void publish(const QSettings& settings);
+
+/*! Return the most recently published snapshot. */
+Snapshot current();
+
+/*! \class Reader
+ *
+ * The Reader class caches the most recent snapshot for a single consumer.
+ *
+ * Each publication increments an atomic generation counter. The reader
+ * only compares that counter with the generation of its cached snapshot,
+ * and fetches the new snapshot when they differ, so that reading the
+ * configuration is a single atomic load in the common case. A Reader
+ * must only be used from one thread.
+ */
+class Reader {
+
+	public:
+		/*! Construct a Reader, caching the current snapshot. */
+		Reader();
+
+		/*! Return the most recently published configuration.
+		 *
+		 * The returned reference remains valid until the next call.
+		 */
+		const DisplayConfig& get();
+
+	private:
+
+		/* Cached snapshot. */
+		Snapshot m_snapshot;
+
+		/* Generation of the cached snapshot. */
+		int m_generation;
+
+}; // end Reader class
+
+}; // end displayconfig namespace
+}; // end meaview namespace
+
+#endif
+
@@ -0,0 +1,100 @@
+/*! \file gridplot.h
+ *
+ * Class for drawing the grid of subplots, redrawing only those which changed.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_GRID_PLOT_H_
+#define _MEAVIEW_GRID_PLOT_H_
+
+#include "settings.h"
+#include "qcustomplot.h"
+#include "tracegraph.h"
+
+#include <QPixmap>
+
+namespace meaview {
+
+/*! \namespace gridplot
+ *
+ * The gridplot namespace contains the GridPlot class, the QCustomPlot
+ * containing every subplot in the PlotWindow.
+ */
+namespace gridplot {
+
+/*! \class GridPlot
+ *
+ * The GridPlot class is a QCustomPlot which caches what it draws, so
+ * that a replot only re-rasterizes the subplots which have changed.
+ *
+ * The plot is drawn in two parts. The frame contains everything except
+ * the data, i.e., the background, axes and labels of each subplot. It is
+ * rendered into a cached pixmap, and only re-rendered when the layout of
+ * the grid or the size of the plot changes, or when a subplot's axes are
+ * redrawn, e.g., because autoscaling changed its tick labels. The
+ * TraceGraphs drawing the data live on their own layer, named by
+ * `gridplot::TraceLayerName`, above the frame.
+ *
+ * The composite of the frame and all traces is also cached. On each replot,
+ * only the axis rects of graphs marked dirty are restored from the frame
+ * and redrawn, and the rest of the composite is reused as is. A graph
+ * may mark only part of itself as dirty, e.g., the columns newly drawn
+ * in sweep mode, in which case only that part is redrawn.
+ */
+class GridPlot : public QCustomPlot {
+	Q_OBJECT
+
+	public:
+		/*! Construct a GridPlot. 
+		 *
+		 * The trace layer is created above the main layer. Graphs must be
+		 * moved to it explicitly, as it does not become the current layer.
+		 */
+		GridPlot(QWidget* parent = nullptr);
+
+		/*! Destroy a GridPlot. */
+		virtual ~GridPlot();
+
+		/*! Mark the frame as invalid, so that the whole plot is re-rendered
+		 * on the next replot. This must be called after any change to the
+		 * layout, such as adding, removing or moving subplots.
+		 */
+		void invalidateFrame();
+
+	protected:
+
+		/* Draw the plot, using the cached frame and composite where possible. */
+		virtual void draw(QCPPainter* painter);
+
+	private:
+
+		/* Return all TraceGraphs in the plot. */
+		QList<tracegraph::TraceGraph*> traceGraphs() const;
+
+		/* Render the frame, i.e., everything but the trace layer. */
+		void renderFrame(QCPPainter* painter);
+
+		/* Redraw a single graph onto the composite, over its part of the frame.
+		 * Only the given region, relative to the graph's axis rect, is redrawn,
+		 * unless it is null.
+		 */
+		void redrawGraph(QCPPainter* painter, tracegraph::TraceGraph* graph,
+				const QRect& region);
+
+		/* Cached frame, everything but the traces. */
+		QPixmap m_frame;
+
+		/* Cached composite of the frame and traces. */
+		QPixmap m_composite;
+
+		/* True if the frame must be re-rendered on the next replot. */
+		bool m_frameInvalid = true;
+
+}; // end GridPlot class
+
+}; // end gridplot namespace
+}; // end meaview namespace
+
+#endif
+
@@ -0,0 +1,117 @@
+/*! \file hdf5reader.h
+ *
+ * Class for playing back data directly from an HDF5 recording file.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_HDF5_READER_H_
+#define _MEAVIEW_HDF5_READER_H_
+
+#include "settings.h"
+#include "recordingreader.h"
+
+#include "data-frame.h" // for DataFrame::Samples type alias
+
+#include "H5Cpp.h"
+
+#include <QString>
+
+namespace meaview {
+
+/*! \namespace hdf5reader
+ *
+ * The hdf5reader namespace contains the Hdf5Reader class, used to
+ * play back recordings stored in HDF5 files without the BLDS.
+ */
+namespace hdf5reader {
+
+/*! \class Hdf5Reader
+ *
+ * The Hdf5Reader class reads data from a recording stored in an HDF5 file.
+ *
+ * The samples are read from a two-dimensional dataset in the file,
+ * named by `hdf5reader::DatasetName`, with one axis for channels and one
+ * for time. The shorter axis is taken to be the channels. The sample
+ * rate, gain and array type are read from the attributes "sample-rate",
+ * "gain" and "array" of the dataset or, failing that, of the file itself.
+ *
+ * Reads from the file are aligned to the chunks of the dataset along the
+ * time axis, so that each chunk is read and decompressed only once. At
+ * least `hdf5reader::ReadAheadChunks` chunks are read at a time, and
+ * requests for data are served from these until a request falls outside
+ * them.
+ */
+class Hdf5Reader : public recordingreader::RecordingReader {
+	Q_OBJECT
+
+	public:
+		/*! Construct an Hdf5Reader.
+		 *
+		 * \param filename The name of the recording file. The file is not
+		 * 	opened until the `open()` slot is called.
+		 */
+		Hdf5Reader(const QString& filename);
+
+		/*! Destroy an Hdf5Reader, closing the file. */
+		~Hdf5Reader();
+
+	public slots:
+
+		/*! Open the recording file and read its metadata. */
+		void open() override;
+
+		/*! Read the data between two times in the recording.
+		 * The request is clipped to the end of the file.
+		 */
+		void requestData(double start, double stop) override;
+
+	private:
+
+		/* Read whole chunks of the dataset, covering the samples
+		 * in [first, last), into the cache.
+		 */
+		void readChunks(hsize_t first, hsize_t last);
+
+		/* Return the value of an attribute of the dataset or file,
+		 * or the default if the attribute is not found.
+		 */
+		double readDoubleAttribute(const QString& name, double def);
+		QString readStringAttribute(const QString& name, const QString& def);
+
+		/* Return the object holding the named attribute, if any. */
+		H5::H5Object* findAttribute(const QString& name);
+
+		/* The recording file, its root group, and its dataset of samples. */
+		H5::H5File m_file;
+		H5::Group m_root;
+		H5::DataSet m_dataset;
+
+		/* True if the dataset has shape (nchannels, nsamples), and false
+		 * if it has shape (nsamples, nchannels).
+		 */
+		bool m_channelsFirst = true;
+
+		/* Number of channels and samples in the dataset. */
+		hsize_t m_nchannels = 0;
+		hsize_t m_nsamples = 0;
+
+		/* Length along the time axis of each chunk of the dataset. */
+		hsize_t m_chunkLength = 0;
+
+		/* Sample rate of the recording. */
+		double m_sampleRate = 0.;
+
+		/* Samples most recently read from the file, with one column
+		 * per channel, and the index of the first of them.
+		 */
+		DataFrame::Samples m_cache;
+		hsize_t m_cacheStart = 0;
+
+}; // end Hdf5Reader class
+
+}; // end hdf5reader namespace
+}; // end meaview namespace
+
+#endif
+
@@ -0,0 +1,85 @@
+/*! \file latency.h
+ *
+ * Rolling measurements of the latency from receiving data to drawing it.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_LATENCY_H_
+#define _MEAVIEW_LATENCY_H_
+
+#include <QString>
+#include <QJsonObject>
+
+namespace meaview {
+
+/*! \namespace latency
+ *
+ * The latency namespace measures how far behind the data the display is.
+ *
+ * Each frame of data is timestamped with `now()` when it is received, and
+ * the timestamp is carried with the frame through the transfer threads
+ * to the replot which first draws it. The latency of each segment of the
+ * path is recorded into a rolling window of the most recent values, from
+ * which percentiles are computed. Unlike the stage timers in profiler.h,
+ * these are always compiled in, as they cost a few clock reads per replot.
+ *
+ * Values may be recorded and read from any thread.
+ */
+namespace latency {
+
+/*! The segments of the path from a request for data to the screen. */
+enum class Segment {
+	Network,   //!< From requesting a frame to receiving it, from the BLDS or a file.
+	Transfer,  //!< From receiving a frame to all subplots being ready to replot.
+	Render,    //!< From all subplots being ready to the end of the replot.
+	Total,     //!< From receiving a frame to the end of the replot.
+	NumSegments
+};
+
+/*! Summary of the recent latencies of one segment, in milliseconds. */
+struct Summary {
+	int count = 0;      //!< Number of values in the rolling window.
+	double p50 = 0.;    //!< Median.
+	double p99 = 0.;    //!< 99th percentile.
+	double max = 0.;    //!< Largest value.
+};
+
+/*! Return the current time, in nanoseconds from an arbitrary origin.
+ * This is a monotonic clock, shared by all threads.
+ */
+qint64 now();
+
+/*! Record one latency of a segment, in nanoseconds. */
+void record(Segment segment, qint64 ns);
+
+/*! Record the latency of a segment from the given time until now. */
+inline void recordSince(Segment segment, qint64 since)
+{
+	record(segment, now() - since);
+}
+
+/*! Summarize the values in the rolling window of a segment. */
+Summary summarize(Segment segment);
+
+/*! Discard all recorded values. */
+void reset();
+
+/*! Return a short name for a segment. */
+QString segmentName(Segment segment);
+
+/*! Return a one-line description of the median and 99th percentile
+ * latency of each segment, suitable for a status bar.
+ */
+QString statusText();
+
+/*! Return the summary of every segment as a JSON object, keyed by the
+ * name of the segment, with times in milliseconds.
+ */
+QJsonObject toJson();
+
+}; // end latency namespace
+}; // end meaview namespace
+
+#endif
+
@@ -0,0 +1,152 @@
+/*! \file lodpyramid.h
+ *
+ * Class implementing a multi-resolution min/max history of a single channel.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_LOD_PYRAMID_H_
+#define _MEAVIEW_LOD_PYRAMID_H_
+
+#include "decimator.h"
+
+#include "data-frame.h" // for DataFrame::DataType type alias
+
+#include <QVector>
+#include <QMutex>
+
+namespace meaview {
+
+/*! \namespace lodpyramid
+ *
+ * The lodpyramid namespace contains the LodPyramid class, which stores
+ * the history of a channel at several levels of detail.
+ */
+namespace lodpyramid {
+
+/*! \class LodPyramid
+ *
+ * The LodPyramid class stores the recent history of a single channel at
+ * multiple resolutions, so that any portion of it can be drawn at any zoom
+ * level by reading only as many values as there are pixels.
+ *
+ * Level 0 of the pyramid is a ring buffer of raw samples. Each bin of level
+ * `k > 0` holds the minimum and maximum of `factor` consecutive bins of level
+ * `k - 1`, and so summarizes `factor^k` raw samples. Every level holds the
+ * same number of bins, so each level reaches `factor` times further back
+ * in time than the one below it, for a fixed amount of memory.
+ *
+ * The pyramid is built incrementally as data is appended, in the transfer
+ * thread of the Subplot which owns it, and is queried from the GUI thread
+ * by a ChannelInspector. Access is synchronized with an internal mutex.
+ * The pyramid allocates no storage until it is enabled, so that only
+ * channels which are actually being inspected pay for their history.
+ */
+class LodPyramid {
+
+	public:
+		/*! Construct a LodPyramid.
+		 *
+		 * \param levelSize The number of bins (or samples) in each level.
+		 * \param factor The number of bins of one level summarized by each
+		 * 	bin of the next level.
+		 * \param nlevels The number of levels, including the raw samples.
+		 */
+		LodPyramid(int levelSize, int factor, int nlevels);
+
+		/*! Enable or disable the pyramid. Enabling the pyramid allocates
+		 * storage, and disabling it releases storage. Either clears all data.
+		 */
+		void setEnabled(bool enabled);
+
+		/*! Return true if the pyramid is enabled. */
+		bool isEnabled() const;
+
+		/*! Append raw samples to the pyramid. This does nothing if
+		 * the pyramid is not enabled.
+		 */
+		void append(const DataFrame::DataType* data, int n);
+
+		/*! Return the total number of samples appended since the pyramid
+		 * was enabled. This is one past the index of the newest sample.
+		 */
+		qint64 count() const;
+
+		/*! Return the index of the oldest sample still summarized by the pyramid. */
+		qint64 first() const;
+
+		/*! Reduce the history over a range of samples to an envelope.
+		 *
+		 * \param begin Index of the first sample in the range.
+		 * \param end Index one past the last sample in the range.
+		 * \param columns Number of columns in the returned envelope, usually
+		 * 	the width of the plot in pixels.
+		 * \param envelope The envelope in which the result is stored.
+		 *
+		 * The range is clipped to the samples which are available. The
+		 * coarsest level of the pyramid which still provides at least one
+		 * bin per column is used, so that the cost of the query depends only
+		 * on the number of columns. If there are fewer samples than
+		 * columns, the envelope contains one column per raw sample.
+		 */
+		void query(qint64 begin, qint64 end, int columns,
+				decimator::Envelope* envelope) const;
+
+	private:
+
+		/* One level of the pyramid. For level 0, only `min` is used, and
+		 * holds the raw samples. The `partial` values accumulate the bins
+		 * of this level which make up the next bin of the level above.
+		 */
+		struct Level {
+			QVector<DataFrame::DataType> min;
+			QVector<DataFrame::DataType> max;
+			qint64 count = 0;
+			DataFrame::DataType partialMin = 0;
+			DataFrame::DataType partialMax = 0;
+			int partialCount = 0;
+		};
+
+		/* Write a complete bin to the given level, and merge it into the
+		 * partial bin of the next level.
+		 */
+		void pushBin(int level, DataFrame::DataType lo, DataFrame::DataType hi);
+
+		/* Return the number of raw samples summarized by one bin of a level. */
+		qint64 binWidth(int level) const;
+
+		/* Return the index of the oldest bin still stored in a level. */
+		qint64 firstBin(int level) const;
+
+		/* Return the index of the oldest sample summarized by any level.
+		 * The mutex must be held by the caller.
+		 */
+		qint64 firstSample() const;
+
+		/* Allocate or release storage and clear all levels. */
+		void resetLevels(bool allocate);
+
+		/* Number of bins in each level. */
+		int m_levelSize;
+
+		/* Number of bins of one level summarized by a bin of the next level. */
+		int m_factor;
+
+		/* The levels of the pyramid. */
+		QVector<Level> m_levels;
+
+		/* True if the pyramid is collecting data. */
+		bool m_enabled = false;
+
+		/* Synchronizes the transfer thread appending data with the
+		 * GUI thread querying it.
+		 */
+		mutable QMutex m_mutex;
+
+}; // end LodPyramid class
+
+}; // end lodpyramid namespace
+}; // end meaview namespace
+
+#endif
+
@@ -10,6 +10,15 @@
 
 #include "settings.h"
 #include "plotwindow.h"
+#include "activitymap.h"
+#include "spikeraster.h"
+#include "requestscheduler.h"
+#include "recordingreader.h"
+#include "hdf5reader.h"
+#include "rawreader.h"
+#include "sampleframe.h"
+#include "displayconfig.h"
+#include "latency.h"
 
 #include "configuration.h" // from libdata-source/include, for QConfiguration
 
@@ -53,6 +62,9 @@ enum class PlaybackStatus {
  * the data in realtime streamed from the BLDS application. Users are
  * able to start and stop this stream of data as they wish, and to
  * jump around in time to view any data that has already been collected.
+ *
+ * Alternatively, a recording file may be opened directly, in which case
+ * data is read from disk in a background thread rather than from the BLDS.
  */
 class MeaviewWindow : public QMainWindow {
 	Q_OBJECT
@@ -71,6 +83,11 @@ class MeaviewWindow : public QMainWindow {
 		 */
 		void recordingFinished();
 
+		/*! Emitted to request data between two times from an open
+		 * recording file.
+		 */
+		void requestRecordingData(double start, double stop);
+
 	private slots:
 
 		/*! This slot is called when the user clicks the "Connect"
@@ -157,16 +174,97 @@ class MeaviewWindow : public QMainWindow {
 		 */
 		void updateScale(double scale);
 
+		/*! This slot sets whether data is drawn as each chunk arrives,
+		 * sweeping across the plots, or a full block at a time.
+		 */
+		void updateSweep(int state);
+
 		/*! This slot updates the refresh interval of each plot. */
 		void updateRefresh(double refresh);
 
-		/*! Request the next chunk of data in the recording, using
-		 * the current time and the refresh rate.
+		/*! This slot sets whether subplots are rasterized in parallel
+		 * by the transfer threads, or all at once by the main thread.
+		 */
+		void updateTileRendering(bool checked);
+
+		/*! This slot sets whether spikes are detected in the data
+		 * as it is transferred to each plot.
+		 */
+		void updateSpikeDetection(bool checked);
+
+		/*! This slot sets whether the raw samples are bandpass
+		 * filtered before they are plotted.
+		 */
+		void updateFiltering(bool checked);
+
+		/*! Start continuously requesting data from the current
+		 * position in the recording.
 		 */
 		void requestData();
 
-		/*! Handle the receipt of a frame of data from the BLDS. */
-		void receiveDataFrame(const DataFrame& frame);
+		/*! Handle the receipt of a frame of data from the BLDS,
+		 * in the order it was requested.
+		 *
+		 * \param frame The frame of data.
+		 * \param received The time at which it was received.
+		 */
+		void receiveDataFrame(const DataFrame& frame, qint64 received);
+
+		/*! Handle frames being dropped because playback fell behind,
+		 * either by the request scheduler or by the plot window.
+		 */
+		void handleDroppedFrames();
+
+		/*! Show the number of replots which missed their deadline. */
+		void handleMissedDeadlines(int total);
+
+		/*! Stop or resume requesting data while the plot window cannot
+		 * keep up, under the throttling backpressure policy.
+		 */
+		void handleThrottle(bool throttling);
+
+		/*! Set the policy for frames arriving faster than they can be
+		 * plotted, from the action selecting it.
+		 */
+		void updateBackpressurePolicy(QAction* action);
+
+		/*! Show the activity map in place of the grid of traces, or
+		 * the grid again. The traces are not drawn while hidden.
+		 */
+		void showActivityMap(bool checked);
+
+		/*! Set the measure by which the activity map is colored, from
+		 * the action selecting it.
+		 */
+		void updateActivityMeasure(QAction* action);
+
+		/*! This slot asks the user for a recording file, and opens it for
+		 * playback in place of the BLDS.
+		 */
+		void openRecordingFile();
+
+		/*! Handle a recording file being opened, setting up the plots
+		 * for the data it contains.
+		 */
+		void handleRecordingFileOpened(const QJsonObject& status);
+
+		/*! Handle the receipt of a frame of data read from a recording file. */
+		void receiveRecordingData(double start, double stop,
+				const sampleframe::SampleFrame& frame);
+
+		/*! Handle reaching the end of a recording file. */
+		void handleRecordingFileEnd();
+
+		/*! Handle an error opening or reading a recording file. */
+		void handleRecordingFileError(const QString& msg);
+
+		/*! This slot closes any open recording file, and clears the plots. */
+		void closeRecordingFile();
+
+		/*! This slot asks the user for a file, and saves the recent
+		 * latencies of the display to it as JSON.
+		 */
+		void saveLatencyStatistics();
 
 		/*! This slot minifies the window, making it small but visible.
 		 * This can be useful for keeping an eye on the display without it
@@ -235,6 +333,17 @@ class MeaviewWindow : public QMainWindow {
 		 */
 		void initChannelViewMenu();
 
+		/* Set up the settings, plots and playback controls for a
+		 * source of data, given its status, from either the BLDS
+		 * or a recording file.
+		 */
+		void setupDataSource(const QJsonObject& status);
+
+		/* Make a single request for data between two times, from
+		 * either the BLDS or a recording file.
+		 */
+		void requestFrame(double start, double stop);
+
 		/* Current status of playback. */
 		PlaybackStatus playbackStatus;
 
@@ -249,11 +358,41 @@ class MeaviewWindow : public QMainWindow {
 		 */
 		QPointer<BldsClient> client;
 
+		/* Scheduler keeping multiple requests for data outstanding
+		 * with the BLDS, and delivering the resulting frames in order.
+		 */
+		QPointer<requestscheduler::RequestScheduler> scheduler;
+
+		/* Reader for a recording file opened in place of the BLDS, if any. */
+		QPointer<recordingreader::RecordingReader> reader;
+
+		/* Thread in which the recording file reader lives. */
+		QThread* readerThread;
+
+		/* Times at which requests for data were made to the recording
+		 * file reader, in order. The reader answers each request in turn
+		 * with either a frame of data or the end of the file.
+		 */
+		QQueue<qint64> recordingRequestTimes;
+
 		/* Main window showing all subplots of data. This is the
 		 * central widget of the MeaviewWindow class.
 		 */
 		QPointer<plotwindow::PlotWindow> plotWindow;
 
+		/* Map of the activity on each electrode, shown in place of
+		 * the plot window when selected.
+		 */
+		activitymap::ActivityMap* activityMap;
+
+		/* Central widget, holding the plot window and activity map. */
+		QStackedWidget* centralStack;
+
+		/* Raster of the recent spikes on every channel, shown in a
+		 * dock widget alongside the central widget.
+		 */
+		spikeraster::SpikeRaster* spikeRaster;
+
 		/* The current hidens configuration, if any. */
 		QConfiguration hidensConfiguration;
 
@@ -271,8 +410,22 @@ class MeaviewWindow : public QMainWindow {
 		/* The menu for manipulating playback. */
 		QMenu* playbackMenu;
 
+		/* Sub-menu selecting the policy for frames arriving faster
+		 * than they can be plotted.
+		 */
+		QMenu* backpressureMenu;
+
+		/* Exclusive group of actions, one per backpressure policy. */
+		QActionGroup* backpressureActions;
+
 		/* The menu for controlling windows and views of data. */
 		QMenu* viewMenu;
+
+		/* Sub-menu selecting the measure shown by the activity map. */
+		QMenu* activityMeasureMenu;
+
+		/* Exclusive group of actions, one per activity measure. */
+		QActionGroup* activityMeasureActions;
 	
 		/* Action for connecting to the data server. */
 		QAction* connectToDataServerAction;
@@ -280,6 +433,12 @@ class MeaviewWindow : public QMainWindow {
 		/* Action for disconnection from the data server. */
 		QAction* disconnectFromDataServerAction;
 
+		/* Action for opening a recording file. */
+		QAction* openRecordingFileAction;
+
+		/* Action for closing an open recording file. */
+		QAction* closeRecordingFileAction;
+
 		/* Action for starting the playback of data. */
 		QAction* startPlaybackAction;
 
@@ -321,6 +480,24 @@ class MeaviewWindow : public QMainWindow {
 		/* Action to minify the main window. */
 		QAction* minifyAction;
 
+		/* Action to toggle rendering subplots in parallel. */
+		QAction* tileRenderingAction;
+
+		/* Action to toggle detecting spikes. */
+		QAction* spikeDetectionAction;
+
+		/* Action to toggle bandpass filtering the data. */
+		QAction* filterAction;
+
+		/* Action to show the activity map in place of the traces. */
+		QAction* showActivityMapAction;
+
+		/* Action to show the spike raster dock widget. */
+		QAction* showSpikeRasterDockWidget;
+
+		/* Action to save the latency statistics of the display. */
+		QAction* saveLatencyStatisticsAction;
+
 		/* Main layout manager. */
 		QGridLayout* mainLayout;
 
@@ -381,6 +558,9 @@ class MeaviewWindow : public QMainWindow {
 		/* Dock widget for the display settings. */
 		QDockWidget* displaySettingsDockWidget;
 
+		/* Dock widget for the spike raster. */
+		QDockWidget* spikeRasterDockWidget;
+
 		/* Widget for the settings dock. */
 		QWidget* displaySettingsWidget;
 
@@ -414,6 +594,9 @@ class MeaviewWindow : public QMainWindow {
 		/* Check box used to select whether the plots autoscale. */
 		QCheckBox* autoscaleBox;
 
+		/* Check box used to select whether the plots sweep. */
+		QCheckBox* sweepBox;
+
 		/* Stored connections to make it easier to connect/disconnect
 		 * callbacks in various places.
 		 */
@@ -421,6 +604,21 @@ class MeaviewWindow : public QMainWindow {
 
 		/* Full window position, used to restore after minification. */
 		QRect windowPosition;
+
+		/* Permanent label in the status bar showing the recent latency
+		 * from receiving data to drawing it.
+		 */
+		QLabel* latencyLabel;
+
+		/* Permanent label in the status bar showing the number of
+		 * frames dropped because playback fell behind.
+		 */
+		QLabel* droppedFramesLabel;
+
+		/* Permanent label in the status bar showing the number of
+		 * replots which missed their deadline.
+		 */
+		QLabel* missedDeadlinesLabel;
 };
 
 }; // end meaviewwindow namespace
@@ -10,8 +10,15 @@
 
 #include "settings.h"
 #include "qcustomplot.h"
+#include "gridplot.h"
 #include "channelinspector.h"
 #include "subplot.h"
+#include "subplotworker.h"
+#include "sampleframe.h"
+#include "bandpass.h"
+#include "displayconfig.h"
+#include "profiler.h"
+#include "latency.h"
 
 #include "data-frame.h"
 
@@ -19,14 +26,30 @@
 #include <QPoint>
 #include <QList>
 #include <QThread>
-#include <QReadWriteLock>
 #include <QSet>
 #include <QStringList>
 #include <QPair>
+#include <QQueue>
+#include <QVector>
+#include <QTimer>
 
 namespace meaview {
 namespace plotwindow {
 
+/*! Policies for handling frames which arrive faster than they can be
+ * transferred and plotted.
+ */
+enum class BackpressurePolicy {
+	DropOldest,    //!< Drop the oldest waiting frames, keeping the queue full.
+	SkipToLatest,  //!< Drop all waiting frames but the newest.
+	Throttle       //!< Ask the source of data to slow down, dropping nothing.
+};
+
+/*! Return the policy with the given name, from BackpressurePolicyNames,
+ * or the default policy if the name is unknown.
+ */
+BackpressurePolicy backpressurePolicyFromName(const QString& name);
+
 /*! \class PlotWindow
  * Main widget containing grid of data plots.
  *
@@ -37,6 +60,33 @@ namespace plotwindow {
  * correct subplot displaying that data. The PlotWindow provides
  * functionality for creating a "channel inspector", a blown-up view of
  * a single channel of data.
+ *
+ * At most `MaxFramesInFlight` frames are sent to the workers before all
+ * of them have handled the first, so that the workers' event queues stay
+ * short however slowly the grid is replotted. Later frames wait in a
+ * queue of at most `MaxPendingFrames`, beyond which frames are dropped
+ * according to the backpressure policy. With the throttling policy,
+ * `throttleChanged()` is emitted instead, so that the source of data can
+ * stop requesting more until the queue has drained.
+ *
+ * Replots are paced by a timer ticking at the target frame rate. The grid
+ * is replotted as soon as every worker has published new blocks, unless
+ * the previous replot was less than a frame ago, in which case the next
+ * tick replots it. If only some workers have published, the next tick
+ * at least a frame after the first of them replots whatever they have,
+ * so that one slow thread cannot hold back the whole grid. Such partial
+ * replots, and replots taking longer than a frame, count as missed
+ * deadlines.
+ *
+ * Frames may be bandpass filtered as they arrive, before they are queued,
+ * so that every frame passes through the filter in order, even if it is
+ * later dropped. Filtered frames replace the raw ones for all subplots,
+ * and for the spikes and activity they report.
+ *
+ * The subplots also detect spikes as data arrives, and the spikes found
+ * by all workers are forwarded by `spikesDetected()`, and the activity on
+ * each channel by `activityMeasured()`, for views which show activity
+ * rather than the raw samples.
  */
 class PlotWindow : public QWidget {
 	Q_OBJECT
@@ -59,28 +109,75 @@ class PlotWindow : public QWidget {
 		void setupWindow(const QString& array, int nchannels);
 
 		/*! Transfer data contained in an Armadillo matrix into
-		 * the corresponding channel subplots
+		 * the corresponding channel subplots.
+		 *
+		 * The samples are copied once into a shared SampleFrame, which
+		 * is sent once to each SubplotWorker. Each subplot reads its own
+		 * channel from the frame in place.
 		 */
 		void transferDataToSubplots(const DataFrame::Samples& samples);
 
+		/*! Transfer a frame of data which is already shared, e.g., one
+		 * read from a recording file, into the corresponding channel
+		 * subplots without copying it.
+		 *
+		 * The frame is sent to the workers immediately if they have few
+		 * enough frames in flight, and otherwise waits in a bounded queue.
+		 */
+		void transferDataToSubplots(const sampleframe::SampleFrame& frame);
+
+		/*! Return the policy for frames arriving faster than they can be plotted. */
+		inline BackpressurePolicy backpressurePolicy() const { return policy; }
+
+		/*! Set the policy for frames arriving faster than they can be plotted. */
+		void setBackpressurePolicy(BackpressurePolicy policy);
+
+		/*! Return the number of frames dropped by the backpressure policy. */
+		inline int droppedFrames() const { return droppedFrameCount; }
+
+		/*! Return the target rate at which the grid is replotted, in
+		 * frames per second.
+		 */
+		inline double frameRate() const { return targetFrameRate; }
+
+		/*! Set the target rate at which the grid is replotted, in frames
+		 * per second. This is clamped to [MinFrameRate, MaxFrameRate].
+		 */
+		void setFrameRate(double rate);
+
+		/*! Return true if the traces of each channel are drawn. */
+		inline bool tracesShown() const { return showTraces; }
+
+		/*! Set whether the traces of each channel are drawn. While they are
+		 * hidden, e.g., because only the activity of each channel is shown,
+		 * data is still transferred to the subplots, and plotRefreshed()
+		 * still emitted, but the grid is not replotted. The subplots stop
+		 * rendering tiles once the "display/traces" setting is published.
+		 */
+		void setTracesShown(bool shown);
+
+		/*! Return the number of replots which missed their deadline. */
+		inline int missedDeadlines() const { return missedDeadlineCount; }
+
+		/*! Return true if the source of data should stop requesting
+		 * frames, because the queue of waiting frames is not empty
+		 * under the throttling policy.
+		 */
+		inline bool isThrottling() const { return throttling; }
+
 		/*! Return the currently-used channel view */
 		const plotwindow::ChannelView& currentView() const;
 
 	signals:
 
-		/*! Send data to a subplot for transfer.
-		 *
-		 * \param sp The subplot in which the data will be plotted.
-		 * \param data Vector of data to be transferred.
-		 * \param lock The read-write lock synchronizing access to the main plot surface.
-		 * \param clicked True if the user has right-clicked this plot.
+		/*! Send a frame of data to all subplot workers.
 		 *
-		 * NOTE: The data is passed as a pointer, and the subplot which actually
-		 * contains the data *must* delete it.
+		 * \param frame The frame of data from all channels.
+		 * \param clicked Bit array, indexed by subplot index, of the
+		 * 	subplots which the user has right-clicked.
 		 */
-		void sendDataToSubplot(subplot::Subplot* sp, 
-				QVector<DataFrame::DataType>* data, QReadWriteLock* lock,
-				bool clicked);
+		void sendDataToWorkers(const sampleframe::SampleFrame& frame,
+				const QBitArray& clicked);
 
 		/*! Emitted when the number of open inspectors changes.
 		 * \param num The number of currently open inspectors.
@@ -105,6 +202,44 @@ class PlotWindow : public QWidget {
 		/*! Update refresh interval. */
 		void updateRefresh();
 
+		/*! Emitted when frames are dropped because they arrived faster
+		 * than they could be plotted.
+		 *
+		 * \param total The total number of frames dropped since the
+		 * 	window was last set up.
+		 */
+		void framesDropped(int total);
+
+		/*! Emitted when the source of data should stop or resume
+		 * requesting frames, under the throttling policy.
+		 */
+		void throttleChanged(bool throttling);
+
+		/*! Emitted when a replot misses its deadline, either because some
+		 * workers had not published new blocks a frame after the first
+		 * did, or because the replot took longer than a frame.
+		 *
+		 * \param total The total number of missed deadlines since the
+		 * 	window was last set up.
+		 */
+		void deadlinesMissed(int total);
+
+		/*! Emitted with the spikes detected by each worker in each frame.
+		 * This is the stream of spikes consumed by views of activity, and
+		 * is emitted in the GUI thread.
+		 *
+		 * \param spikes The spikes detected by one worker in one frame,
+		 * 	grouped by channel, and in order of time within each channel.
+		 */
+		void spikesDetected(const spikedetector::SpikeList& spikes);
+
+		/*! Emitted with the activity on the channels of each worker in
+		 * each frame, in the GUI thread.
+		 *
+		 * \param activity The activity on each channel of one worker.
+		 */
+		void activityMeasured(const channelstats::ActivityList& activity);
+
 	public slots:
 
 		/*! Minify the plot window and any open channel inspectors. */
@@ -137,23 +272,64 @@ class PlotWindow : public QWidget {
 		 */
 		void createChannelInspector(QMouseEvent* event);
 
-		/*! Increments the number of subplots that have finished transferring data.
-		 * This is used to notify the main plot window when it can redraw itself.
+		/*! Increments the number of workers whose subplots have finished
+		 * transferring data. This is used to notify the main plot window
+		 * when it can redraw itself.
+		 *
+		 * \param idx The index of the worker.
+		 * \param npoints The number of samples shown in each subplot.
+		 * \param received The time at which the frame completing the
+		 * 	worker's plot block was received.
+		 */
+		void incrementNumPlotsUpdated(int idx, int npoints, qint64 received);
+
+		/*! Handle a worker having handled a frame, sending any waiting
+		 * frames which no longer exceed the limit in flight.
+		 */
+		void handleFrameHandled(int idx);
+
+		/*! Handle a tick of the frame timer, replotting any subplots whose
+		 * workers have published since the last replot, if they are all
+		 * ready or if the first of them has waited at least a frame.
 		 */
-		void incrementNumPlotsUpdated(int idx, int npoints);
+		void handleFrameTick();
 
 	private:
 
 		/*! Construct a pool of plotting threads */
 		void initThreadPool();
 
+		/*! Send waiting frames to all workers, while the number of frames
+		 * in flight to any worker is below the limit.
+		 */
+		void dispatchPendingFrames();
+
+		/*! Send a single frame to all workers. */
+		void dispatchFrame(const sampleframe::SampleFrame& frame);
+
+		/*! Return a frame bandpass filtered, if filtering is enabled,
+		 * or otherwise the frame itself.
+		 */
+		sampleframe::SampleFrame filterFrame(const sampleframe::SampleFrame& frame);
+
+		/*! Drop waiting frames if there are too many for the current
+		 * policy, and update whether the source should be throttled.
+		 */
+		void applyBackpressure();
+
+		/*! Discard all waiting frames and in-flight counts, e.g., when
+		 * the workers are deleted.
+		 */
+		void resetBackpressure();
+
 		/*! Initialize the main QCustomPlot object */
 		void initPlot();
 
 		/*! Assign subplots to plot workers.
 		 * As new data is loaded or streamed, the number of subplots may change.
-		 * This function assigns each subplot to PlotWorkers, in as equitable a
-		 * manner as possible
+		 * This function assigns each subplot to SubplotWorkers, in as equitable a
+		 * manner as possible. Each worker receives a contiguous range of
+		 * channels, and lives in its own transfer thread.
 		 */
 		void assignSubplotsToWorkers();
 
@@ -203,11 +379,15 @@ class PlotWindow : public QWidget {
 		/*! A thread-safe replotting function.
 		 *
 		 * \param npoints The number of new points in each subplot.
+		 * \param received The time at which the newest frame being
+		 * 	drawn was received, or 0 if unknown.
 		 *
 		 * Data is transferred in worker threads, so this wrapper function
-		 * does thread-synchronization and then calls `plot->replot()`.
+		 * adopts the blocks each subplot has published into its graph, and
+		 * then calls `plot->replot()`.
+		 * The latency of the transfer and the replot are recorded.
 		 */
-		void replot(int npoints);
+		void replot(int npoints, qint64 received);
 
 		/*! The subplots live in separate threads, and this handler is
 		 * called when they have all notified this object that they've
@@ -215,6 +395,14 @@ class PlotWindow : public QWidget {
 		 */
 		void handleAllSubplotsDeleted();
 
+		/*! Return the interval between frames at the target frame
+		 * rate, in nanoseconds.
+		 */
+		qint64 frameIntervalNs() const;
+
+		/*! Count a missed deadline, and notify. */
+		void missDeadline();
+
 		/*! Compute which channels carry valid data. */
 		QMap<int, bool> computeValidDataChannels();
 
@@ -227,10 +415,70 @@ class PlotWindow : public QWidget {
 		/*! Number of total subplots */
 		int nsubplots;
 
-		/*! Bit array representing the subplots whose front and back buffers
-		 * have been swapped, and so are ready for a replot.
+		/*! Generation of the pending replot. This is incremented after
+		 * each replot, and starts at 1.
 		 */
-		QBitArray subplotsUpdated;
+		quint32 replotGeneration = 1;
+
+		/*! The generation of the replot for which each worker last
+		 * published new blocks, or 0 if it has not yet done so.
+		 */
+		QVector<quint32> workerGenerations;
+
+		/*! Number of workers which have not yet published new blocks
+		 * for the pending replot. The grid is replotted when this
+		 * reaches zero.
+		 */
+		int workersPending = 0;
+
+		/*! Number of samples shown in each subplot by the workers which
+		 * are ready for the pending replot.
+		 */
+		int pendingPoints = 0;
+
+		/*! Time at which the first worker was ready for the pending replot. */
+		qint64 generationStarted = 0;
+
+		/*! Time at which the last replot started, or 0 if none has. */
+		qint64 lastReplotTime = 0;
+
+		/*! Timer ticking at the target frame rate. */
+		QTimer* frameTimer;
+
+		/*! Target rate at which the grid is replotted, in frames per second. */
+		double targetFrameRate;
+
+		/*! Number of replots which missed their deadline. */
+		int missedDeadlineCount = 0;
+
+		/*! True if the grid of traces is replotted. */
+		bool showTraces = true;
+
+		/*! Time at which the newest frame of the pending replot was
+		 * received, from any of the workers which are ready.
+		 */
+		qint64 blockReceived = 0;
+
+		/*! Frames waiting to be sent to the workers, oldest first. */
+		QQueue<sampleframe::SampleFrame> pendingFrames;
+
+		/*! Filter applied to each frame as it arrives. */
+		bandpass::FilterBank filterBank;
+
+		/*! Snapshot of the display settings. */
+		displayconfig::Reader config;
+
+		/*! Number of frames sent to each worker and not yet handled. */
+		QVector<int> framesInFlight;
+
+		/*! Policy for frames arriving faster than they can be plotted. */
+		BackpressurePolicy policy;
+
+		/*! Number of frames dropped by the backpressure policy. */
+		int droppedFrameCount = 0;
+
+		/*! True if the source of data has been asked to stop requesting. */
+		bool throttling = false;
 
 		/*! Bit array representing the subplots which have
 		 * been deleted. This is used to clear the plot window after
@@ -238,6 +486,9 @@ class PlotWindow : public QWidget {
 		 */
 		QBitArray subplotsDeleted;
 
+		/*! Number of subplots which have not yet been deleted. */
+		int subplotsRemaining = 0;
+
 		/*! Labels for each channel */
 		QStringList channelLabels;
 
@@ -257,7 +508,7 @@ class PlotWindow : public QWidget {
 		QGridLayout* layout;
 
 		/*! Main plot object, containing all subplots */
-		QCustomPlot* plot;
+		gridplot::GridPlot* plot;
 
 		/*! List of all subplots */
 		QList<subplot::Subplot*> subplots;
@@ -265,17 +516,8 @@ class PlotWindow : public QWidget {
 		/*! List of all plot transfer threads */
 		QList<QThread*> transferThreads;
 
-		/*! Read-write lock for the main plot.
-		 * This is the only synchronization primitive used to coordinate 
-		 * the transfer threads. The threads transferring data to back 
-		 * buffers may proceed at any time, and only their swaps of the 
-		 * subplots' front and back buffers need to be synchronized with
-		 * the main plot's redraw. A read-write lock is used because there
-		 * are potentially multiple transfers happening simultaneously,
-		 * and they must all be blocked while the actual rendering of
-		 * the data occurs.
-		 */
-		QReadWriteLock lock;
+		/*! List of all subplot workers, at most one per transfer thread */
+		QList<subplotworker::SubplotWorker*> workers;
 
 }; // end PlotWindow class
 
@@ -0,0 +1,84 @@
+/*! \file profiler.h
+ *
+ * Timers for the stages of the transfer and render pipeline.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_PROFILER_H_
+#define _MEAVIEW_PROFILER_H_
+
+#include <QString>
+#include <QElapsedTimer>
+
+namespace meaview {
+
+/*! \namespace profiler
+ *
+ * The profiler namespace contains timers for the stages of the pipeline
+ * carrying data from its receipt to the screen.
+ *
+ * Timing is only compiled in when `MEAVIEW_PROFILE` is defined, e.g., with
+ * `qmake CONFIG+=meaview_profile`, and by the benchmark in tools/meaview-bench.
+ * Otherwise, `MEAVIEW_PROFILE_SCOPE` expands to nothing. Statistics are
+ * collected in global atomic counters, and may be recorded from any thread.
+ */
+namespace profiler {
+
+/*! The stages of the pipeline which are timed. */
+enum class Stage {
+	FanOut,         //!< Sending a frame to every SubplotWorker.
+	HandleNewData,  //!< Subplot::handleNewData, for a single subplot.
+	FormatPlot,     //!< Subplot::formatPlot, for a single subplot.
+	Replot,         //!< QCustomPlot::replot of the whole grid.
+	Adopt,          //!< Subplot::updateGraph, for every subplot before a replot.
+	DetectSpikes,   //!< SpikeDetector::detect, for a single subplot.
+	Filter,         //!< FilterBank::filter, for every channel of a frame.
+	NumStages
+};
+
+/*! Statistics of the time spent in one stage. */
+struct StageStats {
+	qint64 count = 0;     //!< Number of times the stage was timed.
+	qint64 totalNs = 0;   //!< Total time spent, in nanoseconds.
+	qint64 maxNs = 0;     //!< Longest single time, in nanoseconds.
+};
+
+/*! Record one time spent in a stage, in nanoseconds. */
+void record(Stage stage, qint64 ns);
+
+/*! Return the statistics of a stage since the last reset. */
+StageStats stats(Stage stage);
+
+/*! Reset the statistics of all stages. */
+void reset();
+
+/*! Return a readable name for a stage. */
+QString stageName(Stage stage);
+
+/*! \class ScopedTimer
+ *
+ * Records the time from its construction to its destruction in a stage.
+ */
+class ScopedTimer {
+	public:
+		ScopedTimer(Stage stage) : m_stage(stage) { m_timer.start(); }
+		~ScopedTimer() { record(m_stage, m_timer.nsecsElapsed()); }
+
+	private:
+		Stage m_stage;
+		QElapsedTimer m_timer;
+};
+
+}; // end profiler namespace
+}; // end meaview namespace
+
+#ifdef MEAVIEW_PROFILE
+#define MEAVIEW_PROFILE_SCOPE(stage) \
+	meaview::profiler::ScopedTimer meaviewProfileTimer(meaview::profiler::Stage::stage)
+#else
+#define MEAVIEW_PROFILE_SCOPE(stage)
+#endif
+
+#endif
+
@@ -0,0 +1,114 @@
+/*! \file rawreader.h
+ *
+ * Class for playing back data from a raw recording file mapped into memory.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_RAW_READER_H_
+#define _MEAVIEW_RAW_READER_H_
+
+#include "settings.h"
+#include "recordingreader.h"
+
+#include "data-frame.h" // for DataFrame::DataType type alias
+
+#include <QFile>
+#include <QString>
+
+#include <memory>
+
+namespace meaview {
+
+/*! \namespace rawreader
+ *
+ * The rawreader namespace contains the RawReader class, used to play
+ * back recordings stored as flat binary files without the BLDS.
+ */
+namespace rawreader {
+
+/*! \class RawReader
+ *
+ * The RawReader class reads data from a recording stored as a flat
+ * binary file, by mapping the whole file into memory.
+ *
+ * The file contains an optional header, followed by 16-bit samples in
+ * the byte order of the host, with the samples of all channels at each
+ * time point interleaved. The file is described by a JSON object in a
+ * separate file, whose name is that of the recording followed by
+ * `rawreader::MetadataSuffix`. The object must give the "nchannels",
+ * and may give the "sample-rate", "gain", "array" and "header-size",
+ * the last in bytes.
+ *
+ * Because every time point occupies the same number of bytes, the index
+ * from a time in the recording to the offset of its samples in the file
+ * is a simple affine map. Serving a request, including any jump within
+ * the recording, thus only moves a pointer into the mapping. The frames
+ * emitted are views of the mapped samples, and no data is read or copied
+ * until the transfer threads read each channel. The mapping is kept
+ * alive by any frames which refer to it.
+ */
+class RawReader : public recordingreader::RecordingReader {
+	Q_OBJECT
+
+	public:
+		/*! Construct a RawReader.
+		 *
+		 * \param filename The name of the recording file. The file is not
+		 * 	opened until the `open()` slot is called.
+		 */
+		RawReader(const QString& filename);
+
+		/*! Destroy a RawReader. The file remains mapped until any
+		 * frames viewing it are destroyed.
+		 */
+		~RawReader();
+
+	public slots:
+
+		/*! Open and map the recording file, and read its metadata. */
+		void open() override;
+
+		/*! Return a view of the data between two times in the recording.
+		 * The request is clipped to the end of the file.
+		 */
+		void requestData(double start, double stop) override;
+
+	private:
+
+		/* A file mapped into memory, which is unmapped when destroyed. */
+		struct Mapping {
+			QFile file;
+			const uchar* data = nullptr;
+		};
+
+		/* Return the index of the sample at the given time. */
+		qint64 sampleAt(double time) const;
+
+		/* Return the offset into the file of the samples at the given index. */
+		inline qint64 offsetOf(qint64 sample) const
+		{
+			return m_headerSize + sample * m_nchannels *
+				static_cast<qint64>(sizeof(DataFrame::DataType));
+		}
+
+		/* The mapped recording file. */
+		std::shared_ptr<Mapping> m_mapping;
+
+		/* Size of the header preceding the samples, in bytes. */
+		qint64 m_headerSize = 0;
+
+		/* Number of channels, and of samples of each, in the file. */
+		int m_nchannels = 0;
+		qint64 m_nsamples = 0;
+
+		/* Sample rate of the recording. */
+		double m_sampleRate = 0.;
+
+}; // end RawReader class
+
+}; // end rawreader namespace
+}; // end meaview namespace
+
+#endif
+
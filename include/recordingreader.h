@@ -0,0 +1,98 @@
+/*! \file recordingreader.h
+ *
+ * Base class for playing back data directly from a recording file.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_RECORDING_READER_H_
+#define _MEAVIEW_RECORDING_READER_H_
+
+#include "sampleframe.h"
+
+#include <QObject>
+#include <QString>
+#include <QJsonObject>
+
+namespace meaview {
+
+/*! \namespace recordingreader
+ *
+ * The recordingreader namespace contains the RecordingReader class,
+ * the interface to all readers of recording files.
+ */
+namespace recordingreader {
+
+/*! \class RecordingReader
+ *
+ * The RecordingReader class is the interface through which data is read
+ * from a recording file on disk, standing in for the BLDS when reviewing
+ * old recordings. Subclasses implement reading each format of file.
+ *
+ * Readers are intended to live in a background thread, and all
+ * communication with them happens through signals and slots.
+ */
+class RecordingReader : public QObject {
+	Q_OBJECT
+
+	public:
+		/*! Construct a RecordingReader.
+		 *
+		 * \param filename The name of the recording file. The file is not
+		 * 	opened until the `open()` slot is called.
+		 */
+		RecordingReader(const QString& filename);
+
+		/*! Destroy a RecordingReader. */
+		virtual ~RecordingReader();
+
+		/*! Return the name of the recording file. */
+		inline const QString& filename() const { return m_filename; }
+
+	signals:
+
+		/*! Emitted when the file has been opened successfully.
+		 *
+		 * \param status The status of the recording, with the same keys
+		 * 	as the source status reported by the BLDS, i.e., "device-type",
+		 * 	"nchannels", "gain", and "sample-rate", as well as the
+		 * 	"recording-length" in seconds.
+		 */
+		void opened(const QJsonObject& status);
+
+		/*! Emitted with a frame of data, in response to `requestData()`.
+		 *
+		 * \param start The time of the first sample in the frame.
+		 * \param stop The time just after the last sample in the frame.
+		 * \param frame The samples from all channels.
+		 */
+		void data(double start, double stop, const sampleframe::SampleFrame& frame);
+
+		/*! Emitted when data is requested beyond the end of the file. */
+		void endOfFile();
+
+		/*! Emitted when the file cannot be opened or read. */
+		void error(const QString& msg);
+
+	public slots:
+
+		/*! Open the recording file and read its metadata. */
+		virtual void open() = 0;
+
+		/*! Read the data between two times in the recording.
+		 * The request is clipped to the end of the file.
+		 */
+		virtual void requestData(double start, double stop) = 0;
+
+	protected:
+
+		/* Name of the recording file. */
+		QString m_filename;
+
+}; // end RecordingReader class
+
+}; // end recordingreader namespace
+}; // end meaview namespace
+
+#endif
+
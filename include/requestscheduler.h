@@ -0,0 +1,231 @@
+/*! \file requestscheduler.h
+ *
+ * Class for pipelining requests for data from the BLDS.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_REQUEST_SCHEDULER_H_
+#define _MEAVIEW_REQUEST_SCHEDULER_H_
+
+#include "blds-client.h" // from libblds-client/include, for BldsClient
+
+#include "data-frame.h"
+
+#include "latency.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include <QMap>
+#include <QElapsedTimer>
+
+namespace meaview {
+
+/*! \namespace requestscheduler
+ *
+ * The requestscheduler namespace contains the RequestScheduler class,
+ * which manages requests for data from the BLDS.
+ */
+namespace requestscheduler {
+
+/*! \class RequestScheduler
+ *
+ * The RequestScheduler class keeps a fixed number of requests for data
+ * outstanding with the BLDS, so that the network round trip and
+ * serialization of each frame overlaps with the transfer and plotting of
+ * the previous ones.
+ *
+ * While running, the scheduler requests consecutive chunks of data,
+ * issuing a new request each time a frame arrives. Frames may arrive
+ * in any order, and are emitted in the order in which they were requested,
+ * which is also the order of their start times.
+ *
+ * When following a live recording, the scheduler estimates the time of the
+ * newest available data from the wall-clock time since playback started.
+ * Frames ending more than `maxLag()` seconds before this estimate are
+ * dropped rather than plotted, and subsequent requests skip ahead, so
+ * that the display catches up with the recording.
+ *
+ * The scheduler may also be held, e.g., while the plots cannot keep up
+ * with the data, in which case outstanding requests are still delivered
+ * but no new ones are issued until it is released.
+ *
+ * Single requests, e.g., for jumping around a recording while paused,
+ * may also be made through the scheduler, so that all frames from the
+ * BLDS pass through the same path.
+ *
+ * The time from issuing each request to receiving its frame is recorded
+ * as the network latency, and each frame is emitted with the time at
+ * which it was received, so that any time spent waiting for earlier
+ * frames counts towards the latency of its transfer.
+ */
+class RequestScheduler : public QObject {
+	Q_OBJECT
+
+	public:
+		/*! Construct a RequestScheduler.
+		 *
+		 * \param client The client used to request data from the BLDS.
+		 * \param parent The parent object.
+		 */
+		RequestScheduler(BldsClient* client, QObject* parent = nullptr);
+
+		/*! Destroy a RequestScheduler. */
+		~RequestScheduler();
+
+		/*! Return the number of requests kept outstanding while running. */
+		inline int depth() const { return m_depth; }
+
+		/*! Set the number of requests kept outstanding while running. */
+		void setDepth(int depth);
+
+		/*! Return the duration of data in each request, in seconds. */
+		inline double chunkSize() const { return m_chunkSize; }
+
+		/*! Set the duration of data in each request, in seconds. */
+		void setChunkSize(double size);
+
+		/*! Return the maximum lag behind a live recording, in seconds. */
+		inline double maxLag() const { return m_maxLag; }
+
+		/*! Set the maximum lag behind a live recording, in seconds. */
+		void setMaxLag(double lag);
+
+		/*! Return true if the scheduler is continuously requesting data. */
+		inline bool isRunning() const { return m_running; }
+
+		/*! Return true if new requests are being held back. */
+		inline bool isHeld() const { return m_held; }
+
+		/*! Return the number of frames dropped for being too stale, or
+		 * because their requests failed.
+		 */
+		inline int droppedFrames() const { return m_dropped; }
+
+	signals:
+
+		/*! Emitted with each frame of data, in the order requested.
+		 *
+		 * \param frame The frame of data.
+		 * \param received The time at which the frame was received from
+		 * 	the BLDS, from `latency::now()`.
+		 */
+		void frameReady(const DataFrame& frame, qint64 received);
+
+		/*! Emitted when frames are dropped for being too stale, or
+		 * because their requests failed.
+		 *
+		 * \param total The total number of frames dropped since construction.
+		 */
+		void framesDropped(int total);
+
+	public slots:
+
+		/*! Start continuously requesting data.
+		 *
+		 * \param position The start of the first request, in seconds.
+		 * \param live True if the data at `position` is the newest available,
+		 * 	i.e., if playback is following a live recording.
+		 */
+		void start(double position, bool live);
+
+		/*! Stop requesting data. Any outstanding requests are abandoned,
+		 * and their frames are ignored when they arrive.
+		 */
+		void stop();
+
+		/*! Hold back new requests while running, or release them,
+		 * refilling the pipeline.
+		 */
+		void setHeld(bool held);
+
+		/*! Make a single request for data. This should be used while the
+		 * scheduler is stopped.
+		 */
+		void request(double start, double stop);
+
+		/*! Handle a frame of data received from the BLDS. */
+		void handleData(const DataFrame& frame);
+
+		/*! Handle an error received from the BLDS.
+		 *
+		 * An error reply to a request for data carries no frame, so the
+		 * oldest outstanding request is assumed to have failed. It is
+		 * counted as dropped, so that the frames after it are released
+		 * and the pipeline is refilled.
+		 */
+		void handleError(const QString& msg);
+
+	private:
+
+		/* Issue requests until `m_depth` are outstanding. */
+		void fillPipeline();
+
+		/* Emit any received frames which are next in request order. */
+		void releaseReadyFrames();
+
+		/* Return the estimated time of the newest data in a live recording. */
+		double liveEstimate() const;
+
+		/* Client used to make requests. */
+		QPointer<BldsClient> m_client;
+
+		/* Number of requests kept outstanding while running. */
+		int m_depth;
+
+		/* Duration of each request, in seconds. */
+		double m_chunkSize;
+
+		/* Maximum lag behind a live recording, in seconds. */
+		double m_maxLag;
+
+		/* True if continuously requesting data. */
+		bool m_running = false;
+
+		/* True if following a live recording. */
+		bool m_live = false;
+
+		/* True if new requests are held back. */
+		bool m_held = false;
+
+		/* Start of the next request. */
+		double m_next = 0.;
+
+		/* Position at which live playback started. */
+		double m_liveOrigin = 0.;
+
+		/* Time since live playback started. */
+		QElapsedTimer m_liveTimer;
+
+		/* An outstanding request for data. */
+		struct Request {
+			double start;   // Start of the requested data.
+			double stop;    // End of the requested data.
+			qint64 issued;  // Time at which the request was made.
+		};
+
+		/* A frame received, with the time at which it was received. */
+		struct Received {
+			DataFrame frame;
+			qint64 time;
+		};
+
+		/* Outstanding requests, in request order. */
+		QList<Request> m_outstanding;
+
+		/* Frames received ahead of earlier outstanding requests, keyed by
+		 * the start of the request they satisfy.
+		 */
+		QMap<double, Received> m_received;
+
+		/* Number of frames dropped for being too stale or failing. */
+		int m_dropped = 0;
+
+}; // end RequestScheduler class
+
+}; // end requestscheduler namespace
+}; // end meaview namespace
+
+#endif
+
@@ -0,0 +1,116 @@
+/*! \file samplebuffer.h
+ *
+ * Class implementing a contiguous ring buffer of raw data samples.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_SAMPLE_BUFFER_H_
+#define _MEAVIEW_SAMPLE_BUFFER_H_
+
+#include "data-frame.h" // for DataFrame::DataType type alias
+
+#include <QVector>
+
+namespace meaview {
+
+/*! \namespace samplebuffer
+ *
+ * The samplebuffer namespace contains the SampleBuffer class, used
+ * to store the raw data for a single channel.
+ */
+namespace samplebuffer {
+
+/*! \class SampleBuffer
+ *
+ * The SampleBuffer class is a fixed-capacity ring buffer of raw samples
+ * from a single channel.
+ *
+ * Storage is allocated once, when the capacity is set, and new data is
+ * written with at most two bulk copies. When the buffer is full, the
+ * oldest samples are overwritten, so that the buffer always contains the
+ * most recent `capacity()` samples.
+ *
+ * The buffer stores the raw, unscaled samples. Conversion to physical
+ * units is left to the consumer, e.g., the TraceGraph drawing the data.
+ */
+class SampleBuffer {
+
+	public:
+		/*! Construct a SampleBuffer.
+		 * \param capacity The maximum number of samples held by the buffer.
+		 */
+		SampleBuffer(int capacity = 0);
+
+		/*! Set the capacity of the buffer. This also clears the buffer. */
+		void setCapacity(int capacity);
+
+		/*! Return the maximum number of samples the buffer can hold. */
+		inline int capacity() const { return m_data.size(); }
+
+		/*! Return the number of samples currently in the buffer. */
+		inline int size() const { return m_size; }
+
+		/*! Return true if the buffer contains no samples. */
+		inline bool isEmpty() const { return m_size == 0; }
+
+		/*! Return true if the buffer holds `capacity()` samples. */
+		inline bool isFull() const { return m_size == m_data.size(); }
+
+		/*! Remove all samples from the buffer, without releasing storage. */
+		void clear();
+
+		/*! Append samples to the buffer.
+		 *
+		 * \param data Pointer to the first sample to be copied.
+		 * \param n Number of samples to copy.
+		 *
+		 * If the buffer overflows, the oldest samples are discarded.
+		 */
+		void append(const DataFrame::DataType* data, int n);
+
+		/*! Return the sample at the given index, where index 0 is the
+		 * oldest sample in the buffer.
+		 */
+		inline DataFrame::DataType at(int i) const
+		{
+			auto idx = m_start + i;
+			if (idx >= m_data.size())
+				idx -= m_data.size();
+			return m_data.at(idx);
+		}
+
+		/*! Return a pointer to the oldest contiguous run of samples,
+		 * and store its length in `length`.
+		 */
+		const DataFrame::DataType* firstSegment(int& length) const;
+
+		/*! Return a pointer to the newer contiguous run of samples, if
+		 * the buffer has wrapped, and store its length in `length`. If
+		 * the buffer has not wrapped, `length` is 0.
+		 */
+		const DataFrame::DataType* secondSegment(int& length) const;
+
+		/*! Swap the contents of this buffer with another. This is constant time. */
+		void swap(SampleBuffer& other);
+
+	private:
+
+		/* Storage for the samples. The size of this vector is the
+		 * capacity of the buffer.
+		 */
+		QVector<DataFrame::DataType> m_data;
+
+		/* Index of the oldest sample in the storage. */
+		int m_start = 0;
+
+		/* Number of valid samples in the buffer. */
+		int m_size = 0;
+
+}; // end SampleBuffer class
+
+}; // end samplebuffer namespace
+}; // end meaview namespace
+
+#endif
+
@@ -0,0 +1,157 @@
+/*! \file sampleframe.h
+ *
+ * Class for sharing a single frame of data among all subplots.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_SAMPLE_FRAME_H_
+#define _MEAVIEW_SAMPLE_FRAME_H_
+
+#include "data-frame.h" // for DataFrame::Samples type alias
+
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <memory>
+
+namespace meaview {
+
+/*! \namespace sampleframe
+ *
+ * The sampleframe namespace contains the SampleFrame class, used to
+ * hand a frame of data to the transfer threads.
+ */
+namespace sampleframe {
+
+/*! \class SampleFrame
+ *
+ * The SampleFrame class is an immutable, reference-counted frame of raw
+ * samples from all channels.
+ *
+ * The samples are stored once, with each channel contiguous, and every
+ * copy of a SampleFrame refers to the same storage. A frame can thus be
+ * passed by value through queued connections to any number of transfer
+ * threads, each of which reads its channels in place. The storage is
+ * released when the last copy is destroyed. Because the samples are never
+ * modified after construction, no synchronization is needed to read them.
+ *
+ * A frame may also be a view of samples owned elsewhere, e.g., in a file
+ * mapped into memory, in which case the samples of all channels are
+ * interleaved rather than contiguous, and `stride()` is the number of
+ * channels. The owner of the samples is kept alive by every copy of
+ * the frame.
+ *
+ * Each frame also carries the time at which it was received, from
+ * `latency::now()`, so that the latency from receipt to the screen
+ * can be measured when it is finally drawn.
+ */
+class SampleFrame {
+
+	public:
+		/*! Construct an empty SampleFrame. */
+		SampleFrame();
+
+		/*! Construct a SampleFrame holding a copy of the given samples.
+		 *
+		 * \param samples Matrix of samples, with one column per channel.
+		 */
+		explicit SampleFrame(const DataFrame::Samples& samples);
+
+		/*! Construct a SampleFrame taking ownership of the given samples,
+		 * without copying them.
+		 *
+		 * \param samples Matrix of samples, with one column per channel.
+		 */
+		explicit SampleFrame(DataFrame::Samples&& samples);
+
+		/*! Construct a SampleFrame viewing interleaved samples, without
+		 * copying them.
+		 *
+		 * \param data Pointer to the first sample of the first channel. The
+		 * 	samples of each time point are consecutive, one per channel.
+		 * \param nsamples The number of samples of each channel.
+		 * \param nchannels The number of channels.
+		 * \param owner The owner of the samples, which is kept alive as
+		 * 	long as any copy of this frame.
+		 */
+		SampleFrame(const DataFrame::DataType* data, int nsamples, int nchannels,
+				const std::shared_ptr<const void>& owner);
+
+		/*! Return true if the frame holds no samples. */
+		inline bool isEmpty() const { return (nsamples() == 0); }
+
+		/*! Return the number of samples of each channel in the frame. */
+		inline int nsamples() const 
+		{
+			if (!m_samples)
+				return 0;
+			return static_cast<int>(m_interleaved ? m_samples->n_cols : m_samples->n_rows);
+		}
+
+		/*! Return the number of channels in the frame. */
+		inline int nchannels() const
+		{
+			if (!m_samples)
+				return 0;
+			return static_cast<int>(m_interleaved ? m_samples->n_rows : m_samples->n_cols);
+		}
+
+		/*! Return the distance between consecutive samples of one channel. */
+		inline int stride() const
+		{
+			return (m_interleaved ? nchannels() : 1);
+		}
+
+		/*! Return a pointer to the first sample of a single channel.
+		 * Consecutive samples of the channel are `stride()` apart.
+		 */
+		inline const DataFrame::DataType* channel(int chan) const
+		{
+			return (m_interleaved ? m_samples->memptr() + chan : m_samples->colptr(chan));
+		}
+
+		/*! Return a pointer to the contiguous samples of a single channel.
+		 *
+		 * If the channel's samples are not contiguous in the frame, they
+		 * are first gathered into the given buffer.
+		 */
+		const DataFrame::DataType* contiguousChannel(int chan,
+				QVector<DataFrame::DataType>* buffer) const;
+
+		/*! Return the time at which the frame was received, from
+		 * `latency::now()`, or 0 if it was never set.
+		 */
+		inline qint64 received() const { return m_received; }
+
+		/*! Set the time at which the frame was received. This applies
+		 * only to this copy of the frame.
+		 */
+		inline void setReceived(qint64 time) { m_received = time; }
+
+	private:
+
+		/* Shared storage for the samples. For an interleaved frame, this
+		 * is a view of the samples, with one column per time point.
+		 */
+		QSharedPointer<const DataFrame::Samples> m_samples;
+
+		/* True if the samples of all channels are interleaved. */
+		bool m_interleaved = false;
+
+		/* Owner of the samples viewed by an interleaved frame. */
+		std::shared_ptr<const void> m_owner;
+
+		/* Time at which the frame was received. */
+		qint64 m_received = 0;
+
+}; // end SampleFrame class
+
+}; // end sampleframe namespace
+}; // end meaview namespace
+
+Q_DECLARE_METATYPE(meaview::sampleframe::SampleFrame);
+
+#endif
+
@@ -0,0 +1,112 @@
+/*! \file samplekernels.h
+ *
+ * Vectorized kernels for reducing and searching runs of raw samples.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_SAMPLE_KERNELS_H_
+#define _MEAVIEW_SAMPLE_KERNELS_H_
+
+#include "data-frame.h" // for DataFrame::DataType type alias
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <limits>
+
+namespace meaview {
+
+/*! \namespace samplekernels
+ *
+ * The samplekernels namespace contains the inner loops run over every
+ * sample as it is transferred, in the transfer threads.
+ *
+ * Each kernel has an AVX2 and an SSE2 implementation for 16-bit samples,
+ * and a scalar fallback. The implementation is chosen when compiling,
+ * from the instruction sets enabled for the target: SSE2 is always
+ * available on x86-64, and AVX2 is used when building with
+ * `qmake CONFIG+=meaview_avx2`. All implementations give identical
+ * results.
+ */
+namespace samplekernels {
+
+/*! \class Summary
+ *
+ * The extrema, sum and sum of squares of a run of raw samples, which may
+ * be accumulated over successive chunks of data. The sums are exact, and
+ * may be turned into statistics with channelstats::SummaryStats.
+ */
+class Summary {
+
+	public:
+		/*! Return true if no samples have been accumulated. */
+		inline bool isEmpty() const { return count == 0; }
+
+		/*! Return the mean of the raw samples, or 0 if there are none. */
+		inline double mean() const
+		{
+			return (count > 0) ? (static_cast<double>(sum) / count) : 0.0;
+		}
+
+		/*! Merge the summary of a following run of samples into this one. */
+		inline void merge(const Summary& other)
+		{
+			min = std::min(min, other.min);
+			max = std::max(max, other.max);
+			sum += other.sum;
+			sumSquares += other.sumSquares;
+			count += other.count;
+		}
+
+		/*! Remove all samples from the summary. */
+		inline void clear() { *this = Summary(); }
+
+		/*! Smallest raw sample. */
+		DataFrame::DataType min = std::numeric_limits<DataFrame::DataType>::max();
+
+		/*! Largest raw sample. */
+		DataFrame::DataType max = std::numeric_limits<DataFrame::DataType>::lowest();
+
+		/*! Sum of the raw samples. */
+		qint64 sum = 0;
+
+		/*! Sum of the squares of the raw samples. */
+		qint64 sumSquares = 0;
+
+		/*! Number of samples. */
+		qint64 count = 0;
+
+}; // end Summary class
+
+/*! Accumulate the extrema and sums of a run of samples into a summary.
+ *
+ * \param data The samples.
+ * \param n The number of samples.
+ * \param summary The summary into which the samples are merged.
+ */
+void summarize(const DataFrame::DataType* data, int n, Summary* summary);
+
+/*! Return the index of the first sample below a level.
+ *
+ * \param data The samples.
+ * \param n The number of samples.
+ * \param level The level, which the sample found is strictly less than.
+ * \return The index of the first sample less than `level`, or `n` if
+ * 	there is none.
+ *
+ * Runs without such a sample, the common case when searching for
+ * threshold crossings, are scanned a full vector at a time.
+ */
+int findBelow(const DataFrame::DataType* data, int n, DataFrame::DataType level);
+
+/*! Return the name of the instruction set used by the kernels,
+ * "avx2", "sse2" or "scalar".
+ */
+const char* instructionSet();
+
+}; // end samplekernels namespace
+}; // end meaview namespace
+
+#endif
+
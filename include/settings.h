@@ -31,6 +31,12 @@ const double McsSampleRate = 10000;
 /*! Default sample rate for HiDens data */
 const double HiDensSampleRate = 20000;
 
+/*! Largest number of channels recorded from an MCS array. Recording files
+ * which do not name their array, and have more channels, are assumed
+ * to be from a HiDens array.
+ */
+const int MaxMcsChannels = 64;
+
 namespace meaviewwindow {
 
 	/*! The window position, upper left corner */
@@ -70,6 +76,12 @@ namespace meaviewwindow {
 	/*! Size of data chunks to request, in *milliseconds*. */
 	const int DataChunkRequestSize = 100;
 
+	/*! Default number of requests for data kept outstanding during playback. */
+	const int DefaultRequestDepth = 4;
+
+	/*! Maximum lag behind a live recording before frames are dropped, in seconds. */
+	const double MaxLiveLag = 2.0;
+
 }; // end meaviewwindow namespace
 
 namespace plotwindow {
@@ -77,6 +89,44 @@ namespace plotwindow {
 	/*! Default plot refresh interval in seconds. */
 	const double DefaultRefreshInterval = 2.0;
 
+	/*! Render subplots into tiles in the transfer threads by default. */
+	const bool DefaultTileRendering = true;
+
+	/*! Largest number of frames sent to the transfer threads but not yet
+	 * handled by all of them. Further frames wait in the plot window.
+	 */
+	const int MaxFramesInFlight = 2;
+
+	/*! Largest number of frames waiting in the plot window to be sent
+	 * to the transfer threads, before the backpressure policy drops any.
+	 */
+	const int MaxPendingFrames = 8;
+
+	/*! Names of the policies for handling frames arriving faster than
+	 * they can be plotted, as stored in the "playback/backpressure"
+	 * setting, and their descriptions in the interface.
+	 */
+	const QStringList BackpressurePolicyNames = {
+		"drop-oldest", "skip-to-latest", "throttle"
+	};
+	const QStringList BackpressurePolicyDescriptions = {
+		"Drop oldest frames", "Skip to newest frame", "Slow down requests"
+	};
+
+	/*! Default policy for handling frames arriving faster than they
+	 * can be plotted. Throttling never drops data read from a file.
+	 */
+	const QString DefaultBackpressurePolicy = "throttle";
+
+	/*! Default target rate at which the grid is replotted, in frames
+	 * per second, as stored in the "display/frame-rate" setting.
+	 */
+	const double DefaultFrameRate = 30.0;
+
+	/*! Minimum and maximum target frame rates. */
+	const double MinFrameRate = 1.0;
+	const double MaxFrameRate = 120.0;
+
 	/*! Minimum plot refresh interval in seconds */
 	const double MinRefreshInterval = 0.5;
 
@@ -235,8 +285,154 @@ namespace subplot {
 	/* Color of lines and labels */
 	const QColor LabelColor { 255, 255, 255 };
 
+	/*! Number of envelope columns used before a subplot's width is known */
+	const int DefaultEnvelopeColumns = 256;
+
+	/*! Width in pixels of the gap marking the position of a sweep */
+	const int SweepCursorWidth = 4;
+
 }; // end subplot namespace
 
+namespace spikedetector {
+
+	/*! True if spikes are detected by default. */
+	const bool DefaultDetection = true;
+
+	/*! Default threshold, in multiples of each channel's noise level. */
+	const double DefaultThreshold = 4.5;
+
+	/*! Time after a detected spike, in seconds, during which no other
+	 * spike is detected on the same channel.
+	 */
+	const double RefractoryPeriod = 0.001;
+
+	/*! Duration of the rolling window from which noise is estimated, in seconds. */
+	const double NoiseWindow = 2.0;
+
+	/*! Number of samples kept from the noise window. The window is
+	 * subsampled evenly to this size, whatever the sample rate.
+	 */
+	const int NoiseWindowSamples = 2048;
+
+	/*! Interval between estimates of the noise, in seconds. */
+	const double NoiseUpdateInterval = 0.25;
+
+	/*! Factor converting the median absolute deviation of Gaussian
+	 * noise to its standard deviation.
+	 */
+	const double MadToStandardDeviation = 1.4826;
+
+}; // end spikedetector namespace
+
+namespace activitymap {
+
+	/*! Names of the measures by which cells of the activity map may be
+	 * colored, as stored in the "display/activity-measure" setting, and
+	 * their descriptions in the interface.
+	 */
+	const QStringList MeasureNames = { "rms", "spike-rate" };
+	const QStringList MeasureDescriptions = { "RMS", "Spike rate" };
+
+	/*! Default measure by which cells are colored. */
+	const QString DefaultMeasure = "rms";
+
+	/*! Time constant over which the activity of each channel is averaged,
+	 * in seconds.
+	 */
+	const double TimeConstant = 1.0;
+
+	/*! Factor by which the top of the color scale decays on each frame,
+	 * when the activity falls. The scale rises at once with the activity.
+	 */
+	const double ScaleDecay = 0.99;
+
+	/*! Fraction of the space between electrodes covered by each cell. */
+	const double CellFill = 0.9;
+
+	/*! Smallest size of a cell, in pixels. */
+	const int MinCellSize = 2;
+
+	/*! Space between the cells and the edges of the map, in pixels. */
+	const int Margin = 20;
+
+	/*! Color of cells showing no activity. The color scale runs through
+	 * red and yellow to white.
+	 */
+	const QColor ColdColor { 30, 30, 30 };
+
+}; // end activitymap namespace
+
+namespace spikestore {
+
+	/*! Memory given to the times of stored spikes, in bytes. At 8 bytes
+	 * per spike, this holds a few minutes of spikes from every channel
+	 * of a HiDens array firing at tens of Hz. The arrays holding them
+	 * may take up to twice this, from growth and aged-out spikes.
+	 */
+	const qint64 MemoryBudget = 64 << 20;
+
+	/*! Fraction of the capacity to which the store is reduced when it
+	 * is full, by aging out the oldest spikes.
+	 */
+	const double AgeOutFraction = 0.75;
+
+}; // end spikestore namespace
+
+namespace spikeraster {
+
+	/*! Default duration of the window of time shown by the raster, in seconds. */
+	const double DefaultWindow = 10.0;
+
+	/*! Smallest and largest duration of the window, in seconds. */
+	const double MinWindow = 1.0;
+	const double MaxWindow = 120.0;
+
+	/*! Color of the mark drawn for each spike. */
+	const QColor SpikeColor { 255, 255, 255 };
+
+	/*! Space between the raster and the edges of the widget, in pixels. */
+	const int Margin = 20;
+
+	/*! Minimum height of the widget, in pixels. */
+	const int MinimumHeight = 150;
+
+}; // end spikeraster namespace
+
+namespace bandpass {
+
+	/*! True if the raw samples are bandpass filtered by default. */
+	const bool DefaultFiltering = false;
+
+	/*! Default low and high cutoff frequencies of the filter, in Hz. */
+	const double DefaultLowCutoff = 300.0;
+	const double DefaultHighCutoff = 5000.0;
+
+	/*! Lowest low cutoff, in Hz. Lower cutoffs put the poles of the
+	 * highpass too close to 1 for single-precision coefficients.
+	 */
+	const double MinLowCutoff = 10.0;
+
+	/*! Highest cutoff, as a fraction of the sample rate. */
+	const double MaxCutoffFraction = 0.45;
+
+	/*! Order of each of the highpass and lowpass Butterworth filters
+	 * making up the bandpass. Each takes half this many biquads.
+	 */
+	const int FilterOrder = 4;
+
+	/*! Number of channels and samples in each tile filtered at once. */
+	const int ChannelsPerTile = 64;
+	const int SamplesPerTile = 64;
+
+}; // end bandpass namespace
+
+namespace gridplot {
+
+	/*! Name of the layer holding the graphs of all subplots. */
+	const QString TraceLayerName = "traces";
+
+}; // end gridplot namespace
+
 namespace channelinspector {
 
 	/*! Size of a new channel inspector window */
@@ -256,6 +452,22 @@ namespace channelinspector {
 	/*! Color of lines and labels */
 	const QColor LabelColor { 255, 255, 255 };
 
+	/*! Number of bins in each level of an inspected channel's history.
+	 * The lowest level holds this many raw samples.
+	 */
+	const int HistoryLevelSize = 1 << 14;
+
+	/*! Number of bins of one level of the history summarized by each
+	 * bin of the next level.
+	 */
+	const int HistoryDecimationFactor = 4;
+
+	/*! Number of levels in an inspected channel's history. With the values
+	 * above, this covers about 3.7 hours of HiDens data, using about half a
+	 * megabyte per channel.
+	 */
+	const int HistoryLevels = 8;
+
 }; // end channelinspector namespace
 
 namespace configwindow {
@@ -277,6 +489,41 @@ namespace configwindow {
 
 }; // end configwindow namespace
 
+namespace hdf5reader {
+
+	/*! Name of the dataset holding the samples in a recording file. */
+	const QString DatasetName = "data";
+
+	/*! Number of samples along the time axis in each read from a
+	 * dataset which is not chunked.
+	 */
+	const int DefaultReadLength = 20000;
+
+	/*! Minimum number of dataset chunks read from the file at once.
+	 * Requests are then served from these chunks until they are exhausted.
+	 */
+	const int ReadAheadChunks = 2;
+
+}; // end hdf5reader namespace
+
+namespace rawreader {
+
+	/*! Suffix appended to the name of a raw recording file to give the
+	 * name of the JSON file describing its contents.
+	 */
+	const QString MetadataSuffix = ".json";
+
+}; // end rawreader namespace
+
+namespace latency {
+
+	/*! Number of recent values of each latency from which percentiles
+	 * are computed.
+	 */
+	const int WindowSize = 512;
+
+}; // end latency namespace
+
 }; // end meaview namespace
 
 #endif
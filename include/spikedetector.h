@@ -0,0 +1,194 @@
+/*! \file spikedetector.h
+ *
+ * Threshold detection of spikes in the data of a single channel.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_SPIKE_DETECTOR_H_
+#define _MEAVIEW_SPIKE_DETECTOR_H_
+
+#include "data-frame.h" // for DataFrame::DataType type alias
+
+#include <QMetaType>
+#include <QVector>
+#include <QtGlobal>
+
+#include <limits>
+
+namespace meaview {
+
+/*! \namespace spikedetector
+ *
+ * The spikedetector namespace contains the SpikeDetector class, which
+ * finds spikes in each channel as its data is transferred, and the Spike
+ * events it produces.
+ */
+namespace spikedetector {
+
+/*! \struct Spike
+ *
+ * A single spike detected on one channel.
+ *
+ * Spikes are the only output of detection, so that views of spiking
+ * activity never need the raw samples.
+ */
+struct Spike {
+
+	/*! Index of the sample at which the threshold was crossed, counting
+	 * all samples of the channel received since the detector was created.
+	 * Dividing by the sample rate gives the time of the spike in seconds.
+	 */
+	qint64 sample;
+
+	/*! Data channel on which the spike was detected. */
+	qint32 channel;
+
+	/*! Smallest raw sample in the refractory period after the crossing,
+	 * i.e., the trough of the spike. Multiply by the gain for volts.
+	 */
+	DataFrame::DataType amplitude;
+
+}; // end Spike struct
+
+/*! A batch of spikes. Spikes of the same channel are in order of time. */
+typedef QVector<Spike> SpikeList;
+
+/*! \class SpikeDetector
+ *
+ * The SpikeDetector class detects spikes in the stream of samples from
+ * one channel, by finding where they cross a threshold below the noise.
+ *
+ * The noise level is estimated robustly from the median absolute
+ * deviation (MAD) of the samples from their median, which is hardly
+ * affected by the spikes themselves. The estimate is made over a rolling
+ * window of recent samples, subsampled to a fixed size, and updated at
+ * regular intervals rather than on every chunk.
+ *
+ * Extracellular spikes are negative-going, so a spike is detected where
+ * a sample falls below the median by more than the threshold, given in
+ * multiples of the noise's standard deviation. No other spike is detected
+ * on the channel for a short refractory period after each one. Each chunk
+ * is scanned for crossings a vector of samples at a time, with
+ * `samplekernels::findBelow()`. No spikes are detected until the first
+ * estimate of the noise has been made.
+ *
+ * A detector must only be used from one thread.
+ */
+class SpikeDetector {
+
+	public:
+		/*! Construct a SpikeDetector. It detects nothing until configured. */
+		SpikeDetector();
+
+		/*! Configure the detector.
+		 *
+		 * \param sampleRate The sample rate of the channel.
+		 * \param threshold The threshold, in multiples of the noise level.
+		 *
+		 * Changing the sample rate discards the noise estimate, while
+		 * changing only the threshold applies it to the current estimate.
+		 * This is cheap if neither changes, and may be called for each chunk.
+		 */
+		void configure(double sampleRate, double threshold);
+
+		/*! Detect spikes in the next chunk of samples.
+		 *
+		 * \param data The samples, which follow those of the last call.
+		 * \param n The number of samples.
+		 * \param channel The channel of the samples, copied into each spike.
+		 * \param spikes List to which detected spikes are appended.
+		 * \return The number of spikes detected.
+		 */
+		int detect(const DataFrame::DataType* data, int n, int channel,
+				SpikeList* spikes);
+
+		/*! Skip the next chunk of samples without detecting spikes in it,
+		 * so that the sample indices of later spikes remain correct.
+		 */
+		void skip(int n);
+
+		/*! Discard the noise estimate, keeping the count of samples. */
+		void reset();
+
+		/*! Return the number of samples received. */
+		inline qint64 position() const { return m_position; }
+
+		/*! Return the median of the samples in the noise window, in raw units. */
+		inline double median() const { return m_median; }
+
+		/*! Return the estimated standard deviation of the noise, in raw
+		 * units, or 0 if it has not yet been estimated.
+		 */
+		inline double noise() const { return m_noise; }
+
+	private:
+
+		/* Add a chunk of samples to the noise window. */
+		void sampleNoise(const DataFrame::DataType* data, int n);
+
+		/* Estimate the noise from the window, and update the level. */
+		void estimateNoise();
+
+		/* Compute the level below which samples cross the threshold. */
+		void updateLevel();
+
+		/* Sample rate, or 0 if not yet configured. */
+		double m_sampleRate = 0.0;
+
+		/* Threshold, in multiples of the noise. */
+		double m_threshold = 0.0;
+
+		/* Number of samples in the refractory period. */
+		int m_refractory = 1;
+
+		/* Distance between the samples kept in the noise window. */
+		int m_stride = 1;
+
+		/* Number of samples between estimates of the noise. */
+		int m_updateInterval = 1;
+
+		/* Number of samples received. */
+		qint64 m_position = 0;
+
+		/* Index of the first sample after the current refractory period. */
+		qint64 m_refractoryEnd = 0;
+
+		/* Index into the next chunk of the next sample kept for the window. */
+		int m_phase = 0;
+
+		/* Number of samples received since the last estimate of the noise. */
+		int m_sinceUpdate = 0;
+
+		/* Ring buffer of the samples kept from the noise window. */
+		QVector<DataFrame::DataType> m_window;
+
+		/* Position in the ring buffer of the next sample kept. */
+		int m_windowPosition = 0;
+
+		/* Number of valid samples in the ring buffer. */
+		int m_windowSize = 0;
+
+		/* Scratch space for computing medians. */
+		QVector<int> m_scratch;
+
+		/* Median of the noise window. */
+		double m_median = 0.0;
+
+		/* Standard deviation of the noise. */
+		double m_noise = 0.0;
+
+		/* Samples below this level cross the threshold. Nothing is
+		 * below the initial level, so no spikes are detected.
+		 */
+		DataFrame::DataType m_level = std::numeric_limits<DataFrame::DataType>::lowest();
+
+}; // end SpikeDetector class
+
+}; // end spikedetector namespace
+}; // end meaview namespace
+
+Q_DECLARE_METATYPE(meaview::spikedetector::SpikeList);
+
+#endif
+
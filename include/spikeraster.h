@@ -0,0 +1,177 @@
+/*! \file spikeraster.h
+ *
+ * Widget showing the recent spikes on every channel as a scrolling raster.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_SPIKE_RASTER_H_
+#define _MEAVIEW_SPIKE_RASTER_H_
+
+#include "settings.h"
+#include "channelstats.h"
+#include "displayconfig.h"
+#include "spikedetector.h"
+#include "spikestore.h"
+
+#include <QWidget>
+#include <QImage>
+#include <QRect>
+#include <QSettings>
+#include <QSize>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+namespace meaview {
+
+/*! \namespace spikeraster
+ *
+ * The spikeraster namespace contains the SpikeRaster class, which shows
+ * the spikes detected on all channels over a window of recent time.
+ */
+namespace spikeraster {
+
+/*! \class SpikeRaster
+ *
+ * The SpikeRaster class draws one row per channel, with a mark at the
+ * time of each spike detected on the channel, over a window of time
+ * ending at the latest data received. The raster scrolls as data arrives,
+ * and stops when playback is paused.
+ *
+ * Spikes are kept in a spikestore::SpikeStore, whose oldest spikes age
+ * out to keep it within `spikestore::MemoryBudget`. Spikes are kept while
+ * the raster is hidden, so that it is full when shown again.
+ *
+ * The time of the latest data is followed from the activity measured on
+ * each channel, since spikes alone don't say how much data has passed
+ * without any. Both spikes and activity are counted in samples since the
+ * subplots were set up, as is the time of every spike.
+ *
+ * The raster is drawn into an image, setting the pixels of each mark
+ * directly, at most at the display frame rate and only when visible.
+ * Scrolling the mouse wheel over the raster changes the window shown,
+ * which is kept in the "display/raster-window" setting.
+ */
+class SpikeRaster : public QWidget {
+	Q_OBJECT
+
+	public:
+		/*! Construct a SpikeRaster. */
+		SpikeRaster(QWidget* parent = nullptr);
+
+		/*! Destroy a SpikeRaster. */
+		~SpikeRaster();
+
+		/*! Set up the raster for the given number of channels.
+		 *
+		 * \param array The type of array from which data is recorded.
+		 * \param nchannels The number of channels in the data.
+		 */
+		void setupRaster(const QString& array, int nchannels);
+
+		/*! Return the duration of the window of time shown, in seconds. */
+		inline double window() const { return windowDuration; }
+
+		/*! Set the duration of the window of time shown, in seconds. */
+		void setWindow(double duration);
+
+		/*! Set the rate at which the raster is repainted, in frames per second. */
+		void setFrameRate(double rate);
+
+		/*! Return the store holding the spikes shown. */
+		inline const spikestore::SpikeStore& spikes() const { return store; }
+
+		/*! Return the preferred size of the raster. */
+		QSize sizeHint() const override;
+
+	public slots:
+
+		/*! Add a batch of detected spikes. */
+		void handleSpikes(const spikedetector::SpikeList& spikes);
+
+		/*! Follow the data received on a range of channels. */
+		void handleActivity(const channelstats::ActivityList& activity);
+
+		/*! Remove all channels and spikes. */
+		void clear();
+
+	protected:
+
+		/*! Paint the raster and its labels. */
+		void paintEvent(QPaintEvent* event) override;
+
+		/*! Draw the raster again in the new size of the widget. */
+		void resizeEvent(QResizeEvent* event) override;
+
+		/*! Start repainting at the frame rate. */
+		void showEvent(QShowEvent* event) override;
+
+		/*! Stop repainting while the raster cannot be seen. */
+		void hideEvent(QHideEvent* event) override;
+
+		/*! Widen or narrow the window of time shown. */
+		void wheelEvent(QWheelEvent* event) override;
+
+		/*! Show the channel and number of spikes of the row under the mouse. */
+		bool event(QEvent* event) override;
+
+	private slots:
+
+		/*! Draw the raster again if data has arrived since the last frame. */
+		void handleFrameTick();
+
+	private:
+
+		/*! Return the rectangle of the widget in which spikes are drawn. */
+		QRect rasterRect() const;
+
+		/*! Return the number of samples in the window of time shown. */
+		qint64 windowSamples();
+
+		/*! Return the channel of the row containing a point, or -1 if none does. */
+		int channelAt(const QPoint& point) const;
+
+		/*! Draw the spikes in the window into the image. */
+		void render();
+
+		/*! Type of array from which data is recorded. */
+		QString array;
+
+		/*! Number of channels. */
+		int nchannels = 0;
+
+		/*! Spikes of all channels. */
+		spikestore::SpikeStore store;
+
+		/*! Number of samples received on each channel. */
+		QVector<qint64> received;
+
+		/*! Time of the latest data received on any channel, in samples. */
+		qint64 now = 0;
+
+		/*! Duration of the window of time shown, in seconds. */
+		double windowDuration;
+
+		/*! Image into which spikes are drawn. */
+		QImage image;
+
+		/*! True if data has arrived since the raster was last drawn. */
+		bool dirty = false;
+
+		/*! Timer ticking at the frame rate. */
+		QTimer* frameTimer;
+
+		/*! Snapshot of the display settings. */
+		displayconfig::Reader config;
+
+		/*! Global settings. */
+		QSettings settings;
+
+}; // end SpikeRaster class
+
+}; // end spikeraster namespace
+}; // end meaview namespace
+
+#endif
+
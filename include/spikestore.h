@@ -0,0 +1,140 @@
+/*! \file spikestore.h
+ *
+ * Bounded, time-indexed store of the spikes detected on each channel.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_SPIKE_STORE_H_
+#define _MEAVIEW_SPIKE_STORE_H_
+
+#include "spikedetector.h"
+
+#include <QVector>
+#include <QtGlobal>
+
+namespace meaview {
+
+/*! \namespace spikestore
+ *
+ * The spikestore namespace contains the SpikeStore class, which holds
+ * the recent spikes of every channel for views of spiking activity.
+ */
+namespace spikestore {
+
+/*! \class SpikeStore
+ *
+ * The SpikeStore class holds the times of the spikes detected on each
+ * channel, as the sample indices at which they were detected.
+ *
+ * Each channel's times are kept in order in a single array, to which
+ * spikes are only ever appended, so that appending is amortized constant
+ * time, and the spikes of a channel in any range of time are found with
+ * two binary searches, as one contiguous run of times.
+ *
+ * The store holds at most `capacity()` spikes in total. When appending
+ * exceeds that, the oldest spikes of all channels are aged out together,
+ * down to a fraction of the capacity, so that the store always spans the
+ * same recent stretch of time on every channel. Aged-out spikes are only
+ * skipped over, and their storage is reclaimed once they make up half of
+ * a channel's array, so aging out is also amortized constant time per spike.
+ */
+class SpikeStore {
+
+	public:
+		/*! Construct a SpikeStore.
+		 *
+		 * \param capacity The largest number of spikes held.
+		 */
+		explicit SpikeStore(qint64 capacity);
+
+		/*! Remove all spikes, and hold spikes from the given number of channels. */
+		void reset(int nchannels);
+
+		/*! Return the number of channels. */
+		inline int nchannels() const { return m_channels.size(); }
+
+		/*! Return the number of spikes held. */
+		inline qint64 size() const { return m_size; }
+
+		/*! Return the largest number of spikes held. */
+		inline qint64 capacity() const { return m_capacity; }
+
+		/*! Set the largest number of spikes held, aging out spikes if needed. */
+		void setCapacity(qint64 capacity);
+
+		/*! Return the number of spikes aged out since the last reset. */
+		inline qint64 agedOut() const { return m_agedOut; }
+
+		/*! Return the time of the latest spike appended, or -1 if none has been. */
+		inline qint64 latest() const { return m_latest; }
+
+		/*! Return the time before which spikes have been aged out, i.e.,
+		 * the start of the span of time held on every channel.
+		 */
+		inline qint64 horizon() const { return m_horizon; }
+
+		/*! Append a batch of spikes.
+		 *
+		 * Spikes must arrive in order of time on each channel. A spike on
+		 * an unknown channel, earlier than the last on its channel or than
+		 * the horizon, is ignored.
+		 */
+		void append(const spikedetector::SpikeList& spikes);
+
+		/*! Return the times of the spikes on a channel in a range of time.
+		 *
+		 * \param channel The channel.
+		 * \param begin The first time in the range.
+		 * \param end The time after the last in the range.
+		 * \param count Set to the number of spikes in the range.
+		 * \return Pointer to the first of `count` consecutive times, in order,
+		 * 	which remains valid until the store is next modified.
+		 */
+		const qint64* range(int channel, qint64 begin, qint64 end, int* count) const;
+
+		/*! Return the number of spikes on a channel in a range of time. */
+		int count(int channel, qint64 begin, qint64 end) const;
+
+		/*! Age out all spikes earlier than the given time. */
+		void ageOutBefore(qint64 time);
+
+	private:
+
+		/* The spikes of one channel. Times before `head` are aged out. */
+		struct Channel {
+			QVector<qint64> times;
+			int head = 0;
+		};
+
+		/* Return the number of spikes held at or after a time, on all channels. */
+		qint64 countFrom(qint64 time) const;
+
+		/* Age out spikes until the store is within its capacity. */
+		void enforceCapacity();
+
+		/* Spikes of each channel. */
+		QVector<Channel> m_channels;
+
+		/* Number of spikes held. */
+		qint64 m_size = 0;
+
+		/* Largest number of spikes held. */
+		qint64 m_capacity;
+
+		/* Number of spikes aged out. */
+		qint64 m_agedOut = 0;
+
+		/* Time of the latest spike. */
+		qint64 m_latest = -1;
+
+		/* Time before which spikes have been aged out. */
+		qint64 m_horizon = 0;
+
+}; // end SpikeStore class
+
+}; // end spikestore namespace
+}; // end meaview namespace
+
+#endif
+
@@ -10,13 +10,28 @@
 
 #include "settings.h"
 #include "qcustomplot.h"
+#include "samplebuffer.h"
+#include "decimator.h"
+#include "lodpyramid.h"
+#include "spikedetector.h"
+#include "channelstats.h"
+#include "tracegraph.h"
+#include "traceblock.h"
+#include "sampleframe.h"
+#include "displayconfig.h"
+#include "profiler.h"
 
 #include "data-frame.h" // for DataFrame::DataType type alias
 
 #include <QPair>
 #include <QString>
 #include <QSettings>
-#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QImage>
+#include <QPen>
+
+#include <atomic>
+#include <memory>
 
 namespace meaview {
 
@@ -43,6 +58,13 @@ namespace subplot {
  * until the `deleted()` signal has been received. This ensures that
  * the Subplot has released any references to these objects, and that
  * no races occur.
+ *
+ * The transfer thread never touches the graph or axes directly. Each
+ * time new data is ready to be drawn, it publishes a TraceBlock, holding
+ * the data, axis ranges and possibly a pre-rendered tile, and the GUI
+ * thread adopts the newest block into the graph with `updateGraph()`
+ * just before replotting. The blocks are handed over through an atomic
+ * pointer, so neither thread ever waits for the other.
  */
 class Subplot : public QObject {
 	Q_OBJECT
@@ -90,15 +112,58 @@ class Subplot : public QObject {
 		/*! Return the graph object responsible for managing and plotting 
 		 * the actual channel data.
 		 */
-		inline QCPGraph* graph() const { return m_graph; } 
+		inline tracegraph::TraceGraph* graph() const { return m_graph; } 
 
 		/*! Return the axis rectange in which this Subplot draws 
 		 * its data
 		 */
 		inline QCPAxisRect* rect() const { return m_rect; }
 
-		/*! Format this subplot for plotting, e.g. rescale axes and set pens.  */
-		void formatPlot(bool clicked);
+		/*! Return the multi-resolution history of this subplot's channel.
+		 * The history is empty unless it has been enabled with `enableHistory()`.
+		 */
+		inline QSharedPointer<lodpyramid::LodPyramid> history() const { return m_history; }
+
+		/*! Return the number of samples in a plot block. */
+		inline int plotBlockSize() const { return m_plotBlockSize; }
+
+		/*! Return the activity on this subplot's channel during the last
+		 * chunk of data, as of the last call to `handleNewData()`.
+		 */
+		inline const channelstats::Activity& activity() const { return m_activity; }
+
+		/*! Set the pen of this subplot to show whether it has been clicked,
+		 * and mark it to be redrawn. This must be called in the GUI thread.
+		 */
+		void setClicked(bool clicked);
+
+		/*! Adopt the newest block published by the transfer thread, if any,
+		 * into the graph and its axes, and mark what changed to be redrawn.
+		 * This must be called in the GUI thread, before replotting.
+		 */
+		void updateGraph();
+
+		/*! Add new data to the subplot.
+		 *
+		 * \param frame The frame of data from all channels. Only this
+		 * 	subplot's channel is read, in place.
+		 * \param clicked True if this plot was clicked, and false otherwise.
+		 * \param spikes List to which any spikes detected in the new data
+		 * 	are appended.
+		 * \return The number of samples now shown by the subplot, if it is
+		 * 	ready to be replotted, or 0 if it is not.
+		 *
+		 * This method adds data to the subplot's back buffer, and if enough
+		 * data has been accumulated to warrant a replot, this formats the plot
+		 * (e.g, scaling axes) and publishes the new block for the GUI thread.
+		 * In sweep mode, each chunk is also drawn over the previous block as
+		 * soon as it arrives, and the subplot is ready to be replotted after
+		 * every chunk. If spike detection is enabled, the chunk is also
+		 * searched for spikes. This is called directly by the SubplotWorker
+		 * living in the same thread.
+		 */
+		int handleNewData(const sampleframe::SampleFrame& frame, bool clicked,
+				spikedetector::SpikeList* spikes);
 
 		/*! Compare two subplots for equality.
 		 * Subplots are considered equal if they live at the same linear index
@@ -120,15 +185,6 @@ class Subplot : public QObject {
 
 	signals:
 
-		/*! Emitted when this subplot is ready to be replotted, with this
-		 * subplot's index as the argument.
-		 *
-		 * This occurs when the back buffer has been filled with enough
-		 * data for a full plot block, but before the front and back 
-		 * buffers have been swapped.
-		 */
-		void plotReady(int idx, int npoints);
-
 		/*! Emitted just before the subplot is deleted.
 		 *
 		 * This is used to communicate with the main PlotWindow object,
@@ -139,24 +195,22 @@ class Subplot : public QObject {
 
 	public slots:
 
-		/*! Add new data to the subplot.
-		 *
-		 * \param sp The intended subplot for this array of data.
-		 * \param data The actual data.
-		 * \param lock Read-write lock used to synchronize access with the main
-		 * 	PlotWindow object for redrawing the plots.
-		 * \param clicked True if this plot was clicked, and false otherwise.
+		/*! Request that the subplot be deleted. */
+		void requestDelete();
+
+		/*! Start collecting the history of this subplot's channel.
 		 *
-		 * This method adds data to the subplot's back buffer, and if enough
-		 * data has been accumulated to warrant a replot, this formats the plot
-		 * (e.g, scaling axes) and notifies the main PlotWindow that this subplot
-		 * is ready to be replotted.
+		 * The history is seeded with the data currently plotted and any
+		 * data received since, and then grows as new data arrives. This
+		 * must be invoked in the subplot's thread, e.g., through a
+		 * queued connection.
 		 */
-		void handleNewData(Subplot* sp, QVector<DataFrame::DataType>* data,
-				QReadWriteLock* lock, bool clicked);
+		void enableHistory();
 
-		/*! Request that the subplot be deleted. */
-		void requestDelete();
+		/*! Stop collecting the history of this subplot's channel, and
+		 * release its storage.
+		 */
+		void disableHistory();
 
 		/*! Called when the refresh rate of the plot is changed,
 		 * indicating that the number of samples before refreshing
@@ -166,6 +220,19 @@ class Subplot : public QObject {
 
 	private:
 
+		/* Compute the axis ranges and ticks for the current block. The
+		 * configuration is passed in, rather than read again, so that the
+		 * caller's reference to it stays valid.
+		 */
+		void formatPlot(const displayconfig::DisplayConfig& config);
+
+		/* Publish the current block, drawn with the given pen, for the GUI
+		 * thread. The dirty rect is the part of the tile which changed, or
+		 * null if all of it may have.
+		 */
+		void publishBlock(const displayconfig::DisplayConfig& config,
+				const QPen& pen, const QRect& dirtyRect);
+
 		/* Actual channel number for this subplot. */
 		int m_channel;
 
@@ -184,23 +251,90 @@ class Subplot : public QObject {
 		QPair<int, int> m_position;
 
 		/* Graph containing the raw data for this subplot. */
-		QCPGraph* m_graph;
+		tracegraph::TraceGraph* m_graph;
 
 		/* Axis rectangle for the subplot. */
 		QCPAxisRect* m_rect;
 
+		/* Slot through which blocks are handed to the GUI thread. */
+		traceblock::BlockSlot m_slot;
+
 		/* Back buffer, into which data is written in a background
 		 * thread. This allows data to be transferred to the subplot while
-		 * the main plot is still updating.
+		 * the main plot is still updating. The buffer holds exactly one
+		 * plot block, and is swapped into a TraceData when full.
+		 */
+		samplebuffer::SampleBuffer m_backBuffer;
+
+		/* The data of the current block, shared with the GUI thread, and
+		 * that of the previous block. The buffers cycle between the back
+		 * buffer, these two, and the graph, so that once the GUI thread has
+		 * moved on from the previous block, its storage is reused rather
+		 * than reallocated.
+		 */
+		std::shared_ptr<traceblock::TraceData> m_data;
+		std::shared_ptr<traceblock::TraceData> m_spareData;
+
+		/* Tiles into which blocks are rasterized in this thread, alternating
+		 * like the data, so that the one being drawn is rarely still shared.
+		 */
+		QImage m_backTile;
+		QImage m_spareTile;
+
+		/* Tile over which sweeps are drawn, and the pen it was drawn with. */
+		QImage m_sweepTile;
+		QPen m_sweepPen;
+
+		/* Size in pixels of the axis rect, as of the last `updateGraph()`.
+		 * This is written in the GUI thread and read in the transfer thread.
 		 */
-		QCPDataMap m_backBuffer;
+		std::atomic<int> m_tileWidth { 0 };
+		std::atomic<int> m_tileHeight { 0 };
 
-		/* Current position in the back buffer. */
+		/* Buffer into which this subplot's channel is gathered from
+		 * frames whose channels are interleaved.
+		 */
+		QVector<DataFrame::DataType> m_gatherBuffer;
+
+		/* Number of samples written to the back buffer since the last swap. */
 		int m_backBufferPosition = 0;
 
+		/* Decimator reducing the back buffer's block to a min/max envelope,
+		 * with one column per pixel of the axis rect. The envelope is swapped
+		 * into the graph along with the back buffer.
+		 */
+		decimator::Decimator m_decimator;
+
+		/* Number of columns in the envelope, i.e., the width of the axis rect
+		 * in pixels, as of the last buffer swap.
+		 */
+		int m_envelopeColumns = subplot::DefaultEnvelopeColumns;
+
+		/* Multi-resolution history of this channel, used by channel
+		 * inspectors to scroll back and zoom. This is shared with any
+		 * inspector, so that it outlives the subplot if needed.
+		 */
+		QSharedPointer<lodpyramid::LodPyramid> m_history;
+
+		/* Detector of spikes in this subplot's channel. */
+		spikedetector::SpikeDetector m_spikeDetector;
+
+		/* Activity on the channel during the last chunk. */
+		channelstats::Activity m_activity {};
+
 		/* Global settings. */
 		QSettings m_settings;
 
+		/* Snapshot of the settings read on each chunk of data. */
+		displayconfig::Reader m_config;
+
+		/* Ranges of the axes for the current block. */
+		QCPRange m_keyRange;
+		QCPRange m_valueRange;
+
+		/* True if the y-axis shows ticks for the current block. */
+		bool m_ticksShown = false;
+
 		/* Tick positions for the y-axis. */
 		QVector<double> m_ticks;
 
@@ -213,6 +347,9 @@ class Subplot : public QObject {
 		/* Pen used to draw data when this plot has been clicked/selected. */
 		QPen m_selectedPen;
 
+		/* True if tiles are rasterized with antialiasing. */
+		bool m_antialiased;
+
 		/* Return the number of samples in a plot block. */
 		int m_plotBlockSize;
 };
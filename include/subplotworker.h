@@ -0,0 +1,132 @@
+/*! \file subplotworker.h
+ *
+ * Class for transferring data to a group of subplots in one background thread.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_SUBPLOT_WORKER_H_
+#define _MEAVIEW_SUBPLOT_WORKER_H_
+
+#include "subplot.h"
+#include "sampleframe.h"
+#include "spikedetector.h"
+
+#include <QObject>
+#include <QList>
+#include <QBitArray>
+
+namespace meaview {
+
+/*! \namespace subplotworker
+ *
+ * The subplotworker namespace contains the SubplotWorker class, which
+ * drives all subplots living in a single transfer thread.
+ */
+namespace subplotworker {
+
+/*! \class SubplotWorker
+ *
+ * The SubplotWorker class transfers each frame of data to a contiguous
+ * range of channels, all of whose subplots live in the same background
+ * thread as the worker.
+ *
+ * The PlotWindow sends each frame to each worker exactly once, and the
+ * worker hands it to its subplots with direct calls. When the subplots
+ * have swapped in a full plot block, the worker notifies the PlotWindow
+ * once on their behalf. The number of queued calls per frame is thus the
+ * number of threads, rather than the number of channels. Spikes detected
+ * by the subplots in each frame, and the activity on their channels, are
+ * likewise gathered into one batch each.
+ *
+ * The worker takes over deletion of its subplots, so that no frame can
+ * be handed to a subplot which has been scheduled for deletion.
+ */
+class SubplotWorker : public QObject {
+	Q_OBJECT
+
+	public:
+		/*! Construct a SubplotWorker.
+		 *
+		 * \param index The index of this worker in the PlotWindow.
+		 * \param subplots The subplots driven by this worker, which should
+		 * 	be a contiguous range of channels.
+		 *
+		 * The worker and its subplots should be moved to the same thread.
+		 */
+		SubplotWorker(int index, const QList<subplot::Subplot*>& subplots);
+
+		/*! Destroy a SubplotWorker. */
+		~SubplotWorker();
+
+		/*! Return the index of this worker. */
+		inline int index() const { return m_index; }
+
+		/*! Return the subplots driven by this worker. */
+		inline const QList<subplot::Subplot*>& subplots() const { return m_subplots; }
+
+	signals:
+
+		/*! Emitted when all of this worker's subplots have swapped in a
+		 * new plot block, or in sweep mode have drawn a new chunk, and are
+		 * ready to be replotted.
+		 *
+		 * \param idx The index of this worker.
+		 * \param npoints The number of samples shown in each subplot.
+		 * \param received The time at which the frame completing the
+		 * 	plot block was received, from `latency::now()`.
+		 */
+		void plotsReady(int idx, int npoints, qint64 received);
+
+		/*! Emitted after each frame has been handed to all subplots,
+		 * so that the PlotWindow can limit the frames in flight.
+		 *
+		 * \param idx The index of this worker.
+		 */
+		void frameHandled(int idx);
+
+		/*! Emitted after a frame has been handed to all subplots, if any
+		 * spikes were detected in it.
+		 *
+		 * \param spikes The spikes detected in the frame, grouped by channel.
+		 */
+		void spikesDetected(const spikedetector::SpikeList& spikes);
+
+		/*! Emitted after each frame has been handed to all subplots, with
+		 * the activity on each of their channels during the frame.
+		 *
+		 * \param activity The activity on each channel of this worker.
+		 */
+		void activityMeasured(const channelstats::ActivityList& activity);
+
+	public slots:
+
+		/*! Transfer a frame of data to each of this worker's subplots.
+		 *
+		 * \param frame The frame of data from all channels.
+		 * \param clicked Bit array, indexed by subplot index, of the subplots
+		 * 	which the user has clicked.
+		 */
+		void handleNewData(const sampleframe::SampleFrame& frame, 
+				const QBitArray& clicked);
+
+		/*! Request that all of this worker's subplots, and then the
+		 * worker itself, be deleted.
+		 */
+		void requestDelete();
+
+	private:
+
+		/* Index of this worker. */
+		int m_index;
+
+		/* Subplots driven by this worker. */
+		QList<subplot::Subplot*> m_subplots;
+
+}; // end SubplotWorker class
+
+}; // end subplotworker namespace
+}; // end meaview namespace
+
+#endif
+
@@ -0,0 +1,173 @@
+/*! \file traceblock.h
+ *
+ * Classes for handing the data drawn by a subplot from its transfer
+ * thread to the GUI thread, without locking.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_TRACE_BLOCK_H_
+#define _MEAVIEW_TRACE_BLOCK_H_
+
+#include "qcustomplot.h"
+#include "samplebuffer.h"
+#include "decimator.h"
+#include "channelstats.h"
+
+#include <QImage>
+#include <QRect>
+#include <QPen>
+#include <QVector>
+#include <QString>
+
+#include <memory>
+
+namespace meaview {
+
+/*! \namespace traceblock
+ *
+ * The traceblock namespace contains the classes used to publish what a
+ * subplot draws from its transfer thread to the GUI thread.
+ */
+namespace traceblock {
+
+/*! \class TraceData
+ *
+ * The samples of one plot block of a single channel, along with their
+ * min/max envelope and the gain converting them to physical units.
+ *
+ * A TraceData is filled in by a transfer thread, and is never modified
+ * once it has been shared, so that a graph may draw it from the GUI thread
+ * while the transfer thread fills the next one.
+ */
+class TraceData {
+
+	public:
+		/*! Return true if there are neither samples nor an envelope. */
+		inline bool isEmpty() const
+		{
+			return (samples.isEmpty() && (envelope.size == 0));
+		}
+
+		/*! Return true if the envelope's summary covers all of the samples,
+		 * as it does for blocks built by a Subplot, so that their statistics
+		 * need not be recomputed.
+		 */
+		bool hasSummary() const;
+
+		/*! Return the statistics of the raw samples. This takes constant
+		 * time if `hasSummary()`, and otherwise scans the samples.
+		 */
+		channelstats::SummaryStats stats() const;
+
+		/*! Return the mean value of the samples, i.e., gain * raw samples. */
+		double mean() const;
+
+		/*! Return the range of sample indices, or those spanned by the
+		 * envelope if there are no samples.
+		 */
+		QCPRange keyRange(bool& foundRange, QCPAbstractPlottable::SignDomain
+				inSignDomain = QCPAbstractPlottable::sdBoth) const;
+
+		/*! Return the range of values, i.e., gain * raw samples, from the
+		 * envelope if it's complete, and otherwise from the samples.
+		 */
+		QCPRange valueRange(bool& foundRange, QCPAbstractPlottable::SignDomain
+				inSignDomain = QCPAbstractPlottable::sdBoth) const;
+
+		/*! Raw samples of the block. */
+		samplebuffer::SampleBuffer samples;
+
+		/*! Min/max envelope of the raw samples, with one column per pixel. */
+		decimator::Envelope envelope;
+
+		/*! Gain used to convert raw samples into values. */
+		double gain = 1.0;
+
+}; // end TraceData class
+
+/*! \class TraceBlock
+ *
+ * A TraceBlock is everything the GUI thread needs to draw one subplot:
+ * the data, an optional tile into which it has already been rasterized,
+ * and the ranges and ticks of the subplot's axes. It is built by the
+ * transfer thread, published through a BlockSlot, and never modified
+ * after publication.
+ */
+class TraceBlock {
+
+	public:
+		/*! The data drawn by the subplot. */
+		std::shared_ptr<const TraceData> data;
+
+		/*! Tile into which the data has been rasterized, or null if
+		 * the data should be drawn directly.
+		 */
+		QImage tile;
+
+		/*! Region of the tile which changed since the last block taken
+		 * by the GUI thread, or null if all of it may have changed.
+		 */
+		QRect dirtyRect;
+
+		/*! The pen with which the tile was drawn. */
+		QPen pen;
+
+		/*! Range of the key axis. */
+		QCPRange keyRange;
+
+		/*! Range of the value axis. */
+		QCPRange valueRange;
+
+		/*! True if the value axis shows ticks and tick labels. */
+		bool ticks = false;
+
+		/*! Positions of the value axis ticks, if shown. */
+		QVector<double> tickVector;
+
+		/*! Labels of the value axis ticks, if shown. */
+		QVector<QString> tickLabels;
+
+}; // end TraceBlock class
+
+/*! \class BlockSlot
+ *
+ * A BlockSlot hands TraceBlocks from a single transfer thread to the GUI
+ * thread, through an atomic shared pointer.
+ *
+ * The transfer thread publishes each new block by storing it in the slot,
+ * replacing any block the GUI thread has not yet taken. The GUI thread
+ * takes the newest block, if any, by exchanging it for null. Neither side
+ * ever waits for the other: the transfer thread never blocks on a replot,
+ * and the GUI thread always draws a complete, consistent block. This is
+ * the same scheme used to publish the display configuration, see
+ * displayconfig.h.
+ */
+class BlockSlot {
+
+	public:
+		/*! Publish a new block, from the transfer thread.
+		 *
+		 * If the previous block has not yet been taken, its dirty region
+		 * is merged into that of the new block, which must therefore not
+		 * yet be shared with any other thread.
+		 */
+		void publish(const std::shared_ptr<TraceBlock>& block);
+
+		/*! Take the newest published block, from the GUI thread, or return
+		 * null if none has been published since the last call.
+		 */
+		std::shared_ptr<const TraceBlock> take();
+
+	private:
+
+		/* The newest block which has not yet been taken. */
+		std::shared_ptr<const TraceBlock> m_block;
+
+}; // end BlockSlot class
+
+}; // end traceblock namespace
+}; // end meaview namespace
+
+#endif
+
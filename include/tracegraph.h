@@ -0,0 +1,281 @@
+/*! \file tracegraph.h
+ *
+ * Class for drawing a single channel's data directly from a SampleBuffer.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _MEAVIEW_TRACE_GRAPH_H_
+#define _MEAVIEW_TRACE_GRAPH_H_
+
+#include "qcustomplot.h"
+#include "samplebuffer.h"
+#include "decimator.h"
+#include "traceblock.h"
+
+#include <QImage>
+#include <QSize>
+#include <QRect>
+
+#include <memory>
+
+namespace meaview {
+
+/*! \namespace tracegraph
+ *
+ * The tracegraph namespace contains the TraceGraph class, a plottable
+ * used to draw the data from a single channel.
+ */
+namespace tracegraph {
+
+/*! \class TraceGraph
+ *
+ * The TraceGraph class is a QCustomPlot plottable which draws a line
+ * through the samples stored in a SampleBuffer.
+ *
+ * The samples are held in a TraceData, which is shared rather than
+ * copied, and never modified while shared. A transfer thread may thus
+ * build the next block of data, and even rasterize it, while the GUI
+ * thread draws the current one.
+ *
+ * Unlike QCPGraph, which keeps its data in a QCPDataMap (a QMap from key to
+ * data point), the TraceGraph's data is a contiguous ring buffer of raw
+ * samples. The key of each sample is its index in the buffer, and its
+ * value is the raw sample multiplied by the graph's gain.
+ *
+ * The graph may also be given a min/max Envelope of its samples, computed
+ * by a Decimator as the data is transferred. When the full block of data
+ * is visible, the graph draws the envelope, which has one column per
+ * pixel, and never touches the samples themselves. Otherwise (e.g., when
+ * zoomed), or if no envelope is available, the graph reduces the visible
+ * samples within each pixel column to their min/max as it draws.
+ *
+ * The data may instead be rasterized ahead of time into an off-screen
+ * tile, with the static `renderTile()`, which may be called from any
+ * thread. When
+ * a tile has been set, the graph simply draws the tile into its axis rect,
+ * so that the cost of rasterizing the data is paid by the transfer threads
+ * rather than by the GUI thread's replot.
+ */
+class TraceGraph : public QCPAbstractPlottable {
+	Q_OBJECT
+
+	public:
+		/*! Construct a TraceGraph.
+		 *
+		 * \param keyAxis The axis along which sample indices are plotted.
+		 * \param valueAxis The axis along which sample values are plotted.
+		 *
+		 * As with any QCPAbstractPlottable, the graph must be added to the
+		 * parent plot with QCustomPlot::addPlottable, which then owns it.
+		 */
+		TraceGraph(QCPAxis* keyAxis, QCPAxis* valueAxis);
+
+		/*! Destroy a TraceGraph. */
+		virtual ~TraceGraph();
+
+		/*! Return the buffer of samples drawn by this graph. */
+		inline const samplebuffer::SampleBuffer* data() const { return &m_data->samples; }
+
+		/*! Return the shared data drawn by this graph. */
+		inline std::shared_ptr<const traceblock::TraceData> traceData() const { return m_data; }
+
+		/*! Replace the graph's data with the given shared data, which must
+		 * not be modified afterwards. If it is null, the graph is cleared.
+		 */
+		void setTraceData(std::shared_ptr<const traceblock::TraceData> data);
+
+		/*! Replace the graph's samples and gain with copies of those given.
+		 * Any envelope is cleared.
+		 */
+		void setData(const samplebuffer::SampleBuffer& data, double gain);
+
+		/*! Return the gain used to convert raw samples to values. */
+		inline double gain() const { return m_data->gain; }
+
+		/*! Rasterize data into an off-screen tile.
+		 *
+		 * \param data The data to be drawn.
+		 * \param tile The image into which the data is drawn. It is resized
+		 * 	to `size` if needed, and cleared to transparent.
+		 * \param size The size of the tile, usually that of the axis rect.
+		 * \param keyRange The range of the key axis spanned by the tile.
+		 * \param valueRange The range of the value axis spanned by the tile.
+		 * \param pen The pen with which the data is drawn.
+		 * \param antialiased True if the data is drawn antialiased.
+		 *
+		 * Everything is passed explicitly, rather than read from a graph
+		 * and its axes, so that this may be called from a transfer thread
+		 * without synchronizing with the GUI thread.
+		 */
+		static void renderTile(const traceblock::TraceData& data, QImage* tile,
+				const QSize& size, const QCPRange& keyRange, const QCPRange& valueRange,
+				const QPen& pen, bool antialiased);
+
+		/*! Draw part of a sweep over a tile, for sweep mode.
+		 *
+		 * \param tile The tile to draw over, e.g., one created with `renderTile()`.
+		 * \param sweep Buffer of the samples of the current sweep, in which
+		 * 	sample `i` is drawn at key `i`.
+		 * \param begin Index of the first new sample in the sweep.
+		 * \param end Index one past the last new sample in the sweep.
+		 * \param blockSize The number of samples in a full sweep.
+		 * \param valueRange The range of the value axis spanned by the tile.
+		 * \param gain The gain converting raw samples into values.
+		 * \param pen The pen with which the samples are drawn.
+		 * \param antialiased True if the samples are drawn antialiased.
+		 * \param cursorWidth Width in pixels of the gap cleared ahead of the
+		 * 	new samples, which marks the position of the sweep.
+		 * \return The rect of the tile which was modified.
+		 *
+		 * Only the pixel columns covering the new samples, and the cursor,
+		 * are cleared and redrawn. A column partially drawn by a previous
+		 * call is redrawn completely from the sweep buffer.
+		 */
+		static QRect sweepTile(QImage* tile, const samplebuffer::SampleBuffer& sweep,
+				int begin, int end, int blockSize, const QCPRange& valueRange,
+				double gain, const QPen& pen, bool antialiased, int cursorWidth);
+
+		/*! Return the graph's tile, which is null if the graph has none. */
+		inline const QImage& tile() const { return m_tile; }
+
+		/*! Set the graph's tile, which is shared rather than copied. While
+		 * the graph has a tile, it draws the tile rather than its data.
+		 */
+		inline void setTile(const QImage& tile) { m_tile = tile; }
+
+		/*! Remove the graph's tile, so that it draws its data directly. */
+		inline void clearTile() { m_tile = QImage(); }
+
+		/*! Draw the graph with the given painter. This is used by a GridPlot
+		 * to redraw a single graph outside of QCustomPlot::draw().
+		 */
+		inline void render(QCPPainter* painter) { draw(painter); }
+
+		/*! Return true if the graph has changed since it was last drawn. */
+		inline bool isDirty() const { return m_dirty; }
+
+		/*! Mark whether the graph has changed since it was last drawn. 
+		 * This marks the whole graph.
+		 */
+		inline void setDirty(bool dirty) 
+		{ 
+			m_dirty = dirty; 
+			m_dirtyRect = QRect();
+		}
+
+		/*! Mark part of the graph as changed since it was last drawn.
+		 *
+		 * \param rect The changed region, relative to the top left of
+		 * 	the axis rect. If the whole graph is already marked, this
+		 * 	does nothing.
+		 */
+		inline void addDirtyRect(const QRect& rect)
+		{
+			if (!m_dirty) {
+				m_dirty = true;
+				m_dirtyRect = rect;
+			} else if (!m_dirtyRect.isNull()) {
+				m_dirtyRect |= rect;
+			}
+		}
+
+		/*! Return the changed region of the graph, relative to the top left
+		 * of the axis rect. This is null if the whole graph has changed.
+		 */
+		inline const QRect& dirtyRect() const { return m_dirtyRect; }
+
+		/*! Return true if the graph's axes have changed since they were
+		 * last drawn, e.g., because their tick labels changed.
+		 */
+		inline bool isFrameDirty() const { return m_frameDirty; }
+
+		/*! Mark whether the graph's axes have changed since they were last drawn. */
+		inline void setFrameDirty(bool dirty) { m_frameDirty = dirty; }
+
+		/*! Remove all samples from the graph. */
+		virtual void clearData();
+
+		/*! TraceGraphs are not selectable, so this always returns -1. */
+		virtual double selectTest(const QPointF& pos, bool onlySelectable,
+				QVariant* details = 0) const;
+
+	protected:
+
+		/* Draw the graph using the given painter. */
+		virtual void draw(QCPPainter* painter);
+
+		/* Draw a short line in the given rect as a legend icon. */
+		virtual void drawLegendIcon(QCPPainter* painter, const QRectF& rect) const;
+
+		/* Return the range of sample indices. */
+		virtual QCPRange getKeyRange(bool& foundRange,
+				SignDomain inSignDomain = sdBoth) const;
+
+		/* Return the range of sample values, i.e., gain * raw samples. */
+		virtual QCPRange getValueRange(bool& foundRange,
+				SignDomain inSignDomain = sdBoth) const;
+
+	private:
+
+		/* Linear map from plot coordinates to pixels, either in the
+		 * parent plot or in an off-screen tile.
+		 */
+		struct PixelMap {
+			QCPRange keyRange;
+			double keyOffset, keyScale;
+			double valueOffset, valueScale;
+			inline QPointF operator()(double key, double value) const
+			{
+				return QPointF(keyOffset + keyScale * key, 
+						valueOffset + valueScale * value);
+			}
+		};
+
+		/* Return the map from plot coordinates to pixels in the parent plot. */
+		PixelMap plotPixelMap() const;
+
+		/* Compute the pixel positions of the line through the envelope if 
+		 * it's complete and spans the visible range, or if there are no
+		 * samples, and otherwise through the visible samples.
+		 */
+		static void getPoints(const traceblock::TraceData& data, const PixelMap& map,
+				QVector<QPointF>* points);
+
+		/* Return true if the envelope should be drawn over the given range:
+		 * if it's complete and spans the range, or if there are no samples.
+		 */
+		static bool useEnvelope(const traceblock::TraceData& data, const QCPRange& range);
+
+		/* Compute the pixel positions of the line through the columns of
+		 * the envelope within the visible range.
+		 */
+		static void getEnvelopePoints(const traceblock::TraceData& data,
+				const PixelMap& map, QVector<QPointF>* points);
+
+		/* Compute the pixel positions of the line through the visible samples. */
+		static void getLinePoints(const traceblock::TraceData& data,
+				const PixelMap& map, QVector<QPointF>* points);
+
+		/* The data drawn by this graph, which is never null. */
+		std::shared_ptr<const traceblock::TraceData> m_data;
+
+		/* Pre-rendered tile drawn in place of the data, if not null. */
+		QImage m_tile;
+
+		/* True if the graph has changed since it was last drawn. */
+		bool m_dirty = true;
+
+		/* Changed region of the graph, or null if all of it changed. */
+		QRect m_dirtyRect;
+
+		/* True if the graph's axes have changed since they were last drawn. */
+		bool m_frameDirty = false;
+
+}; // end TraceGraph class
+
+}; // end tracegraph namespace
+}; // end meaview namespace
+
+#endif
+
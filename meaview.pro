@@ -40,18 +40,74 @@ win32 {
 
 LIBS += -lhdf5_cpp -lhdf5 -larmadillo
 
+# Build with "qmake CONFIG+=meaview_profile" to time the stages of the
+# transfer and render pipeline. See include/profiler.h.
+meaview_profile {
+	DEFINES += MEAVIEW_PROFILE
+}
+
+# Build with "qmake CONFIG+=meaview_avx2" to use AVX2 in the sample
+# kernels, rather than SSE2. See include/samplekernels.h.
+meaview_avx2 {
+	QMAKE_CXXFLAGS += -mavx2
+}
+
 # Input
-HEADERS += include/channelinspector.h \
+HEADERS += include/activitymap.h \
+           include/bandpass.h \
+           include/channelinspector.h \
+           include/channelstats.h \
            include/configwindow.h \
+           include/decimator.h \
+           include/displayconfig.h \
+           include/gridplot.h \
+           include/hdf5reader.h \
+           include/latency.h \
+           include/lodpyramid.h \
            include/meaviewwindow.h \
            include/plotwindow.h \
+           include/profiler.h \
            include/qcustomplot.h \
+           include/rawreader.h \
+           include/recordingreader.h \
+           include/requestscheduler.h \
+           include/samplebuffer.h \
+           include/sampleframe.h \
+           include/samplekernels.h \
            include/settings.h \
-           include/subplot.h
-SOURCES += src/channelinspector.cc \
+           include/spikedetector.h \
+           include/spikeraster.h \
+           include/spikestore.h \
+           include/subplot.h \
+           include/subplotworker.h \
+           include/traceblock.h \
+           include/tracegraph.h
+SOURCES += src/activitymap.cc \
+           src/bandpass.cc \
+           src/channelinspector.cc \
+           src/channelstats.cc \
            src/configwindow.cc \
+           src/decimator.cc \
+           src/displayconfig.cc \
+           src/gridplot.cc \
+           src/hdf5reader.cc \
+           src/latency.cc \
+           src/lodpyramid.cc \
            src/main.cc \
            src/meaviewwindow.cc \
            src/plotwindow.cc \
+           src/profiler.cc \
            src/qcustomplot.cc \
-           src/subplot.cc
+           src/rawreader.cc \
+           src/recordingreader.cc \
+           src/requestscheduler.cc \
+           src/samplebuffer.cc \
+           src/sampleframe.cc \
+           src/samplekernels.cc \
+           src/spikedetector.cc \
+           src/spikeraster.cc \
+           src/spikestore.cc \
+           src/subplot.cc \
+           src/subplotworker.cc \
+           src/traceblock.cc \
+           src/tracegraph.cc
@@ -0,0 +1,344 @@
+/*! \file activitymap.cc
+ *
+ * Implementation of the ActivityMap class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "activitymap.h"
+
+#include <QHelpEvent>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QToolTip>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace meaview {
+namespace activitymap {
+
+Measure measureFromName(const QString& name)
+{
+	auto index = activitymap::MeasureNames.indexOf(name);
+	if (index < 0)
+		index = activitymap::MeasureNames.indexOf(activitymap::DefaultMeasure);
+	return static_cast<Measure>(index);
+}
+
+ActivityMap::ActivityMap(QWidget* parent)
+	: QWidget(parent)
+{
+	currentMeasure = measureFromName(settings.value("display/activity-measure",
+				activitymap::DefaultMeasure).toString());
+	frameTimer = new QTimer(this);
+	QObject::connect(frameTimer, &QTimer::timeout,
+			this, &ActivityMap::handleFrameTick);
+	setFrameRate(settings.value("display/frame-rate",
+				plotwindow::DefaultFrameRate).toDouble());
+}
+
+ActivityMap::~ActivityMap()
+{
+}
+
+void ActivityMap::setupMap(const QString& arr, int n)
+{
+	array = arr;
+	nchannels = n;
+	meanSquare.fill(0.0, nchannels);
+	spikeRate.fill(0.0, nchannels);
+	scaleTop = 0.0;
+	updateLayout();
+}
+
+void ActivityMap::clear()
+{
+	array.clear();
+	nchannels = 0;
+	positions.clear();
+	hasCell.clear();
+	cells.clear();
+	meanSquare.clear();
+	spikeRate.clear();
+	scaleTop = 0.0;
+	dirty = false;
+	update();
+}
+
+void ActivityMap::setMeasure(Measure measure)
+{
+	currentMeasure = measure;
+	scaleTop = 0.0;
+	dirty = true;
+	update();
+}
+
+void ActivityMap::setFrameRate(double rate)
+{
+	rate = qBound(plotwindow::MinFrameRate, rate, plotwindow::MaxFrameRate);
+	frameTimer->setInterval(static_cast<int>(std::round(1000. / rate)));
+}
+
+void ActivityMap::updateLayout()
+{
+	computePositions();
+	computeCells();
+	update();
+}
+
+void ActivityMap::handleActivity(const channelstats::ActivityList& activity)
+{
+	/* Average each channel exponentially over a fixed duration of
+	 * data, whatever the size of the chunks it arrives in.
+	 */
+	const auto& cfg = config.get();
+	auto sampleRate = cfg.sampleRate;
+	if (sampleRate <= 0)
+		return;
+	rmsScale = cfg.gain / cfg.scaleMultiplier;
+	for (const auto& a : activity) {
+		if ((a.channel < 0) || (a.channel >= nchannels) || (a.samples <= 0))
+			continue;
+		auto dt = a.samples / sampleRate;
+		auto alpha = std::exp(-dt / activitymap::TimeConstant);
+		if (a.variance >= 0)
+			meanSquare[a.channel] = alpha * meanSquare[a.channel] + (1 - alpha) * a.variance;
+		spikeRate[a.channel] = alpha * spikeRate[a.channel] + (1 - alpha) * (a.spikes / dt);
+	}
+	dirty = true;
+}
+
+double ActivityMap::value(int channel) const
+{
+	if ((channel < 0) || (channel >= nchannels))
+		return 0.0;
+	if (currentMeasure == Measure::SpikeRate)
+		return spikeRate.at(channel);
+	return rmsScale * std::sqrt(meanSquare.at(channel));
+}
+
+void ActivityMap::handleFrameTick()
+{
+	if (!dirty)
+		return;
+	dirty = false;
+
+	/* The scale follows the most active channel up at once, but only
+	 * slowly back down, so that colors don't flicker between frames.
+	 */
+	auto top = 0.0;
+	for (auto c = 0; c < nchannels; c++) {
+		if (hasCell.at(c))
+			top = std::max(top, value(c));
+	}
+	scaleTop = std::max(top, scaleTop * activitymap::ScaleDecay);
+	update();
+}
+
+void ActivityMap::computePositions()
+{
+	positions.fill(QPointF(), nchannels);
+	hasCell.fill(false, nchannels);
+	if (array.startsWith("hidens")) {
+
+		/* The last channel is the photodiode. Electrodes which are not
+		 * connected have 0 for their index.
+		 */
+		auto electrodes = settings.value("data/hidens-configuration").toList();
+		auto nelectrodes = nchannels - 1;
+		if (electrodes.size() >= nelectrodes) {
+			for (auto c = 0; c < nelectrodes; c++) {
+				auto el = electrodes.at(c).toList();
+				if (el.at(0).toUInt() == 0)
+					continue;
+				positions[c] = QPointF(el.at(1).toDouble(), -el.at(3).toDouble());
+				hasCell[c] = true;
+			}
+
+			/* Scale positions so that neighboring electrodes are one
+			 * unit apart, taking the median distance from each electrode
+			 * to its nearest neighbor. This is only done on setup.
+			 */
+			QVector<double> nearest;
+			for (auto i = 0; i < nelectrodes; i++) {
+				if (!hasCell.at(i))
+					continue;
+				auto closest = std::numeric_limits<double>::max();
+				for (auto j = 0; j < nelectrodes; j++) {
+					if ((i == j) || !hasCell.at(j))
+						continue;
+					auto d = positions.at(i) - positions.at(j);
+					auto distance = std::hypot(d.x(), d.y());
+					if (distance > 0)
+						closest = std::min(closest, distance);
+				}
+				if (closest < std::numeric_limits<double>::max())
+					nearest.append(closest);
+			}
+			if (!nearest.isEmpty()) {
+				auto middle = nearest.begin() + nearest.size() / 2;
+				std::nth_element(nearest.begin(), middle, nearest.end());
+				for (auto& p : positions)
+					p /= *middle;
+			}
+		} else {
+
+			/* No configuration for data played back from a file. Use
+			 * the same square grid as the subplots.
+			 */
+			auto rows = static_cast<int>(std::ceil(std::sqrt(nchannels)));
+			auto cols = static_cast<int>(std::ceil(double(nchannels) / rows));
+			for (auto c = 0; c < nelectrodes; c++) {
+				positions[c] = QPointF(c % cols, c / cols);
+				hasCell[c] = true;
+			}
+		}
+
+	} else {
+		auto view = plotwindow::McsChannelViewMap.value(
+				settings.value("display/view").toString(),
+				plotwindow::McsChannelOrderView);
+		for (auto c = 0; c < std::min(nchannels, view.size()); c++) {
+			if (plotwindow::McsAutoscaledChannels.contains(c))
+				continue;
+			positions[c] = QPointF(view.at(c).second, view.at(c).first);
+			hasCell[c] = true;
+		}
+	}
+}
+
+void ActivityMap::computeCells()
+{
+	cells.fill(QRectF(), nchannels);
+
+	/* Fit the extent of the electrodes, each of which is a unit wide,
+	 * into the space above the color scale, keeping their aspect ratio.
+	 */
+	QRectF bounds;
+	for (auto c = 0; c < nchannels; c++) {
+		if (hasCell.at(c))
+			bounds |= QRectF(positions.at(c) - QPointF(0.5, 0.5), QSizeF(1, 1));
+	}
+	if (bounds.isEmpty())
+		return;
+	auto area = QRectF(rect()).adjusted(activitymap::Margin, activitymap::Margin,
+			-activitymap::Margin, -3 * activitymap::Margin);
+	if (area.isEmpty())
+		return;
+	auto scale = std::min(area.width() / bounds.width(), area.height() / bounds.height());
+	auto offset = area.center() - scale * bounds.center();
+	auto size = std::max<double>(activitymap::MinCellSize, activitymap::CellFill * scale);
+	for (auto c = 0; c < nchannels; c++) {
+		if (!hasCell.at(c))
+			continue;
+		auto center = offset + scale * positions.at(c);
+		cells[c] = QRectF(center.x() - size / 2, center.y() - size / 2, size, size);
+	}
+}
+
+int ActivityMap::channelAt(const QPointF& point) const
+{
+	for (auto c = 0; c < cells.size(); c++) {
+		if (hasCell.at(c) && cells.at(c).contains(point))
+			return c;
+	}
+	return -1;
+}
+
+QColor ActivityMap::colorAt(double fraction)
+{
+	/* Interpolate from cold through red and yellow to white. */
+	static const QColor stops[] = {
+		activitymap::ColdColor, QColor(255, 0, 0), QColor(255, 255, 0), QColor(255, 255, 255)
+	};
+	static const int nstops = sizeof(stops) / sizeof(stops[0]);
+	if (!(fraction > 0))
+		return stops[0];
+	auto position = std::min(fraction, 1.0) * (nstops - 1);
+	auto i = std::min(static_cast<int>(position), nstops - 2);
+	auto t = position - i;
+	const auto& a = stops[i];
+	const auto& b = stops[i + 1];
+	return QColor(
+			static_cast<int>(a.red() + t * (b.red() - a.red())),
+			static_cast<int>(a.green() + t * (b.green() - a.green())),
+			static_cast<int>(a.blue() + t * (b.blue() - a.blue())));
+}
+
+QString ActivityMap::formatValue(double value) const
+{
+	if (currentMeasure == Measure::SpikeRate)
+		return QString("%1 Hz").arg(value, 0, 'f', 1);
+	return QString("%1 %2").arg(value, 0, 'g', 3).arg(
+			array.startsWith("hidens") ? "uV" : "V");
+}
+
+void ActivityMap::paintEvent(QPaintEvent*)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), plotwindow::BackgroundColor);
+	for (auto c = 0; c < cells.size(); c++) {
+		if (!hasCell.at(c))
+			continue;
+		auto fraction = (scaleTop > 0) ? (value(c) / scaleTop) : 0.0;
+		painter.fillRect(cells.at(c), colorAt(fraction));
+	}
+
+	/* Color scale along the bottom, labeled with its range. */
+	if (nchannels == 0)
+		return;
+	QRectF bar(activitymap::Margin, height() - 2 * activitymap::Margin,
+			width() - 2 * activitymap::Margin, activitymap::Margin / 2);
+	QLinearGradient gradient(bar.topLeft(), bar.topRight());
+	for (auto i = 0; i <= 10; i++)
+		gradient.setColorAt(i / 10., colorAt(i / 10.));
+	painter.fillRect(bar, gradient);
+	painter.setPen(subplot::LabelColor);
+	painter.setFont(subplot::LabelFont);
+	QRectF labels(bar.left(), bar.bottom(), bar.width(), activitymap::Margin);
+	painter.drawText(labels, Qt::AlignLeft | Qt::AlignVCenter, formatValue(0));
+	painter.drawText(labels, Qt::AlignHCenter | Qt::AlignVCenter,
+			activitymap::MeasureDescriptions.at(static_cast<int>(currentMeasure)));
+	painter.drawText(labels, Qt::AlignRight | Qt::AlignVCenter, formatValue(scaleTop));
+}
+
+void ActivityMap::resizeEvent(QResizeEvent* event)
+{
+	computeCells();
+	QWidget::resizeEvent(event);
+}
+
+void ActivityMap::showEvent(QShowEvent* event)
+{
+	frameTimer->start();
+	QWidget::showEvent(event);
+}
+
+void ActivityMap::hideEvent(QHideEvent* event)
+{
+	frameTimer->stop();
+	QWidget::hideEvent(event);
+}
+
+bool ActivityMap::event(QEvent* event)
+{
+	if (event->type() == QEvent::ToolTip) {
+		auto help = static_cast<QHelpEvent*>(event);
+		auto channel = channelAt(help->pos());
+		if (channel < 0) {
+			QToolTip::hideText();
+			event->ignore();
+		} else {
+			QToolTip::showText(help->globalPos(), QString("Channel %1: %2").arg(
+						channel).arg(formatValue(value(channel))));
+		}
+		return true;
+	}
+	return QWidget::event(event);
+}
+
+}; // end activitymap namespace
+}; // end meaview namespace
+
@@ -0,0 +1,266 @@
+/*! \file bandpass.cc
+ *
+ * Implementation of the bandpass filter.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "bandpass.h"
+#include "settings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+/* The filter works on single-precision floats, for which AVX is enough.
+ * It is enabled by `qmake CONFIG+=meaview_avx2`, as for the sample kernels.
+ */
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MEAVIEW_FILTER_AVX
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MEAVIEW_FILTER_SSE
+#endif
+
+namespace meaview {
+namespace bandpass {
+
+#if defined(MEAVIEW_FILTER_AVX)
+typedef __m256 Vector;
+static inline Vector load(const float* p) { return _mm256_loadu_ps(p); }
+static inline void store(float* p, Vector x) { _mm256_storeu_ps(p, x); }
+static inline Vector broadcast(float x) { return _mm256_set1_ps(x); }
+static inline Vector add(Vector x, Vector y) { return _mm256_add_ps(x, y); }
+static inline Vector sub(Vector x, Vector y) { return _mm256_sub_ps(x, y); }
+static inline Vector mul(Vector x, Vector y) { return _mm256_mul_ps(x, y); }
+static inline Vector round(Vector x, Vector lo, Vector hi)
+{
+	return _mm256_round_ps(_mm256_min_ps(_mm256_max_ps(x, lo), hi),
+			_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+#elif defined(MEAVIEW_FILTER_SSE)
+typedef __m128 Vector;
+static inline Vector load(const float* p) { return _mm_loadu_ps(p); }
+static inline void store(float* p, Vector x) { _mm_storeu_ps(p, x); }
+static inline Vector broadcast(float x) { return _mm_set1_ps(x); }
+static inline Vector add(Vector x, Vector y) { return _mm_add_ps(x, y); }
+static inline Vector sub(Vector x, Vector y) { return _mm_sub_ps(x, y); }
+static inline Vector mul(Vector x, Vector y) { return _mm_mul_ps(x, y); }
+static inline Vector round(Vector x, Vector lo, Vector hi)
+{
+	return _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x, lo), hi)));
+}
+#else
+typedef float Vector;
+static inline Vector load(const float* p) { return *p; }
+static inline void store(float* p, Vector x) { *p = x; }
+static inline Vector broadcast(float x) { return x; }
+static inline Vector add(Vector x, Vector y) { return x + y; }
+static inline Vector sub(Vector x, Vector y) { return x - y; }
+static inline Vector mul(Vector x, Vector y) { return x * y; }
+static inline Vector round(Vector x, Vector lo, Vector hi)
+{
+	x = std::min(std::max(x, lo), hi);
+	return static_cast<float>(static_cast<int>(x + ((x < 0) ? -0.5f : 0.5f)));
+}
+#endif
+
+/* Number of channels filtered at once. */
+static const int VectorSize = sizeof(Vector) / sizeof(float);
+
+static_assert(bandpass::ChannelsPerTile % VectorSize == 0,
+		"Tiles must hold a whole number of vectors of channels");
+
+/* Design one section of a Butterworth filter, from the bilinear
+ * transform of the analog prototype with the given quality factor.
+ */
+static Biquad section(double sampleRate, double cutoff, double q, bool highpass)
+{
+	auto w = 2 * std::acos(-1.0) * cutoff / sampleRate;
+	auto cosw = std::cos(w);
+	auto alpha = std::sin(w) / (2 * q);
+	auto a0 = 1 + alpha;
+	auto b0 = highpass ? (1 + cosw) / 2 : (1 - cosw) / 2;
+	auto b1 = highpass ? -2 * b0 : 2 * b0;
+	return Biquad {
+		static_cast<float>(b0 / a0),
+		static_cast<float>(b1 / a0),
+		static_cast<float>(b0 / a0),
+		static_cast<float>(-2 * cosw / a0),
+		static_cast<float>((1 - alpha) / a0)
+	};
+}
+
+QVector<Biquad> design(double sampleRate, double low, double high, int order)
+{
+	QVector<Biquad> sections;
+	if (sampleRate <= 0)
+		return sections;
+	auto top = bandpass::MaxCutoffFraction * sampleRate;
+	low = qBound(bandpass::MinLowCutoff, low, top / 2);
+	high = qBound(low * 2, high, top);
+
+	/* The poles of a Butterworth filter of order N pair up into sections
+	 * with quality factors 1 / (2 cos((2k + 1) pi / 2N)).
+	 */
+	auto pi = std::acos(-1.0);
+	for (auto k = 0; k < order / 2; k++) {
+		auto q = 1 / (2 * std::cos((2 * k + 1) * pi / (2 * order)));
+		sections.append(section(sampleRate, low, q, true));
+	}
+	for (auto k = 0; k < order / 2; k++) {
+		auto q = 1 / (2 * std::cos((2 * k + 1) * pi / (2 * order)));
+		sections.append(section(sampleRate, high, q, false));
+	}
+	return sections;
+}
+
+FilterBank::FilterBank()
+	: m_tile(bandpass::ChannelsPerTile * bandpass::SamplesPerTile)
+{
+}
+
+void FilterBank::configure(double sampleRate, double low, double high)
+{
+	if ((sampleRate == m_sampleRate) && (low == m_low) && (high == m_high))
+		return;
+	m_sampleRate = sampleRate;
+	m_low = low;
+	m_high = high;
+	m_sections = design(sampleRate, low, high, bandpass::FilterOrder);
+	m_nchannels = 0;
+	m_state.clear();
+	reset();
+}
+
+void FilterBank::setPassthrough(const QVector<int>& channels)
+{
+	m_passthroughChannels = channels;
+	m_passthrough.fill(false, m_nchannels);
+	for (auto c : m_passthroughChannels) {
+		if ((c >= 0) && (c < m_nchannels))
+			m_passthrough[c] = true;
+	}
+}
+
+void FilterBank::reset()
+{
+	m_primed = false;
+}
+
+void FilterBank::allocate(int nchannels)
+{
+	m_nchannels = nchannels;
+	m_stride = ((nchannels + VectorSize - 1) / VectorSize) * VectorSize;
+	m_state.fill(0.0f, 2 * m_sections.size() * m_stride);
+	setPassthrough(m_passthroughChannels);
+	m_primed = false;
+}
+
+void FilterBank::prime(const sampleframe::SampleFrame& frame)
+{
+	/* In the steady state for a constant input x, each section outputs
+	 * y = G x, where G is its gain at DC, and its state follows from the
+	 * difference equations with x and y constant.
+	 */
+	auto nsections = m_sections.size();
+	for (auto c = 0; c < m_nchannels; c++) {
+		float x = *frame.channel(c);
+		for (auto s = 0; s < nsections; s++) {
+			const auto& f = m_sections.at(s);
+			auto y = x * (f.b0 + f.b1 + f.b2) / (1 + f.a1 + f.a2);
+			auto z2 = f.b2 * x - f.a2 * y;
+			m_state[(2 * s + 1) * m_stride + c] = z2;
+			m_state[(2 * s) * m_stride + c] = f.b1 * x - f.a1 * y + z2;
+			x = y;
+		}
+	}
+	m_primed = true;
+}
+
+void FilterBank::filterTile(float* tile, int nsamples, int width, int first)
+{
+	/* Transposed direct form II. Each row of the tile is one time point,
+	 * and the channels across it are independent, so each section runs
+	 * a vector of channels at a time, with the state in the arrays.
+	 * The output is then rounded to the nearest sample in range.
+	 */
+	for (auto s = 0; s < m_sections.size(); s++) {
+		const auto& f = m_sections.at(s);
+		auto b0 = broadcast(f.b0), b1 = broadcast(f.b1), b2 = broadcast(f.b2);
+		auto a1 = broadcast(f.a1), a2 = broadcast(f.a2);
+		auto z1 = m_state.data() + (2 * s) * m_stride + first;
+		auto z2 = m_state.data() + (2 * s + 1) * m_stride + first;
+		for (auto t = 0; t < nsamples; t++) {
+			auto row = tile + t * width;
+			for (auto l = 0; l < width; l += VectorSize) {
+				auto x = load(row + l);
+				auto y = add(mul(b0, x), load(z1 + l));
+				store(z1 + l, add(sub(mul(b1, x), mul(a1, y)), load(z2 + l)));
+				store(z2 + l, sub(mul(b2, x), mul(a2, y)));
+				store(row + l, y);
+			}
+		}
+	}
+	auto lo = broadcast(std::numeric_limits<DataFrame::DataType>::lowest());
+	auto hi = broadcast(std::numeric_limits<DataFrame::DataType>::max());
+	for (auto i = 0; i < nsamples * width; i += VectorSize)
+		store(tile + i, round(load(tile + i), lo, hi));
+}
+
+sampleframe::SampleFrame FilterBank::filter(const sampleframe::SampleFrame& frame)
+{
+	if (!isConfigured() || frame.isEmpty())
+		return frame;
+	auto nsamples = frame.nsamples();
+	auto nchannels = frame.nchannels();
+	auto step = frame.stride();
+	if (nchannels != m_nchannels)
+		allocate(nchannels);
+	if (!m_primed)
+		prime(frame);
+
+	DataFrame::Samples out(nsamples, nchannels);
+	auto tile = m_tile.data();
+	for (auto first = 0; first < nchannels; first += bandpass::ChannelsPerTile) {
+		auto lanes = std::min(bandpass::ChannelsPerTile, nchannels - first);
+		auto width = ((lanes + VectorSize - 1) / VectorSize) * VectorSize;
+		for (auto start = 0; start < nsamples; start += bandpass::SamplesPerTile) {
+			auto length = std::min(bandpass::SamplesPerTile, nsamples - start);
+
+			/* Gather the tile, zeroing the channels which pad it out to
+			 * whole vectors, so that their state stays zero.
+			 */
+			for (auto l = 0; l < lanes; l++) {
+				auto in = frame.channel(first + l) + start * step;
+				for (auto t = 0; t < length; t++)
+					tile[t * width + l] = in[t * step];
+			}
+			for (auto t = 0; t < length; t++)
+				std::fill(tile + t * width + lanes, tile + (t + 1) * width, 0.0f);
+
+			filterTile(tile, length, width, first);
+
+			/* Write out each channel, already rounded. */
+			for (auto l = 0; l < lanes; l++) {
+				auto c = first + l;
+				auto dst = out.colptr(c) + start;
+				if (m_passthrough.at(c)) {
+					auto in = frame.channel(c) + start * step;
+					for (auto t = 0; t < length; t++)
+						dst[t] = in[t * step];
+					continue;
+				}
+				for (auto t = 0; t < length; t++)
+					dst[t] = static_cast<DataFrame::DataType>(tile[t * width + l]);
+			}
+		}
+	}
+	return sampleframe::SampleFrame(std::move(out));
+}
+
+}; // end bandpass namespace
+}; // end meaview namespace
+
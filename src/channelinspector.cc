@@ -7,22 +7,27 @@
 
 #include "channelinspector.h"
 
+#include <cmath>
+
 namespace meaview {
 namespace channelinspector {
 
 ChannelInspector::ChannelInspector(QCustomPlot* parentPlot, 
-		QCPGraph* source, int chan, const QString& label, QWidget* parent)
+		tracegraph::TraceGraph* source, QSharedPointer<lodpyramid::LodPyramid> history,
+		int chan, const QString& label, QWidget* parent)
 	: QWidget(parent, Qt::Window),
 	m_ticks(3),
 	m_tickLabels(3)
 {
 	m_channel = chan;
 	m_sourceGraph = source;
+	m_history = history;
 
 	/* Create plot axis and graph, and format the axes. */
 	m_plot = new QCustomPlot(this);
 	m_plot->setBackground(channelinspector::BackgroundColor);
-	m_graph = m_plot->addGraph();
+	m_graph = new tracegraph::TraceGraph(m_plot->xAxis, m_plot->yAxis);
+	m_plot->addPlottable(m_graph);
 	m_graph->keyAxis()->setTicks(false);
 	m_graph->keyAxis()->setTickLabels(false);
 	m_graph->keyAxis()->grid()->setVisible(false);
@@ -38,10 +43,16 @@ ChannelInspector::ChannelInspector(QCustomPlot* parentPlot,
 	m_graph->valueAxis()->setLabelColor(channelinspector::LabelColor);
 	m_graph->setPen(m_settings.value("display/plot-pens").toList().at(m_channel).value<QPen>());
 
-	/* Copy the data directly from the source graph, so that
-	 * plots here may proceed independently of the source itself.
+	/* Allow dragging and zooming along the time axis only. */
+	m_plot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+	m_plot->axisRect()->setRangeDrag(Qt::Horizontal);
+	m_plot->axisRect()->setRangeZoom(Qt::Horizontal);
+
+	/* Share the data of the source graph, which is never modified, so
+	 * that plots here may proceed independently of the source itself.
+	 * This is shown until the channel's history has any data.
 	 */
-	m_graph->setData(m_sourceGraph->data(), true);
+	m_graph->setTraceData(m_sourceGraph->traceData());
 	m_graph->rescaleValueAxis();
 	m_plot->replot();
 
@@ -67,6 +78,19 @@ ChannelInspector::ChannelInspector(QCustomPlot* parentPlot,
 	/* Connect replot to the afterReplot signal of the source graph */
 	QObject::connect(parentPlot, &QCustomPlot::afterReplot,
 			this, &ChannelInspector::replot);
+
+	/* Read the visible portion of the history before every replot,
+	 * including those caused by dragging or zooming. Any such interaction
+	 * stops following the most recent data, and double-clicking resumes it.
+	 */
+	QObject::connect(m_plot, &QCustomPlot::beforeReplot,
+			this, &ChannelInspector::loadHistory);
+	QObject::connect(m_plot, &QCustomPlot::mousePress,
+			this, [&] { m_following = false; });
+	QObject::connect(m_plot, &QCustomPlot::mouseWheel,
+			this, [&] { m_following = false; });
+	QObject::connect(m_plot, &QCustomPlot::mouseDoubleClick,
+			this, &ChannelInspector::follow);
 	QObject::connect(m_graph->valueAxis(), &QCPAxis::ticksRequest,
 			this, [&] {
 				/* Write 3 ticks at upper/lower range and center, but draw
@@ -74,7 +98,7 @@ ChannelInspector::ChannelInspector(QCustomPlot* parentPlot,
 				 */
 				auto range = m_graph->valueAxis()->range();
 				auto center = range.center();
-				auto multiplier = m_settings.value("display/scale-multiplier").toDouble();
+				auto multiplier = m_config.get().scaleMultiplier;
 				m_ticks = { range.lower, center, range.upper };
 				m_tickLabels = { 
 						QString::number((range.lower - center) / multiplier, 'f', 3),
@@ -104,12 +128,60 @@ void ChannelInspector::closeEvent(QCloseEvent* event)
 
 void ChannelInspector::replot() 
 {
-	/* Copy source plot's data. */
-	m_graph->setData(m_sourceGraph->data(), true);
-	m_graph->rescaleAxes();
+	auto count = m_history->count();
+	if (count == 0) {
+
+		/* No history yet, show the source plot's data. */
+		m_graph->setTraceData(m_sourceGraph->traceData());
+		m_loadedCount = -1;
+		m_graph->rescaleAxes();
+
+	} else if (m_following) {
+
+		/* Show the most recent plot block. */
+		auto blockSize = m_config.get().plotBlockSize();
+		m_graph->keyAxis()->setRange(count - blockSize, count - 1);
+		loadHistory();
+		m_graph->rescaleValueAxis();
+	}
 	m_plot->replot();
 }
 
+void ChannelInspector::follow()
+{
+	m_following = true;
+	replot();
+}
+
+void ChannelInspector::loadHistory()
+{
+	auto count = m_history->count();
+	if (count == 0)
+		return;
+
+	/* A replot while following has already loaded the history, just
+	 * before the replot itself, so skip reading the same data again.
+	 */
+	auto range = m_graph->keyAxis()->range();
+	auto width = qMax(m_plot->axisRect()->width(), 1);
+	auto gain = m_sourceGraph->gain();
+	if ((range == m_loadedRange) && (width == m_loadedWidth) &&
+			(gain == m_loadedGain) && (count == m_loadedCount))
+		return;
+	m_loadedRange = range;
+	m_loadedWidth = width;
+	m_loadedGain = gain;
+	m_loadedCount = count;
+
+	/* Read only as many points as there are pixels. */
+	auto data = std::make_shared<traceblock::TraceData>();
+	data->gain = gain;
+	m_history->query(static_cast<qint64>(std::floor(range.lower)),
+			static_cast<qint64>(std::ceil(range.upper)) + 1,
+			width, &data->envelope);
+	m_graph->setTraceData(data);
+}
+
 int ChannelInspector::channel() 
 {
 	return m_channel;
@@ -0,0 +1,44 @@
+/*! \file channelstats.cc
+ *
+ * Implementation of the SummaryStats class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "channelstats.h"
+
+#include <algorithm>
+
+namespace meaview {
+namespace channelstats {
+
+SummaryStats SummaryStats::fromSummary(const samplekernels::Summary& summary)
+{
+	SummaryStats stats;
+	if (summary.count == 0)
+		return stats;
+
+	/* The sum of squared deviations is sumSquares - sum^2 / n. Writing
+	 * sum = q * n + r, this is sumSquares - q * (sum + r) - r^2 / n, where
+	 * the first two terms are exact integers no larger than sumSquares,
+	 * and only the last, smaller than n, is rounded.
+	 */
+	auto n = summary.count;
+	auto q = summary.sum / n, r = summary.sum % n;
+	auto m2 = summary.sumSquares - q * (summary.sum + r);
+	stats.m_count = n;
+	stats.m_mean = static_cast<double>(summary.sum) / n;
+	stats.m_m2 = std::max(0.0, m2 - static_cast<double>(r) * r / n);
+	stats.m_min = summary.min;
+	stats.m_max = summary.max;
+	return stats;
+}
+
+double SummaryStats::variance() const
+{
+	return (m_count > 0) ? (m_m2 / m_count) : 0.0;
+}
+
+}; // end channelstats namespace
+}; // end meaview namespace
+
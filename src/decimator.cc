@@ -0,0 +1,92 @@
+/*! \file decimator.cc
+ *
+ * Implementation of the Decimator class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "decimator.h"
+
+#include <algorithm>
+
+namespace meaview {
+namespace decimator {
+
+Decimator::Decimator()
+{
+}
+
+void Decimator::reset(int blockSize, int columns)
+{
+	columns = std::max(0, std::min(columns, blockSize));
+	m_envelope.min.resize(columns);
+	m_envelope.max.resize(columns);
+	m_envelope.offset = 0;
+	m_envelope.blockSize = blockSize;
+	m_envelope.size = 0;
+	m_envelope.summary.clear();
+	m_column = 0;
+	m_position = 0;
+	m_columnEnd = columnEnd(0);
+	m_columnStarted = false;
+}
+
+int Decimator::columnEnd(int column) const
+{
+	if (m_envelope.columns() == 0)
+		return 0;
+	return static_cast<int>((static_cast<qint64>(column + 1) *
+			m_envelope.blockSize) / m_envelope.columns());
+}
+
+void Decimator::append(const DataFrame::DataType* data, int n)
+{
+	auto i = 0;
+	while ((i < n) && (m_column < m_envelope.columns())) {
+
+		/* Find extrema of the samples in this chunk falling in the current
+		 * column, and add them to the summary of the block.
+		 */
+		auto span = std::min(n - i, m_columnEnd - m_position);
+		samplekernels::Summary run;
+		samplekernels::summarize(data + i, span, &run);
+		m_envelope.summary.merge(run);
+		auto lo = run.min, hi = run.max;
+
+		/* Merge with samples from earlier chunks. */
+		if (m_columnStarted) {
+			m_envelope.min[m_column] = std::min(m_envelope.min[m_column],
+					static_cast<float>(lo));
+			m_envelope.max[m_column] = std::max(m_envelope.max[m_column],
+					static_cast<float>(hi));
+		} else {
+			m_envelope.min[m_column] = lo;
+			m_envelope.max[m_column] = hi;
+			m_columnStarted = true;
+		}
+		i += span;
+		m_position += span;
+
+		/* Move to the next column if this one is full. */
+		if (m_position == m_columnEnd) {
+			m_column += 1;
+			m_envelope.size = m_column;
+			m_columnEnd = columnEnd(m_column);
+			m_columnStarted = false;
+		}
+	}
+}
+
+void Decimator::swapEnvelope(Envelope& other)
+{
+	m_envelope.min.swap(other.min);
+	m_envelope.max.swap(other.max);
+	std::swap(m_envelope.offset, other.offset);
+	std::swap(m_envelope.blockSize, other.blockSize);
+	std::swap(m_envelope.size, other.size);
+	std::swap(m_envelope.summary, other.summary);
+}
+
+}; // end decimator namespace
+}; // end meaview namespace
+
@@ -0,0 +1,87 @@
+/*! \file displayconfig.cc
+ *
+ * Implementation of DisplayConfig snapshots.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "displayconfig.h"
+#include "settings.h"
+
+#include <atomic>
+
+namespace meaview {
+namespace displayconfig {
+
+namespace {
+
+/* The most recently published snapshot. This is only accessed
+ * through std::atomic_load and std::atomic_store.
+ */
+Snapshot currentSnapshot = std::make_shared<const DisplayConfig>();
+
+/* Number of snapshots published. Incremented after each new
+ * snapshot has been stored.
+ */
+std::atomic<int> generation(0);
+
+}; // end anonymous namespace
+
+DisplayConfig DisplayConfig::fromSettings(const QSettings& settings)
+{
+	DisplayConfig config;
+	config.array = settings.value("data/array").toString();
+	config.gain = settings.value("data/gain", 1.0).toDouble();
+	config.sampleRate = settings.value("data/sample-rate").toDouble();
+	config.refresh = settings.value("display/refresh").toDouble();
+	config.scale = settings.value("display/scale").toDouble();
+	config.scaleMultiplier = settings.value("display/scale-multiplier", 1.0).toDouble();
+	config.autoscale = settings.value("display/autoscale").toBool();
+	config.sweep = settings.value("display/sweep").toBool();
+	config.tileRendering = settings.value("display/tile-rendering").toBool();
+	config.traces = settings.value("display/traces", true).toBool();
+	config.spikeDetection = settings.value("display/spike-detection",
+			spikedetector::DefaultDetection).toBool();
+	config.spikeThreshold = settings.value("display/spike-threshold",
+			spikedetector::DefaultThreshold).toDouble();
+	config.filter = settings.value("display/filter",
+			bandpass::DefaultFiltering).toBool();
+	config.filterLow = settings.value("display/filter-low",
+			bandpass::DefaultLowCutoff).toDouble();
+	config.filterHigh = settings.value("display/filter-high",
+			bandpass::DefaultHighCutoff).toDouble();
+	return config;
+}
+
+void publish(const QSettings& settings)
+{
+	Snapshot snapshot = std::make_shared<const DisplayConfig>(
+			DisplayConfig::fromSettings(settings));
+	std::atomic_store(&currentSnapshot, snapshot);
+	generation.fetch_add(1, std::memory_order_release);
+}
+
+Snapshot current()
+{
+	return std::atomic_load(&currentSnapshot);
+}
+
+Reader::Reader()
+	: m_generation(generation.load(std::memory_order_acquire))
+{
+	m_snapshot = current();
+}
+
+const DisplayConfig& Reader::get()
+{
+	auto latest = generation.load(std::memory_order_acquire);
+	if (latest != m_generation) {
+		m_generation = latest;
+		m_snapshot = current();
+	}
+	return *m_snapshot;
+}
+
+}; // end displayconfig namespace
+}; // end meaview namespace
+
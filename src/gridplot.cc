@@ -0,0 +1,122 @@
+/*! \file gridplot.cc
+ *
+ * Implementation of the GridPlot class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "gridplot.h"
+
+namespace meaview {
+namespace gridplot {
+
+GridPlot::GridPlot(QWidget* parent)
+	: QCustomPlot(parent)
+{
+	addLayer(gridplot::TraceLayerName, layer("main"), QCustomPlot::limAbove);
+}
+
+GridPlot::~GridPlot()
+{
+}
+
+void GridPlot::invalidateFrame()
+{
+	m_frameInvalid = true;
+}
+
+QList<tracegraph::TraceGraph*> GridPlot::traceGraphs() const
+{
+	QList<tracegraph::TraceGraph*> graphs;
+	graphs.reserve(plottableCount());
+	for (auto i = 0; i < plottableCount(); i++) {
+		auto graph = qobject_cast<tracegraph::TraceGraph*>(plottable(i));
+		if (graph)
+			graphs.append(graph);
+	}
+	return graphs;
+}
+
+void GridPlot::draw(QCPPainter* painter)
+{
+	auto traces = layer(gridplot::TraceLayerName);
+	if (!traces) {
+		QCustomPlot::draw(painter);
+		return;
+	}
+	auto graphs = traceGraphs();
+
+	/* Re-render the frame if it's invalid, in which case every graph
+	 * is redrawn onto a fresh copy of it.
+	 */
+	auto redrawAll = (m_frameInvalid || (m_frame.size() != mPaintBuffer.size()));
+	for (auto& graph : graphs) {
+		if (graph->isFrameDirty()) {
+			redrawAll = true;
+			graph->setFrameDirty(false);
+		}
+	}
+	if (redrawAll) {
+		renderFrame(painter);
+		m_composite = m_frame;
+	}
+
+	/* Redraw only those graphs, or parts of graphs, which changed since
+	 * the last replot.
+	 */
+	QCPPainter compositePainter(&m_composite);
+	compositePainter.setRenderHints(painter->renderHints());
+	for (auto& graph : graphs) {
+		if (redrawAll)
+			redrawGraph(&compositePainter, graph, QRect());
+		else if (graph->isDirty())
+			redrawGraph(&compositePainter, graph, graph->dirtyRect());
+		graph->setDirty(false);
+	}
+	compositePainter.end();
+	painter->drawPixmap(0, 0, m_composite);
+}
+
+void GridPlot::renderFrame(QCPPainter* painter)
+{
+	/* Draw everything but the trace layer. This also runs the layout. */
+	m_frame = QPixmap(mPaintBuffer.size());
+	m_frame.fill(Qt::transparent);
+	QCPPainter framePainter(&m_frame);
+	framePainter.setRenderHints(painter->renderHints());
+	auto traces = layer(gridplot::TraceLayerName);
+	traces->setVisible(false);
+	QCustomPlot::draw(&framePainter);
+	traces->setVisible(true);
+	framePainter.end();
+	m_frameInvalid = false;
+}
+
+void GridPlot::redrawGraph(QCPPainter* painter, tracegraph::TraceGraph* graph,
+		const QRect& region)
+{
+	if (!graph->realVisibility() || !graph->keyAxis())
+		return;
+
+	/* Restore the graph's axis rect, or the given region of it, from the 
+	 * frame, and draw the graph over it, clipped as QCustomPlot::draw() 
+	 * clips it.
+	 */
+	auto rect = graph->keyAxis()->axisRect()->rect();
+	auto clip = rect.translated(0, -1);
+	if (!region.isNull())
+		clip &= region.translated(rect.topLeft());
+	if (clip.isEmpty())
+		return;
+	painter->setCompositionMode(QPainter::CompositionMode_Source);
+	painter->drawPixmap(clip, m_frame, clip);
+	painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+	painter->save();
+	painter->setClipRect(clip);
+	graph->render(painter);
+	painter->restore();
+}
+
+}; // end gridplot namespace
+}; // end meaview namespace
+
@@ -0,0 +1,180 @@
+/*! \file hdf5reader.cc
+ *
+ * Implementation of the Hdf5Reader class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "hdf5reader.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace meaview {
+namespace hdf5reader {
+
+static_assert(sizeof(DataFrame::DataType) == sizeof(int16_t),
+		"Samples are read from recording files as 16-bit integers");
+
+Hdf5Reader::Hdf5Reader(const QString& filename)
+	: recordingreader::RecordingReader(filename)
+{
+	H5::Exception::dontPrint();
+}
+
+Hdf5Reader::~Hdf5Reader()
+{
+}
+
+void Hdf5Reader::open()
+{
+	QJsonObject status;
+	try {
+		m_file = H5::H5File(m_filename.toStdString(), H5F_ACC_RDONLY);
+		m_root = m_file.openGroup("/");
+		m_dataset = m_file.openDataSet(hdf5reader::DatasetName.toStdString());
+
+		auto space = m_dataset.getSpace();
+		if (space.getSimpleExtentNdims() != 2) {
+			emit error(QString("The dataset \"%1\" in the recording file %2 "
+						"must be two-dimensional.").arg(hdf5reader::DatasetName).arg(
+						m_filename));
+			return;
+		}
+		hsize_t dims[2];
+		space.getSimpleExtentDims(dims);
+		m_channelsFirst = (dims[0] <= dims[1]);
+		m_nchannels = m_channelsFirst ? dims[0] : dims[1];
+		m_nsamples = m_channelsFirst ? dims[1] : dims[0];
+
+		/* Reads are aligned to the chunks along the time axis. */
+		auto plist = m_dataset.getCreatePlist();
+		if (plist.getLayout() == H5D_CHUNKED) {
+			hsize_t chunk[2];
+			plist.getChunk(2, chunk);
+			m_chunkLength = m_channelsFirst ? chunk[1] : chunk[0];
+		} else {
+			m_chunkLength = hdf5reader::DefaultReadLength;
+		}
+
+		auto isHidens = (m_nchannels > MaxMcsChannels);
+		auto array = readStringAttribute("array", isHidens ? "hidens" : "mcs");
+		m_sampleRate = readDoubleAttribute("sample-rate",
+				array.startsWith("hidens") ? HiDensSampleRate : McsSampleRate);
+		status["device-type"] = array;
+		status["nchannels"] = static_cast<int>(m_nchannels);
+		status["gain"] = readDoubleAttribute("gain", 1.0);
+		status["sample-rate"] = m_sampleRate;
+		status["recording-length"] = m_nsamples / m_sampleRate;
+	} catch (const H5::Exception& e) {
+		emit error(QString("Could not open the recording file %1: %2").arg(
+					m_filename).arg(QString::fromStdString(e.getDetailMsg())));
+		return;
+	}
+	m_cache.reset();
+	m_cacheStart = 0;
+	emit opened(status);
+}
+
+void Hdf5Reader::requestData(double start, double stop)
+{
+	auto toSample = [&](double time) -> hsize_t {
+		return static_cast<hsize_t>(std::max(0.0, std::round(time * m_sampleRate)));
+	};
+	auto first = toSample(start);
+	auto last = std::min(toSample(stop), m_nsamples);
+	if (first >= last) {
+		emit endOfFile();
+		return;
+	}
+
+	if ((first < m_cacheStart) || (last > m_cacheStart + m_cache.n_rows)) {
+		try {
+			readChunks(first, last);
+		} catch (const H5::Exception& e) {
+			m_cache.reset();
+			emit error(QString("Could not read from the recording file %1: %2").arg(
+						m_filename).arg(QString::fromStdString(e.getDetailMsg())));
+			return;
+		}
+	}
+
+	DataFrame::Samples samples = m_cache.rows(first - m_cacheStart,
+			last - m_cacheStart - 1);
+	emit data(first / m_sampleRate, last / m_sampleRate,
+			sampleframe::SampleFrame(std::move(samples)));
+}
+
+void Hdf5Reader::readChunks(hsize_t first, hsize_t last)
+{
+	auto begin = first - (first % m_chunkLength);
+	auto end = std::max(last, begin + hdf5reader::ReadAheadChunks * m_chunkLength);
+	end = std::min(m_nsamples, m_chunkLength * ((end + m_chunkLength - 1) / m_chunkLength));
+	auto length = end - begin;
+
+	auto fileSpace = m_dataset.getSpace();
+	if (m_channelsFirst) {
+
+		/* Each channel is a row of the dataset, and so the hyperslab
+		 * has exactly the column-major layout of the cache.
+		 */
+		hsize_t offset[2] = { 0, begin };
+		hsize_t count[2] = { m_nchannels, length };
+		fileSpace.selectHyperslab(H5S_SELECT_SET, count, offset);
+		H5::DataSpace memSpace(2, count);
+		m_cache.set_size(length, m_nchannels);
+		m_dataset.read(m_cache.memptr(), H5::PredType::NATIVE_INT16,
+				memSpace, fileSpace);
+
+	} else {
+
+		/* Samples are interleaved across channels, so read them
+		 * as a matrix with one column per sample and transpose.
+		 */
+		hsize_t offset[2] = { begin, 0 };
+		hsize_t count[2] = { length, m_nchannels };
+		fileSpace.selectHyperslab(H5S_SELECT_SET, count, offset);
+		H5::DataSpace memSpace(2, count);
+		DataFrame::Samples interleaved(m_nchannels, length);
+		m_dataset.read(interleaved.memptr(), H5::PredType::NATIVE_INT16,
+				memSpace, fileSpace);
+		m_cache = interleaved.t();
+
+	}
+	m_cacheStart = begin;
+}
+
+H5::H5Object* Hdf5Reader::findAttribute(const QString& name)
+{
+	auto attr = name.toStdString();
+	if (H5Aexists(m_dataset.getId(), attr.c_str()) > 0)
+		return &m_dataset;
+	if (H5Aexists(m_root.getId(), attr.c_str()) > 0)
+		return &m_root;
+	return nullptr;
+}
+
+double Hdf5Reader::readDoubleAttribute(const QString& name, double def)
+{
+	auto object = findAttribute(name);
+	if (!object)
+		return def;
+	double value;
+	object->openAttribute(name.toStdString()).read(H5::PredType::NATIVE_DOUBLE, &value);
+	return value;
+}
+
+QString Hdf5Reader::readStringAttribute(const QString& name, const QString& def)
+{
+	auto object = findAttribute(name);
+	if (!object)
+		return def;
+	auto attr = object->openAttribute(name.toStdString());
+	H5std_string value;
+	attr.read(attr.getStrType(), value);
+	return QString::fromStdString(value);
+}
+
+}; // end hdf5reader namespace
+}; // end meaview namespace
+
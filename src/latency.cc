@@ -0,0 +1,141 @@
+/*! \file latency.cc
+ *
+ * Implementation of the rolling latency measurements.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "latency.h"
+#include "settings.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+
+namespace meaview {
+namespace latency {
+
+static const int NumSegments = static_cast<int>(Segment::NumSegments);
+
+/* Rolling window of the most recent values of one segment. */
+struct Window {
+	QVector<qint64> values;
+	int next = 0;
+};
+
+/* All windows are protected by one mutex. Values are recorded a few
+ * times per replot, so there is no contention worth avoiding.
+ */
+static QMutex mutex;
+static Window windows[NumSegments];
+
+qint64 now()
+{
+	static const QElapsedTimer clock = []() {
+		QElapsedTimer timer;
+		timer.start();
+		return timer;
+	}();
+	return clock.nsecsElapsed();
+}
+
+void record(Segment segment, qint64 ns)
+{
+	QMutexLocker locker(&mutex);
+	auto& window = windows[static_cast<int>(segment)];
+	if (window.values.size() < latency::WindowSize) {
+		window.values.append(ns);
+	} else {
+		window.values[window.next] = ns;
+		window.next = (window.next + 1) % latency::WindowSize;
+	}
+}
+
+/* Return the value at the given fraction of the sorted values. */
+static double percentile(const QVector<qint64>& sorted, double fraction)
+{
+	auto index = static_cast<int>(fraction * (sorted.size() - 1) + 0.5);
+	return sorted.at(index) / 1e6;
+}
+
+Summary summarize(Segment segment)
+{
+	QVector<qint64> values;
+	{
+		QMutexLocker locker(&mutex);
+		values = windows[static_cast<int>(segment)].values;
+	}
+	Summary summary;
+	if (values.isEmpty())
+		return summary;
+	std::sort(values.begin(), values.end());
+	summary.count = values.size();
+	summary.p50 = percentile(values, 0.50);
+	summary.p99 = percentile(values, 0.99);
+	summary.max = values.last() / 1e6;
+	return summary;
+}
+
+void reset()
+{
+	QMutexLocker locker(&mutex);
+	for (auto& window : windows) {
+		window.values.clear();
+		window.next = 0;
+	}
+}
+
+QString segmentName(Segment segment)
+{
+	switch (segment) {
+		case Segment::Network:
+			return "network";
+		case Segment::Transfer:
+			return "transfer";
+		case Segment::Render:
+			return "render";
+		case Segment::Total:
+			return "total";
+		default:
+			return "unknown";
+	}
+}
+
+QString statusText()
+{
+	QStringList parts;
+	for (auto i = 0; i < NumSegments; i++) {
+		auto segment = static_cast<Segment>(i);
+		auto s = summarize(segment);
+		if (s.count == 0)
+			parts << QString("%1 -").arg(segmentName(segment));
+		else
+			parts << QString("%1 %2/%3").arg(segmentName(segment)).arg(
+					s.p50, 0, 'f', 0).arg(s.p99, 0, 'f', 0);
+	}
+	return QString("Latency p50/p99 (ms): %1").arg(parts.join(", "));
+}
+
+QJsonObject toJson()
+{
+	QJsonObject json;
+	for (auto i = 0; i < NumSegments; i++) {
+		auto segment = static_cast<Segment>(i);
+		auto s = summarize(segment);
+		json.insert(segmentName(segment), QJsonObject{
+					{ "count", s.count },
+					{ "p50-ms", s.p50 },
+					{ "p99-ms", s.p99 },
+					{ "max-ms", s.max },
+				});
+	}
+	return json;
+}
+
+}; // end latency namespace
+}; // end meaview namespace
+
@@ -0,0 +1,219 @@
+/*! \file lodpyramid.cc
+ *
+ * Implementation of the LodPyramid class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "lodpyramid.h"
+#include "samplekernels.h"
+
+#include <QMutexLocker>
+
+#include <cstring>
+#include <algorithm>
+
+namespace meaview {
+namespace lodpyramid {
+
+LodPyramid::LodPyramid(int levelSize, int factor, int nlevels)
+	: m_levelSize(levelSize),
+	m_factor(factor),
+	m_levels(nlevels)
+{
+}
+
+void LodPyramid::setEnabled(bool enabled)
+{
+	QMutexLocker locker(&m_mutex);
+	m_enabled = enabled;
+	resetLevels(enabled);
+}
+
+bool LodPyramid::isEnabled() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_enabled;
+}
+
+void LodPyramid::resetLevels(bool allocate)
+{
+	for (auto i = 0; i < m_levels.size(); i++) {
+		auto& level = m_levels[i];
+		level.min = allocate ? 
+			QVector<DataFrame::DataType>(m_levelSize) : QVector<DataFrame::DataType>();
+		level.max = (allocate && (i > 0)) ? 
+			QVector<DataFrame::DataType>(m_levelSize) : QVector<DataFrame::DataType>();
+		level.count = 0;
+		level.partialCount = 0;
+	}
+}
+
+qint64 LodPyramid::binWidth(int level) const
+{
+	qint64 width = 1;
+	for (auto i = 0; i < level; i++)
+		width *= m_factor;
+	return width;
+}
+
+qint64 LodPyramid::firstBin(int level) const
+{
+	return std::max<qint64>(0, m_levels.at(level).count - m_levelSize);
+}
+
+qint64 LodPyramid::firstSample() const
+{
+	auto first = m_levels.isEmpty() ? 0 : m_levels.at(0).count;
+	for (auto i = 0; i < m_levels.size(); i++) {
+		if (m_levels.at(i).count > 0)
+			first = std::min(first, firstBin(i) * binWidth(i));
+	}
+	return first;
+}
+
+qint64 LodPyramid::count() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_levels.isEmpty() ? 0 : m_levels.at(0).count;
+}
+
+qint64 LodPyramid::first() const
+{
+	QMutexLocker locker(&m_mutex);
+	return firstSample();
+}
+
+void LodPyramid::append(const DataFrame::DataType* data, int n)
+{
+	QMutexLocker locker(&m_mutex);
+	if (!m_enabled || m_levels.isEmpty() || (n <= 0))
+		return;
+
+	/* Copy the newest samples into the raw level, wrapping once if needed. */
+	auto& raw = m_levels[0];
+	auto ncopy = std::min(n, m_levelSize);
+	auto write = static_cast<int>((raw.count + (n - ncopy)) % m_levelSize);
+	auto first = std::min(ncopy, m_levelSize - write);
+	std::memcpy(raw.min.data() + write, data + (n - ncopy),
+			sizeof(DataFrame::DataType) * first);
+	if (first < ncopy) {
+		std::memcpy(raw.min.data(), data + (n - ncopy) + first,
+				sizeof(DataFrame::DataType) * (ncopy - first));
+	}
+	raw.count += n;
+	if (m_levels.size() == 1)
+		return;
+
+	/* Reduce runs of raw samples into the bins of level 1, which
+	 * cascade upwards through the remaining levels.
+	 */
+	auto i = 0;
+	while (i < n) {
+		auto span = std::min(n - i, m_factor - raw.partialCount);
+		samplekernels::Summary run;
+		samplekernels::summarize(data + i, span, &run);
+		auto lo = run.min, hi = run.max;
+		if (raw.partialCount == 0) {
+			raw.partialMin = lo;
+			raw.partialMax = hi;
+		} else {
+			raw.partialMin = std::min(raw.partialMin, lo);
+			raw.partialMax = std::max(raw.partialMax, hi);
+		}
+		raw.partialCount += span;
+		i += span;
+		if (raw.partialCount == m_factor) {
+			raw.partialCount = 0;
+			pushBin(1, raw.partialMin, raw.partialMax);
+		}
+	}
+}
+
+void LodPyramid::pushBin(int level, DataFrame::DataType lo, DataFrame::DataType hi)
+{
+	auto& current = m_levels[level];
+	auto idx = static_cast<int>(current.count % m_levelSize);
+	current.min[idx] = lo;
+	current.max[idx] = hi;
+	current.count += 1;
+	if (level + 1 >= m_levels.size())
+		return;
+
+	if (current.partialCount == 0) {
+		current.partialMin = lo;
+		current.partialMax = hi;
+	} else {
+		current.partialMin = std::min(current.partialMin, lo);
+		current.partialMax = std::max(current.partialMax, hi);
+	}
+	if (++current.partialCount == m_factor) {
+		current.partialCount = 0;
+		pushBin(level + 1, current.partialMin, current.partialMax);
+	}
+}
+
+void LodPyramid::query(qint64 begin, qint64 end, int columns,
+		decimator::Envelope* envelope) const
+{
+	QMutexLocker locker(&m_mutex);
+	envelope->clear();
+	if (!m_enabled || m_levels.isEmpty() || (columns <= 0))
+		return;
+
+	/* Clip to the available history. */
+	begin = std::max(begin, firstSample());
+	end = std::min(end, m_levels.at(0).count);
+	if (end <= begin)
+		return;
+	auto span = end - begin;
+
+	/* Find the coarsest level which still has a bin for each column,
+	 * and then move to coarser levels if needed to reach back far enough.
+	 */
+	auto level = 0;
+	while ((level + 1 < m_levels.size()) && 
+			(binWidth(level + 1) * columns <= span) &&
+			(m_levels.at(level + 1).count > 0)) {
+		level++;
+	}
+	while ((level + 1 < m_levels.size()) && 
+			(firstBin(level) * binWidth(level) > begin) &&
+			(m_levels.at(level + 1).count > 0)) {
+		level++;
+	}
+
+	/* Compute the range of bins in this level covering the request. */
+	const auto& lv = m_levels.at(level);
+	const auto& maxValues = (level == 0) ? lv.min : lv.max;
+	auto width = binWidth(level);
+	auto firstIdx = std::max(begin / width, firstBin(level));
+	auto lastIdx = std::min((end + width - 1) / width, lv.count);
+	auto nbins = lastIdx - firstIdx;
+	if (nbins <= 0)
+		return;
+	columns = static_cast<int>(std::min<qint64>(columns, nbins));
+
+	/* Reduce the bins falling in each column. */
+	envelope->min.resize(columns);
+	envelope->max.resize(columns);
+	envelope->offset = firstIdx * width;
+	envelope->blockSize = static_cast<int>(nbins * width);
+	envelope->size = columns;
+	for (auto c = 0; c < columns; c++) {
+		auto b0 = firstIdx + (c * nbins) / columns;
+		auto b1 = firstIdx + ((c + 1) * nbins) / columns;
+		auto idx = static_cast<int>(b0 % m_levelSize);
+		auto lo = lv.min.at(idx), hi = maxValues.at(idx);
+		for (auto b = b0 + 1; b < b1; b++) {
+			idx = static_cast<int>(b % m_levelSize);
+			lo = std::min(lo, lv.min.at(idx));
+			hi = std::max(hi, maxValues.at(idx));
+		}
+		envelope->min[c] = lo;
+		envelope->max[c] = hi;
+	}
+}
+
+}; // end lodpyramid namespace
+}; // end meaview namespace
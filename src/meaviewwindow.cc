@@ -14,6 +14,7 @@ namespace meaviewwindow {
 MeaviewWindow::MeaviewWindow(QWidget* parent) :
 	QMainWindow(parent),
 	playbackStatus(PlaybackStatus::Paused),
+	readerThread(new QThread(this)),
 	position(0.)
 {
 	setWindowTitle("meaview");
@@ -31,6 +32,12 @@ MeaviewWindow::MeaviewWindow(QWidget* parent) :
 
 	/* Connect any initial signals and slots. */
 	initSignals();
+	droppedFramesLabel = new QLabel(this);
+	statusBar()->addPermanentWidget(droppedFramesLabel);
+	missedDeadlinesLabel = new QLabel(this);
+	statusBar()->addPermanentWidget(missedDeadlinesLabel);
+	latencyLabel = new QLabel(this);
+	statusBar()->addPermanentWidget(latencyLabel);
 	statusBar()->showMessage("Ready", StatusMessageTimeout);
 }
 
@@ -40,6 +47,8 @@ MeaviewWindow::~MeaviewWindow()
 		client->disconnect();
 		client->deleteLater();
 	}
+	readerThread->quit();
+	readerThread->wait();
 }
 
 void MeaviewWindow::readConfigurationFile()
@@ -55,7 +64,27 @@ void MeaviewWindow::initSettings()
 	settings.setValue("display/view",
 			plotwindow::DefaultChannelView);
 	settings.setValue("display/autoscale", false);
+	settings.setValue("display/sweep", false);
+	settings.setValue("display/tile-rendering", plotwindow::DefaultTileRendering);
+	settings.setValue("display/spike-detection", spikedetector::DefaultDetection);
+	settings.setValue("display/traces", true);
+	settings.setValue("display/filter", bandpass::DefaultFiltering);
+	if (!settings.contains("display/filter-low"))
+		settings.setValue("display/filter-low", bandpass::DefaultLowCutoff);
+	if (!settings.contains("display/filter-high"))
+		settings.setValue("display/filter-high", bandpass::DefaultHighCutoff);
+	if (!settings.contains("display/activity-measure"))
+		settings.setValue("display/activity-measure", activitymap::DefaultMeasure);
+	if (!settings.contains("display/spike-threshold"))
+		settings.setValue("display/spike-threshold", spikedetector::DefaultThreshold);
 	settings.setValue("data/request-size", meaviewwindow::DataChunkRequestSize);
+	if (!settings.contains("playback/request-depth"))
+		settings.setValue("playback/request-depth", meaviewwindow::DefaultRequestDepth);
+	if (!settings.contains("playback/backpressure"))
+		settings.setValue("playback/backpressure", plotwindow::DefaultBackpressurePolicy);
+	if (!settings.contains("display/frame-rate"))
+		settings.setValue("display/frame-rate", plotwindow::DefaultFrameRate);
+	displayconfig::publish(settings);
 }
 
 void MeaviewWindow::createDockWidgets() 
@@ -72,6 +101,8 @@ void MeaviewWindow::createDockWidgets()
 	displaySettingsWidget->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
 	displaySettingsDockWidget = new QDockWidget("Display", this);
 
+	spikeRasterDockWidget = new QDockWidget("Spike raster", this);
+
 }
 
 void MeaviewWindow::initMenus() 
@@ -96,6 +127,23 @@ void MeaviewWindow::initMenus()
 			this, &MeaviewWindow::disconnectFromDataServer);
 	serverMenu->addAction(disconnectFromDataServerAction);
 
+	serverMenu->addSeparator();
+
+	openRecordingFileAction = new QAction(tr("&Open recording file"), serverMenu);
+	openRecordingFileAction->setShortcut(QKeySequence("Ctrl+O"));
+	openRecordingFileAction->setCheckable(false);
+	QObject::connect(openRecordingFileAction, &QAction::triggered,
+			this, &MeaviewWindow::openRecordingFile);
+	serverMenu->addAction(openRecordingFileAction);
+
+	closeRecordingFileAction = new QAction(tr("C&lose recording file"), serverMenu);
+	closeRecordingFileAction->setShortcut(QKeySequence("Ctrl+W"));
+	closeRecordingFileAction->setCheckable(false);
+	closeRecordingFileAction->setEnabled(false);
+	QObject::connect(closeRecordingFileAction, &QAction::triggered,
+			this, &MeaviewWindow::closeRecordingFile);
+	serverMenu->addAction(closeRecordingFileAction);
+
 	menuBar->addMenu(serverMenu);
 
 	/* Menu for controlling playback. */
@@ -139,6 +187,23 @@ void MeaviewWindow::initMenus()
 			this, &MeaviewWindow::jumpToEnd);
 	playbackMenu->addAction(jumpToEndAction);
 
+	playbackMenu->addSeparator();
+
+	backpressureMenu = playbackMenu->addMenu(tr("When plotting falls &behind"));
+	backpressureActions = new QActionGroup(backpressureMenu);
+	backpressureActions->setExclusive(true);
+	auto policy = settings.value("playback/backpressure").toString();
+	for (auto i = 0; i < plotwindow::BackpressurePolicyNames.size(); i++) {
+		auto action = backpressureActions->addAction(
+				plotwindow::BackpressurePolicyDescriptions.at(i));
+		action->setCheckable(true);
+		action->setData(plotwindow::BackpressurePolicyNames.at(i));
+		action->setChecked(plotwindow::BackpressurePolicyNames.at(i) == policy);
+		backpressureMenu->addAction(action);
+	}
+	QObject::connect(backpressureActions, &QActionGroup::triggered,
+			this, &MeaviewWindow::updateBackpressurePolicy);
+
 	menuBar->addMenu(playbackMenu);
 
 	/* Menu for controlling view and windows. */
@@ -180,6 +245,69 @@ void MeaviewWindow::initMenus()
 			this, &MeaviewWindow::minify);
 	viewMenu->addAction(minifyAction);
 
+	tileRenderingAction = new QAction(tr("&Parallel rendering"), viewMenu);
+	tileRenderingAction->setEnabled(true);
+	tileRenderingAction->setCheckable(true);
+	tileRenderingAction->setChecked(settings.value("display/tile-rendering").toBool());
+	QObject::connect(tileRenderingAction, &QAction::triggered,
+			this, &MeaviewWindow::updateTileRendering);
+	viewMenu->addAction(tileRenderingAction);
+
+	spikeDetectionAction = new QAction(tr("Detect &spikes"), viewMenu);
+	spikeDetectionAction->setEnabled(true);
+	spikeDetectionAction->setCheckable(true);
+	spikeDetectionAction->setChecked(settings.value("display/spike-detection").toBool());
+	QObject::connect(spikeDetectionAction, &QAction::triggered,
+			this, &MeaviewWindow::updateSpikeDetection);
+	viewMenu->addAction(spikeDetectionAction);
+
+	filterAction = new QAction(tr("&Bandpass filter"), viewMenu);
+	filterAction->setShortcut(QKeySequence("Ctrl+Shift+F"));
+	filterAction->setEnabled(true);
+	filterAction->setCheckable(true);
+	filterAction->setChecked(settings.value("display/filter").toBool());
+	QObject::connect(filterAction, &QAction::triggered,
+			this, &MeaviewWindow::updateFiltering);
+	viewMenu->addAction(filterAction);
+
+	viewMenu->addSeparator();
+
+	showActivityMapAction = new QAction(tr("&Activity map"), viewMenu);
+	showActivityMapAction->setShortcut(QKeySequence("Ctrl+Shift+A"));
+	showActivityMapAction->setEnabled(true);
+	showActivityMapAction->setCheckable(true);
+	showActivityMapAction->setChecked(false);
+	QObject::connect(showActivityMapAction, &QAction::triggered,
+			this, &MeaviewWindow::showActivityMap);
+	viewMenu->addAction(showActivityMapAction);
+
+	activityMeasureMenu = viewMenu->addMenu(tr("Color activity &by"));
+	activityMeasureActions = new QActionGroup(activityMeasureMenu);
+	activityMeasureActions->setExclusive(true);
+	auto measure = settings.value("display/activity-measure").toString();
+	for (auto i = 0; i < activitymap::MeasureNames.size(); i++) {
+		auto action = activityMeasureActions->addAction(
+				activitymap::MeasureDescriptions.at(i));
+		action->setCheckable(true);
+		action->setData(activitymap::MeasureNames.at(i));
+		action->setChecked(activitymap::MeasureNames.at(i) == measure);
+		activityMeasureMenu->addAction(action);
+	}
+	QObject::connect(activityMeasureActions, &QActionGroup::triggered,
+			this, &MeaviewWindow::updateActivityMeasure);
+
+	showSpikeRasterDockWidget = spikeRasterDockWidget->toggleViewAction();
+	showSpikeRasterDockWidget->setShortcut(QKeySequence("Ctrl+Shift+R"));
+	viewMenu->addAction(showSpikeRasterDockWidget);
+
+	viewMenu->addSeparator();
+
+	saveLatencyStatisticsAction = new QAction(tr("Save &latency statistics..."), viewMenu);
+	saveLatencyStatisticsAction->setCheckable(false);
+	QObject::connect(saveLatencyStatisticsAction, &QAction::triggered,
+			this, &MeaviewWindow::saveLatencyStatistics);
+	viewMenu->addAction(saveLatencyStatisticsAction);
+
 	menuBar->addMenu(viewMenu);
 
 	setMenuBar(menuBar);
@@ -318,6 +446,13 @@ void MeaviewWindow::initDisplaySettingsWidget()
 	QObject::connect(autoscaleBox, &QCheckBox::stateChanged,
 			this, &MeaviewWindow::updateAutoscale);
 
+	sweepBox = new QCheckBox("Sweep", displaySettingsWidget);
+	sweepBox->setToolTip("If checked, data is drawn as it arrives, sweeping across each subplot");
+	sweepBox->setTristate(false);
+	sweepBox->setChecked(false);
+	QObject::connect(sweepBox, &QCheckBox::stateChanged,
+			this, &MeaviewWindow::updateSweep);
+
 	displaySettingsLayout = new QGridLayout(displaySettingsWidget);
 	displaySettingsLayout->addWidget(dataConfigurationLabel, 0, 0);
 	displaySettingsLayout->addWidget(dataConfigurationBox, 0, 1);
@@ -326,6 +461,7 @@ void MeaviewWindow::initDisplaySettingsWidget()
 	displaySettingsLayout->addWidget(scaleLabel, 1, 0);
 	displaySettingsLayout->addWidget(scaleBox, 1, 1);
 	displaySettingsLayout->addWidget(autoscaleBox, 1, 2);
+	displaySettingsLayout->addWidget(sweepBox, 1, 3);
 
 	displaySettingsWidget->setLayout(displaySettingsLayout);
 	displaySettingsDockWidget->setFloating(false);
@@ -335,8 +471,25 @@ void MeaviewWindow::initDisplaySettingsWidget()
 
 void MeaviewWindow::initPlotWindow() 
 {
-	plotWindow = new plotwindow::PlotWindow(this);
-	setCentralWidget(plotWindow);
+	centralStack = new QStackedWidget(this);
+	plotWindow = new plotwindow::PlotWindow(centralStack);
+	activityMap = new activitymap::ActivityMap(centralStack);
+	centralStack->addWidget(plotWindow);
+	centralStack->addWidget(activityMap);
+	centralStack->setCurrentWidget(plotWindow);
+	setCentralWidget(centralStack);
+	QObject::connect(plotWindow, &plotwindow::PlotWindow::activityMeasured,
+			activityMap, &activitymap::ActivityMap::handleActivity);
+
+	spikeRaster = new spikeraster::SpikeRaster(spikeRasterDockWidget);
+	spikeRasterDockWidget->setFloating(false);
+	spikeRasterDockWidget->setWidget(spikeRaster);
+	addDockWidget(Qt::BottomDockWidgetArea, spikeRasterDockWidget);
+	spikeRasterDockWidget->hide();
+	QObject::connect(plotWindow, &plotwindow::PlotWindow::spikesDetected,
+			spikeRaster, &spikeraster::SpikeRaster::handleSpikes);
+	QObject::connect(plotWindow, &plotwindow::PlotWindow::activityMeasured,
+			spikeRaster, &spikeraster::SpikeRaster::handleActivity);
 	QObject::connect(plotWindow, &plotwindow::PlotWindow::plotRefreshed,
 			this, &MeaviewWindow::updateTime);
 	QObject::connect(minifyAction, &QAction::triggered,
@@ -345,6 +498,12 @@ void MeaviewWindow::initPlotWindow()
 			plotWindow, &plotwindow::PlotWindow::toggleInspectorsVisible);
 	QObject::connect(plotWindow, &plotwindow::PlotWindow::numInspectorsChanged,
 			this, &MeaviewWindow::updateInspectorAction);
+	QObject::connect(plotWindow, &plotwindow::PlotWindow::framesDropped,
+			this, &MeaviewWindow::handleDroppedFrames);
+	QObject::connect(plotWindow, &plotwindow::PlotWindow::deadlinesMissed,
+			this, &MeaviewWindow::handleMissedDeadlines);
+	QObject::connect(plotWindow, &plotwindow::PlotWindow::throttleChanged,
+			this, &MeaviewWindow::handleThrottle);
 	QObject::connect(refreshIntervalBox, 
 			static_cast<void(QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
 			plotWindow, &plotwindow::PlotWindow::updateRefresh);
@@ -358,9 +517,22 @@ void MeaviewWindow::initSignals()
 
 void MeaviewWindow::requestData()
 {
-	if (!client)
-		return;
-	client->getData(position, position + settings.value("display/refresh").toDouble());
+	if (scheduler) {
+		scheduler->start(position, true);
+	} else if (reader) {
+		requestFrame(position, position + 
+				settings.value("data/request-size").toDouble() / 1000.);
+	}
+}
+
+void MeaviewWindow::requestFrame(double start, double stop)
+{
+	if (scheduler) {
+		scheduler->request(start, stop);
+	} else if (reader) {
+		recordingRequestTimes.enqueue(latency::now());
+		emit requestRecordingData(start, stop);
+	}
 }
 
 void MeaviewWindow::connectToDataServer() 
@@ -371,6 +543,7 @@ void MeaviewWindow::connectToDataServer()
 			this, &MeaviewWindow::handleServerConnection);
 	serverLine->setEnabled(false);
 	connectToDataServerAction->setEnabled(false);
+	openRecordingFileAction->setEnabled(false);
 	connectToDataServerButton->setText("Cancel");
 	QObject::disconnect(connectToDataServerButton, &QPushButton::clicked,
 			connectToDataServerAction, &QAction::triggered);
@@ -384,6 +557,7 @@ void MeaviewWindow::cancelDataServerConnectionAttempt()
 {
 	serverLine->setEnabled(true);
 	connectToDataServerAction->setEnabled(true);
+	openRecordingFileAction->setEnabled(true);
 	connectToDataServerButton->setText("Connect");
 	QObject::disconnect(connectToDataServerButton, &QPushButton::clicked,
 			this, &MeaviewWindow::cancelDataServerConnectionAttempt);
@@ -419,6 +593,7 @@ void MeaviewWindow::handleServerConnection(bool made)
 
 		serverLine->setEnabled(true);
 		connectToDataServerAction->setEnabled(true);
+		openRecordingFileAction->setEnabled(true);
 		disconnectFromDataServerAction->setEnabled(false);
 		connectToDataServerButton->setText("Connect");
 		QObject::disconnect(connectToDataServerButton, &QPushButton::clicked,
@@ -491,41 +666,26 @@ void MeaviewWindow::handleInitialSourceStatusReply(bool exists,
 		const QJsonObject& status)
 {
 	if (exists) {
-		auto type = status["source-type"].toString();
-		auto array = status["device-type"].toString();
-		auto nchannels = status["nchannels"].toInt();
-		settings.setValue("data/array", array);
-		settings.setValue("data/nchannels", nchannels);
-		settings.setValue("data/gain", status["gain"].toDouble());
-		settings.setValue("data/sample-rate", status["sample-rate"].toDouble());
-
-		initChannelViewMenu();
-		plotWindow->setupWindow(array, nchannels);
-
-		if (array.startsWith("hidens")) {
-			settings.setValue("display/scale-multiplier", 1e-6);
-			scaleBox->setSuffix(" uV");
-			scaleBox->setValue(plotwindow::HiDensDefaultDisplayRange);
-			scaleBox->setMaximum(plotwindow::HiDensMaxDisplayRange);
-			scaleBox->setSingleStep(10);
-			scaleBox->setDecimals(0);
+		setupDataSource(status);
+		if (status["device-type"].toString().startsWith("hidens"))
 			showHidensConfigurationAction->setEnabled(true);
-		} else {
-			settings.setValue("display/scale-multiplier", 1.0);
-			scaleBox->setSuffix(" V");
-			scaleBox->setValue(plotwindow::McsDefaultDisplayRange);
-			scaleBox->setMaximum(plotwindow::McsMaxDisplayRange);
-			scaleBox->setDecimals(2);
-			scaleBox->setSingleStep(0.1);
-		}
-
-		startPlaybackButton->setEnabled(true);
-		startPlaybackAction->setEnabled(true);
-		QObject::connect(startPlaybackAction, &QAction::triggered,
-				this, &MeaviewWindow::startPlayback);
 
+		/* All frames of data pass through the request scheduler,
+		 * which keeps several requests in flight during playback
+		 * and delivers the frames in the order requested.
+		 */
+		scheduler = new requestscheduler::RequestScheduler(client, this);
+		scheduler->setDepth(settings.value("playback/request-depth").toInt());
+		scheduler->setChunkSize(settings.value("data/request-size").toDouble() / 1000.);
+		scheduler->setHeld(plotWindow->isThrottling());
 		QObject::connect(client, &BldsClient::data,
+				scheduler, &requestscheduler::RequestScheduler::handleData);
+		QObject::connect(client, &BldsClient::error,
+				scheduler, &requestscheduler::RequestScheduler::handleError);
+		QObject::connect(scheduler, &requestscheduler::RequestScheduler::frameReady,
 				this, &MeaviewWindow::receiveDataFrame);
+		QObject::connect(scheduler, &requestscheduler::RequestScheduler::framesDropped,
+				this, &MeaviewWindow::handleDroppedFrames);
 		QObject::connect(client, &BldsClient::error,
 				this, &MeaviewWindow::handleServerError);
 
@@ -536,6 +696,47 @@ void MeaviewWindow::handleInitialSourceStatusReply(bool exists,
 	}
 }
 
+void MeaviewWindow::setupDataSource(const QJsonObject& status)
+{
+	auto array = status["device-type"].toString();
+	auto nchannels = status["nchannels"].toInt();
+	settings.setValue("data/array", array);
+	settings.setValue("data/nchannels", nchannels);
+	settings.setValue("data/gain", status["gain"].toDouble());
+	settings.setValue("data/sample-rate", status["sample-rate"].toDouble());
+	displayconfig::publish(settings);
+	latency::reset();
+
+	initChannelViewMenu();
+	plotWindow->setupWindow(array, nchannels);
+	activityMap->setupMap(array, nchannels);
+	spikeRaster->setupRaster(array, nchannels);
+	droppedFramesLabel->clear();
+	missedDeadlinesLabel->clear();
+
+	if (array.startsWith("hidens")) {
+		settings.setValue("display/scale-multiplier", 1e-6);
+		scaleBox->setSuffix(" uV");
+		scaleBox->setValue(plotwindow::HiDensDefaultDisplayRange);
+		scaleBox->setMaximum(plotwindow::HiDensMaxDisplayRange);
+		scaleBox->setSingleStep(10);
+		scaleBox->setDecimals(0);
+	} else {
+		settings.setValue("display/scale-multiplier", 1.0);
+		scaleBox->setSuffix(" V");
+		scaleBox->setValue(plotwindow::McsDefaultDisplayRange);
+		scaleBox->setMaximum(plotwindow::McsMaxDisplayRange);
+		scaleBox->setDecimals(2);
+		scaleBox->setSingleStep(0.1);
+	}
+	displayconfig::publish(settings);
+
+	startPlaybackButton->setEnabled(true);
+	startPlaybackAction->setEnabled(true);
+	QObject::connect(startPlaybackAction, &QAction::triggered,
+			this, &MeaviewWindow::startPlayback);
+}
+
 void MeaviewWindow::handleServerError(QString msg) 
 {
 	QMessageBox::critical(this, "Server error",
@@ -551,6 +752,7 @@ void MeaviewWindow::disconnectFromDataServer()
 
 	disconnectFromDataServerAction->setEnabled(false);
 	connectToDataServerAction->setEnabled(true);
+	openRecordingFileAction->setEnabled(true);
 	connectToDataServerButton->setText("Connect");
 	QObject::disconnect(connectToDataServerButton, &QPushButton::clicked,
 			disconnectFromDataServerAction, &QAction::trigger);
@@ -569,12 +771,19 @@ void MeaviewWindow::disconnectFromDataServer()
 	startPlaybackButton->setText("Start");
 	startPlaybackButton->setEnabled(false);
 
+	if (scheduler) {
+		scheduler->stop();
+		scheduler->deleteLater();
+		scheduler.clear();
+	}
 	QObject::disconnect(client, 0, 0, 0);
 	client->disconnect();
 	client->deleteLater();
 	client.clear();
 
 	plotWindow->clear();
+	activityMap->clear();
+	spikeRaster->clear();
 	position = 0.0;
 
 	statusBar()->showMessage("Disconnected from data server", StatusMessageTimeout);
@@ -604,6 +813,8 @@ void MeaviewWindow::pausePlayback()
 {
 	statusBar()->showMessage("Vizualization paused", StatusMessageTimeout);
 	playbackStatus = PlaybackStatus::Paused;
+	if (scheduler)
+		scheduler->stop();
 	
 	setPlaybackMovementButtonsEnabled(true);
 	startPlaybackButton->setText("Start");
@@ -616,16 +827,20 @@ void MeaviewWindow::pausePlayback()
 
 void MeaviewWindow::startPlayback() 
 {
-	client->get("recording-position");
-	connections.insert("get-position",
-			QObject::connect(client, &BldsClient::getResponse,
-				[&](QString param, bool /* valid */, QVariant value) -> void {
-					if (param != "recording-position")
-						return;
-					QObject::disconnect(connections.take("get-position"));
-					position = value.toFloat();
-					requestData();
-				}));
+	if (reader) {
+		requestData();
+	} else {
+		client->get("recording-position");
+		connections.insert("get-position",
+				QObject::connect(client, &BldsClient::getResponse,
+					[&](QString param, bool /* valid */, QVariant value) -> void {
+						if (param != "recording-position")
+							return;
+						QObject::disconnect(connections.take("get-position"));
+						position = value.toFloat();
+						requestData();
+					}));
+	}
 
 	statusBar()->showMessage("Visualization started", StatusMessageTimeout);
 	playbackStatus = PlaybackStatus::Playing;
@@ -641,6 +856,9 @@ void MeaviewWindow::startPlayback()
 
 void MeaviewWindow::endRecording() 
 {
+	if (scheduler) {
+		scheduler->stop();
+	}
 	if (client) {
 		client->disconnect(); // just disconnect, don't fuck with others
 	}
@@ -663,12 +881,193 @@ void MeaviewWindow::endRecording()
 	statusBar()->showMessage("Recording ended", StatusMessageTimeout * 2);
 }
 
-void MeaviewWindow::receiveDataFrame(const DataFrame& frame)
+void MeaviewWindow::receiveDataFrame(const DataFrame& frame, qint64 received)
 {
-	plotWindow->transferDataToSubplots(frame.data());
+	sampleframe::SampleFrame samples(frame.data());
+	samples.setReceived(received);
+	plotWindow->transferDataToSubplots(samples);
 	position = frame.stop();
+}
+
+void MeaviewWindow::openRecordingFile()
+{
+	auto filename = QFileDialog::getOpenFileName(this, tr("Open recording file"),
+			QString(), tr("HDF5 recordings (*.h5 *.hdf5);;"
+				"Raw recordings (*.bin *.raw);;All files (*)"));
+	if (filename.isEmpty())
+		return;
+	closeRecordingFile();
+
+	/* The reader lives in its own thread, so that reading from disk
+	 * never blocks the interface. Anything other than an HDF5 file
+	 * is assumed to be a raw recording.
+	 */
+	auto suffix = QFileInfo(filename).suffix().toLower();
+	if ((suffix == "h5") || (suffix == "hdf5"))
+		reader = new hdf5reader::Hdf5Reader(filename);
+	else
+		reader = new rawreader::RawReader(filename);
+	reader->moveToThread(readerThread);
+	QObject::connect(readerThread, &QThread::finished,
+			reader, &QObject::deleteLater);
+	QObject::connect(reader, &recordingreader::RecordingReader::opened,
+			this, &MeaviewWindow::handleRecordingFileOpened);
+	QObject::connect(reader, &recordingreader::RecordingReader::data,
+			this, &MeaviewWindow::receiveRecordingData);
+	QObject::connect(reader, &recordingreader::RecordingReader::endOfFile,
+			this, &MeaviewWindow::handleRecordingFileEnd);
+	QObject::connect(reader, &recordingreader::RecordingReader::error,
+			this, &MeaviewWindow::handleRecordingFileError);
+	QObject::connect(this, &MeaviewWindow::requestRecordingData,
+			reader, &recordingreader::RecordingReader::requestData);
+	if (!readerThread->isRunning())
+		readerThread->start();
+
+	serverLine->setEnabled(false);
+	connectToDataServerAction->setEnabled(false);
+	connectToDataServerButton->setEnabled(false);
+	openRecordingFileAction->setEnabled(false);
+	statusBar()->showMessage(QString("Opening recording file %1 ...").arg(filename));
+	QMetaObject::invokeMethod(reader, "open", Qt::QueuedConnection);
+}
+
+void MeaviewWindow::handleRecordingFileOpened(const QJsonObject& status)
+{
+	auto length = status["recording-length"].toDouble();
+	settings.setValue("recording/exists", true);
+	settings.setValue("recording/length", length);
+	settings.setValue("recording/position", 0.0);
+	position = 0.;
+
+	setupDataSource(status);
+	totalTimeLine->setText(QString::number(length, 'f', 1));
+	setPlaybackMovementButtonsEnabled(true);
+	closeRecordingFileAction->setEnabled(true);
+	statusBar()->showMessage(QString("Opened recording file %1").arg(reader->filename()),
+			StatusMessageTimeout);
+}
+
+void MeaviewWindow::receiveRecordingData(double /* start */, double stop,
+		const sampleframe::SampleFrame& frame)
+{
+	auto received = latency::now();
+	if (!recordingRequestTimes.isEmpty())
+		latency::record(latency::Segment::Network,
+				received - recordingRequestTimes.dequeue());
+	auto stamped = frame;
+	stamped.setReceived(received);
+	plotWindow->transferDataToSubplots(stamped);
+	position = stop;
+	if ((playbackStatus == PlaybackStatus::Playing) && !plotWindow->isThrottling())
+		requestData();
+}
+
+void MeaviewWindow::handleRecordingFileEnd()
+{
+	if (!recordingRequestTimes.isEmpty())
+		recordingRequestTimes.dequeue();
 	if (playbackStatus == PlaybackStatus::Playing)
+		pausePlayback();
+	statusBar()->showMessage("Reached the end of the recording file",
+			StatusMessageTimeout);
+}
+
+void MeaviewWindow::handleRecordingFileError(const QString& msg)
+{
+	QMessageBox::critical(this, "Recording file error", msg);
+	closeRecordingFile();
+}
+
+void MeaviewWindow::closeRecordingFile()
+{
+	if (!reader)
+		return;
+
+	QObject::disconnect(this, &MeaviewWindow::requestRecordingData, 0, 0);
+	QObject::disconnect(reader, 0, this, 0);
+	reader->deleteLater();
+	reader.clear();
+	recordingRequestTimes.clear();
+	playbackStatus = PlaybackStatus::Paused;
+
+	serverLine->setEnabled(true);
+	connectToDataServerAction->setEnabled(true);
+	connectToDataServerButton->setEnabled(true);
+	openRecordingFileAction->setEnabled(true);
+	closeRecordingFileAction->setEnabled(false);
+	settings.remove("recording/exists");
+	settings.remove("recording/length");
+	settings.remove("recording/position");
+	timeLine->setText("");
+	totalTimeLine->setText("0");
+
+	QObject::disconnect(dataConfigurationBox, 0, 0, 0);
+	dataConfigurationBox->clear();
+	dataConfigurationBox->setEnabled(false);
+	setPlaybackMovementButtonsEnabled(false);
+	startPlaybackButton->setText("Start");
+	startPlaybackButton->setEnabled(false);
+	startPlaybackAction->setText(tr("&Start"));
+	startPlaybackAction->setEnabled(false);
+	QObject::disconnect(startPlaybackAction, &QAction::triggered, this, 0);
+
+	plotWindow->clear();
+	activityMap->clear();
+	spikeRaster->clear();
+	position = 0.0;
+
+	statusBar()->showMessage("Closed recording file", StatusMessageTimeout);
+}
+
+void MeaviewWindow::handleDroppedFrames()
+{
+	auto total = plotWindow->droppedFrames() + (scheduler ? scheduler->droppedFrames() : 0);
+	droppedFramesLabel->setText(QString("Dropped frames: %1").arg(total));
+	statusBar()->showMessage(QString("Playback fell behind, %1 frames dropped").arg(total),
+			StatusMessageTimeout);
+}
+
+void MeaviewWindow::handleMissedDeadlines(int total)
+{
+	missedDeadlinesLabel->setText(QString("Missed deadlines: %1").arg(total));
+}
+
+void MeaviewWindow::handleThrottle(bool throttling)
+{
+	/* The scheduler holds back new requests, while the reader is
+	 * simply not asked for the next frame until the plots catch up.
+	 */
+	if (scheduler) {
+		scheduler->setHeld(throttling);
+	} else if (reader && !throttling && (playbackStatus == PlaybackStatus::Playing) &&
+			recordingRequestTimes.isEmpty()) {
 		requestData();
+	}
+}
+
+void MeaviewWindow::updateBackpressurePolicy(QAction* action)
+{
+	auto name = action->data().toString();
+	settings.setValue("playback/backpressure", name);
+	plotWindow->setBackpressurePolicy(plotwindow::backpressurePolicyFromName(name));
+}
+
+void MeaviewWindow::showActivityMap(bool checked)
+{
+	if (checked)
+		centralStack->setCurrentWidget(activityMap);
+	else
+		centralStack->setCurrentWidget(plotWindow);
+	plotWindow->setTracesShown(!checked);
+	settings.setValue("display/traces", !checked);
+	displayconfig::publish(settings);
+}
+
+void MeaviewWindow::updateActivityMeasure(QAction* action)
+{
+	auto name = action->data().toString();
+	settings.setValue("display/activity-measure", name);
+	activityMap->setMeasure(activitymap::measureFromName(name));
 }
 
 void MeaviewWindow::updateTime(int npoints)
@@ -677,12 +1076,42 @@ void MeaviewWindow::updateTime(int npoints)
 			settings.value("data/sample-rate").toDouble());
 	timeLine->setText(QString("%1 - %2").arg(
 				start, 0, 'f', 1).arg(position, 0, 'f', 1));
+	latencyLabel->setText(latency::statusText());
+}
+
+void MeaviewWindow::saveLatencyStatistics()
+{
+	auto filename = QFileDialog::getSaveFileName(this, tr("Save latency statistics"),
+			QString(), tr("JSON files (*.json)"));
+	if (filename.isEmpty())
+		return;
+	QJsonObject stats {
+		{ "time", QDateTime::currentDateTime().toString(Qt::ISODate) },
+		{ "source", reader ? reader->filename() :
+			(client ? serverLine->text() : QString()) },
+		{ "array", settings.value("data/array").toString() },
+		{ "nchannels", settings.value("data/nchannels").toInt() },
+		{ "sample-rate", settings.value("data/sample-rate").toDouble() },
+		{ "refresh", settings.value("display/refresh").toDouble() },
+		{ "position", position },
+		{ "latency", latency::toJson() },
+	};
+	QFile file(filename);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+			(file.write(QJsonDocument(stats).toJson()) < 0)) {
+		QMessageBox::critical(this, "Latency statistics",
+				QString("Could not write the latency statistics to %1: %2").arg(
+					filename).arg(file.errorString()));
+		return;
+	}
+	statusBar()->showMessage(QString("Saved latency statistics to %1").arg(filename),
+			StatusMessageTimeout);
 }
 
 void MeaviewWindow::jumpToStart() 
 {
 	position = 0.;
-	client->getData(position, position + settings.value("display/refresh").toDouble());
+	requestFrame(position, position + settings.value("display/refresh").toDouble());
 }
 
 void MeaviewWindow::jumpBackward() 
@@ -690,18 +1119,24 @@ void MeaviewWindow::jumpBackward()
 	auto refresh = settings.value("display/refresh").toDouble();
 	if (position > refresh) {
 		position = qMax(0.0, position - 2 * refresh);
-		client->getData(position, position + refresh);
+		requestFrame(position, position + refresh);
 	}
 }
 
 void MeaviewWindow::jumpForward() 
 {
 	auto refresh = settings.value("display/refresh").toDouble();
-	client->getData(position, position + refresh);
+	requestFrame(position, position + refresh);
 }
 
 void MeaviewWindow::jumpToEnd() 
 {
+	if (reader) {
+		auto refresh = settings.value("display/refresh").toDouble();
+		position = qMax(0.0, settings.value("recording/length").toDouble() - refresh);
+		requestFrame(position, position + refresh);
+		return;
+	}
 	connections.insert("position", 
 			QObject::connect(client, &BldsClient::getResponse,
 			[&](const QString& param, bool /* valid */, const QVariant& value) -> void {
@@ -711,7 +1146,7 @@ void MeaviewWindow::jumpToEnd()
 					QObject::disconnect(connections.take("position"));
 				position = value.toDouble() - 
 					settings.value("display/refresh").toDouble();
-				client->getData(position, position + 
+				scheduler->request(position, position + 
 						settings.value("display/refresh").toDouble());
 			}));
 	client->get("recording-position");
@@ -721,16 +1156,43 @@ void MeaviewWindow::updateAutoscale(int state)
 {
 	scaleBox->setEnabled(state != Qt::Checked);
 	settings.setValue("display/autoscale", state == Qt::Checked);
+	displayconfig::publish(settings);
+}
+
+void MeaviewWindow::updateSweep(int state)
+{
+	settings.setValue("display/sweep", state == Qt::Checked);
+	displayconfig::publish(settings);
 }
 
 void MeaviewWindow::updateScale(double scale) 
 {
 	settings.setValue("display/scale", scale);
+	displayconfig::publish(settings);
 }
 
 void MeaviewWindow::updateRefresh(double refresh) 
 {
 	settings.setValue("display/refresh", refresh);
+	displayconfig::publish(settings);
+}
+
+void MeaviewWindow::updateTileRendering(bool checked)
+{
+	settings.setValue("display/tile-rendering", checked);
+	displayconfig::publish(settings);
+}
+
+void MeaviewWindow::updateSpikeDetection(bool checked)
+{
+	settings.setValue("display/spike-detection", checked);
+	displayconfig::publish(settings);
+}
+
+void MeaviewWindow::updateFiltering(bool checked)
+{
+	settings.setValue("display/filter", checked);
+	displayconfig::publish(settings);
 }
 
 void MeaviewWindow::minify(bool checked) 
@@ -795,6 +1257,7 @@ void MeaviewWindow::updateChannelView()
 {
 	settings.setValue("display/view", dataConfigurationBox->currentText());
 	plotWindow->updateChannelView();
+	activityMap->updateLayout();
 }
 
 }; // end meaviewwindow namespace
@@ -9,18 +9,38 @@
 
 #include <QFont>
 
+#include <algorithm>
 #include <cmath>
-#include <cstring>
 
 namespace meaview {
 namespace plotwindow {
 
+BackpressurePolicy backpressurePolicyFromName(const QString& name)
+{
+	auto index = plotwindow::BackpressurePolicyNames.indexOf(name);
+	if (index < 0)
+		index = plotwindow::BackpressurePolicyNames.indexOf(
+				plotwindow::DefaultBackpressurePolicy);
+	return static_cast<BackpressurePolicy>(index);
+}
+
 PlotWindow::PlotWindow(QWidget* parent) 
 	: QWidget(parent, Qt::Widget)
 {
 	setGeometry(meaviewwindow::WindowPosition.first, 
 			meaviewwindow::WindowPosition.second, 
 			meaviewwindow::WindowSize.first, meaviewwindow::WindowSize.second);
+	qRegisterMetaType<sampleframe::SampleFrame>();
+	qRegisterMetaType<spikedetector::SpikeList>();
+	qRegisterMetaType<channelstats::ActivityList>();
+	policy = backpressurePolicyFromName(settings.value("playback/backpressure",
+				plotwindow::DefaultBackpressurePolicy).toString());
+	frameTimer = new QTimer(this);
+	frameTimer->setTimerType(Qt::PreciseTimer);
+	QObject::connect(frameTimer, &QTimer::timeout,
+			this, &PlotWindow::handleFrameTick);
+	setFrameRate(settings.value("display/frame-rate",
+				plotwindow::DefaultFrameRate).toDouble());
 	initThreadPool();
 	initPlot();
 	QObject::connect(plot, &QCustomPlot::mouseDoubleClick,
@@ -55,7 +75,7 @@ void PlotWindow::initThreadPool()
 void PlotWindow::initPlot()
 {
 	/* Create plot */
-	plot = new QCustomPlot(this);
+	plot = new gridplot::GridPlot(this);
 	plot->plotLayout()->removeAt(0);
 	plot->plotLayout()->setRowSpacing(plotwindow::RowSpacing);
 	plot->plotLayout()->setColumnSpacing(plotwindow::ColumnSpacing);
@@ -71,10 +91,9 @@ void PlotWindow::initPlot()
 void PlotWindow::setupWindow(const QString& array, int nchannels)
 {
 	nsubplots = nchannels;
-	subplotsUpdated.resize(nsubplots);
-	subplotsUpdated.fill(false);
 	subplotsDeleted.resize(nsubplots);
 	subplotsDeleted.fill(false);
+	subplotsRemaining = nsubplots;
 
 	/* Setup plot grid and view */
 	computePlotGridSize();
@@ -84,8 +103,17 @@ void PlotWindow::setupWindow(const QString& array, int nchannels)
 	/* Compute the valid channels. */
 	computePlotColors(computeValidDataChannels());
 
-	int threadNum = 0;
 	bool isHidens = array.startsWith("hidens");
+
+	/* Channels which are not electrodes are never filtered. */
+	QVector<int> passthrough;
+	if (isHidens)
+		passthrough.append(nchannels - 1);
+	else
+		passthrough = plotwindow::McsAutoscaledChannels.toVector();
+	filterBank.setPassthrough(passthrough);
+	filterBank.reset();
+
 	QString label;
 	for (auto i = 0; i < gridSize.first; i++) {
 		for (auto j = 0; j < gridSize.second; j++) {
@@ -113,13 +141,10 @@ void PlotWindow::setupWindow(const QString& array, int nchannels)
 			/* Create a subplot for this channel */
 			auto sp = new subplot::Subplot(chan, label, idx, position, plot);
 
-			/* Connect signals/slots for communicating with subplot */
-			QObject::connect(this, &PlotWindow::sendDataToSubplot,
-					sp, &subplot::Subplot::handleNewData);
-			QObject::connect(sp, &subplot::Subplot::plotReady, 
-					this, &PlotWindow::incrementNumPlotsUpdated);
-			QObject::connect(this, &PlotWindow::deleteSubplots,
-					sp, &subplot::Subplot::requestDelete);
+			/* Connect signals/slots for communicating with subplot.
+			 * Data is sent and deletion requested through the subplot's
+			 * worker, which is created below.
+			 */
 			QObject::connect(sp, &subplot::Subplot::deleted,
 					this, &PlotWindow::handleSubplotDeleted);
 			QObject::connect(this, &PlotWindow::updateRefresh,
@@ -127,36 +152,141 @@ void PlotWindow::setupWindow(const QString& array, int nchannels)
 			plot->plotLayout()->addElement(position.first, 
 					position.second, sp->rect());
 
-			/* Move this subplot to the appropriate background thread. */
 			subplots.append(sp);
-			sp->moveToThread(transferThreads.at(threadNum));
-			threadNum += 1;
-			threadNum %= transferThreads.size();
 		}
 	}
+	assignSubplotsToWorkers();
+	plot->invalidateFrame();
 	plot->replot();
 }
 
-void PlotWindow::incrementNumPlotsUpdated(int idx, int npoints)
+void PlotWindow::assignSubplotsToWorkers()
 {
-	/* Update our bitarray indicating that this plot 
-	 * has been updated, and replot the whole grid if
-	 * all have done so.
+	/* Split the subplots, ordered by channel, into contiguous ranges, 
+	 * one per transfer thread. Each worker then reads adjacent columns
+	 * of every frame.
 	 */
-	subplotsUpdated.setBit(idx);
-	if (subplotsUpdated.count(true) < subplotsUpdated.size())
+	auto byChannel = subplots;
+	std::sort(byChannel.begin(), byChannel.end(),
+			[](subplot::Subplot* a, subplot::Subplot* b) {
+				return a->channel() < b->channel();
+			});
+	auto nworkers = qMin(transferThreads.size(), byChannel.size());
+	for (auto i = 0; i < nworkers; i++) {
+		auto begin = (i * byChannel.size()) / nworkers;
+		auto end = ((i + 1) * byChannel.size()) / nworkers;
+		auto slice = byChannel.mid(begin, end - begin);
+		auto worker = new subplotworker::SubplotWorker(i, slice);
+
+		QObject::connect(this, &PlotWindow::sendDataToWorkers,
+				worker, &subplotworker::SubplotWorker::handleNewData);
+		QObject::connect(worker, &subplotworker::SubplotWorker::plotsReady,
+				this, &PlotWindow::incrementNumPlotsUpdated);
+		QObject::connect(worker, &subplotworker::SubplotWorker::frameHandled,
+				this, &PlotWindow::handleFrameHandled);
+		QObject::connect(worker, &subplotworker::SubplotWorker::spikesDetected,
+				this, &PlotWindow::spikesDetected);
+		QObject::connect(worker, &subplotworker::SubplotWorker::activityMeasured,
+				this, &PlotWindow::activityMeasured);
+		QObject::connect(this, &PlotWindow::deleteSubplots,
+				worker, &subplotworker::SubplotWorker::requestDelete);
+
+		/* Move the worker and its subplots to their background thread. */
+		auto thread = transferThreads.at(i);
+		for (auto& sp : slice)
+			sp->moveToThread(thread);
+		worker->moveToThread(thread);
+		workers.append(worker);
+	}
+	workerGenerations.fill(0, workers.size());
+	replotGeneration = 1;
+	workersPending = workers.size();
+	framesInFlight.fill(0, workers.size());
+	droppedFrameCount = 0;
+	missedDeadlineCount = 0;
+	lastReplotTime = 0;
+	frameTimer->start();
+}
+
+void PlotWindow::incrementNumPlotsUpdated(int idx, int npoints, qint64 received)
+{
+	/* Count each worker once per generation, i.e., once per
+	 * replot, and replot the whole grid when the count of pending
+	 * workers reaches zero. A worker may report several times per
+	 * generation in sweep mode. All of this happens in the GUI
+	 * thread, so a plain countdown suffices, and each report is 
+	 * handled in constant time whatever the number of workers.
+	 */
+	if (workerGenerations.at(idx) != replotGeneration) {
+		if (workersPending == workers.size())
+			generationStarted = latency::now();
+		workerGenerations[idx] = replotGeneration;
+		workersPending -= 1;
+	}
+	blockReceived = std::max(blockReceived, received);
+	pendingPoints = npoints;
+	if (workersPending > 0)
 		return;
-	replot(npoints);
+
+	/* Replot right away, unless that would exceed the target frame
+	 * rate, in which case the next tick of the frame timer does.
+	 */
+	if ((latency::now() - lastReplotTime) >= frameIntervalNs())
+		replot(pendingPoints, blockReceived);
+}
+
+void PlotWindow::handleFrameTick()
+{
+	/* Nothing has been published since the last replot. */
+	if (workers.isEmpty() || (workersPending == workers.size()))
+		return;
+
+	/* Wait up to a frame for the remaining workers, and then replot
+	 * whatever has been published, rather than letting the slowest
+	 * thread hold back the whole grid. The blocks of the late workers
+	 * are drawn on a later frame.
+	 */
+	if (workersPending > 0) {
+		if ((latency::now() - generationStarted) < frameIntervalNs())
+			return;
+		missDeadline();
+	}
+	replot(pendingPoints, blockReceived);
+}
+
+void PlotWindow::setFrameRate(double rate)
+{
+	targetFrameRate = qBound(plotwindow::MinFrameRate, rate, plotwindow::MaxFrameRate);
+	frameTimer->setInterval(static_cast<int>(std::round(1000. / targetFrameRate)));
+}
+
+void PlotWindow::setTracesShown(bool shown)
+{
+	showTraces = shown;
+}
+
+qint64 PlotWindow::frameIntervalNs() const
+{
+	return static_cast<qint64>(1e9 / targetFrameRate);
+}
+
+void PlotWindow::missDeadline()
+{
+	missedDeadlineCount += 1;
+	emit deadlinesMissed(missedDeadlineCount);
 }
 
 void PlotWindow::handleSubplotDeleted(int index)
 {
 	/* Update our bitarray indicating that this plot
 	 * has been deleted, and clear the whole grid if
-	 * all have been deleted.
+	 * all have been deleted. The bits only guard against
+	 * counting a subplot twice.
 	 */
+	if (subplotsDeleted.testBit(index))
+		return;
 	subplotsDeleted.setBit(index);
-	if (subplotsDeleted.count(true) < subplotsDeleted.size())
+	if (--subplotsRemaining > 0)
 		return;
 	handleAllSubplotsDeleted();
 }
@@ -176,19 +306,28 @@ void PlotWindow::clear()
 		each->deleteLater();
 	}
 	emit numInspectorsChanged(inspectors.size());
+	resetBackpressure();
+	filterBank.reset();
 	emit deleteSubplots();
 }
 
 void PlotWindow::handleAllSubplotsDeleted()
 {
-	/* Lock and clear all subplots/data/graphs/etc. */
-	lock.lockForWrite();
+	/* Clear all subplots/data/graphs/etc. */
 	subplots.clear();
+	workers.clear(); // workers delete themselves
+	workerGenerations.clear();
+	workersPending = 0;
+	frameTimer->stop();
+	blockReceived = 0;
+	resetBackpressure();
+	framesInFlight.clear();
 	plot->plotLayout()->clear();
-	plot->clearGraphs();
+	plot->clearPlottables();
+	plot->invalidateFrame();
 	plot->replot();
-	lock.unlock();
 	subplotsDeleted.fill(false);
+	subplotsRemaining = nsubplots;
 	emit cleared();
 }
 
@@ -210,11 +349,12 @@ void PlotWindow::createChannelInspector(QMouseEvent* event)
 		}
 	}
 
-	/* Create a new inspector from this channel. */
-	lock.lockForRead();
+	/* Create a new inspector from this channel, and start collecting
+	 * the channel's history, from which the inspector draws.
+	 */
 	auto c = new channelinspector::ChannelInspector(plot,
-			sp->graph(), sp->channel(), sp->label(), this);
-	lock.unlock();
+			sp->graph(), sp->history(), sp->channel(), sp->label(), this);
+	QMetaObject::invokeMethod(sp, "enableHistory", Qt::QueuedConnection);
 	QObject::connect(c, &channelinspector::ChannelInspector::aboutToClose,
 			this, &PlotWindow::removeChannelInspector);
 
@@ -236,6 +376,12 @@ void PlotWindow::removeChannelInspector(int channel)
 	if (inspectors.size() == 0)
 		return;
 
+	/* Stop collecting the channel's history. */
+	for (auto& sp : subplots) {
+		if (sp->channel() == channel)
+			QMetaObject::invokeMethod(sp, "disableHistory", Qt::QueuedConnection);
+	}
+
 	/* Find inspector and delete it. */
 	for (auto i = 0; i < inspectors.size(); i++) {
 		if (inspectors.at(i)->channel() == channel) {
@@ -261,6 +407,10 @@ void PlotWindow::handleChannelClick(QMouseEvent* event)
 		clickedPlots.remove(sp);
 	else
 		clickedPlots.insert(sp);
+
+	/* Highlight the plot immediately. Only this subplot is redrawn. */
+	sp->setClicked(clickedPlots.contains(sp));
+	plot->replot();
 }
 
 subplot::Subplot* PlotWindow::findSubplotContainingPoint(const QPoint& point)
@@ -275,22 +425,109 @@ subplot::Subplot* PlotWindow::findSubplotContainingPoint(const QPoint& point)
 
 void PlotWindow::transferDataToSubplots(const DataFrame::Samples& d)
 {
-	for (auto c = 0; c < nsubplots; c++) {
+	transferDataToSubplots(sampleframe::SampleFrame(d));
+}
 
-		/* Copy appropriate channel into new vector.
-		 *
-		 * NOTE: The subplot will delete this, it *must not* be deleted
-		 * in this method.
-		 */
-		auto chan = subplots.at(c)->channel();
-		auto vec = new QVector<DataFrame::DataType>(d.n_rows);
-		std::memcpy(vec->data(), d.colptr(chan),
-				sizeof(DataFrame::DataType) * d.n_rows);
-
-		/* Send data */
-		emit sendDataToSubplot(subplots.at(c), vec, &lock, 
-				clickedPlots.contains(subplots.at(c)));
+void PlotWindow::transferDataToSubplots(const sampleframe::SampleFrame& frame)
+{
+	pendingFrames.enqueue(filterFrame(frame));
+	dispatchPendingFrames();
+	applyBackpressure();
+}
+
+sampleframe::SampleFrame PlotWindow::filterFrame(const sampleframe::SampleFrame& frame)
+{
+	/* The state is primed again whenever filtering is turned back on,
+	 * since the data it was left with is long gone.
+	 */
+	const auto& cfg = config.get();
+	if (!cfg.filter) {
+		filterBank.reset();
+		return frame;
 	}
+	MEAVIEW_PROFILE_SCOPE(Filter);
+	filterBank.configure(cfg.sampleRate, cfg.filterLow, cfg.filterHigh);
+	auto filtered = filterBank.filter(frame);
+	filtered.setReceived(frame.received());
+	return filtered;
+}
+
+void PlotWindow::dispatchPendingFrames()
+{
+	while (!pendingFrames.isEmpty()) {
+		auto inFlight = framesInFlight.isEmpty() ? 0 :
+			*std::max_element(framesInFlight.begin(), framesInFlight.end());
+		if (inFlight >= plotwindow::MaxFramesInFlight)
+			return;
+		dispatchFrame(pendingFrames.dequeue());
+	}
+}
+
+void PlotWindow::dispatchFrame(const sampleframe::SampleFrame& frame)
+{
+	MEAVIEW_PROFILE_SCOPE(FanOut);
+
+	/* Share a single copy of the frame among all workers, each of
+	 * which receives one queued call for all of its subplots.
+	 */
+	QBitArray clicked(nsubplots);
+	for (auto& sp : clickedPlots)
+		clicked.setBit(sp->index());
+	for (auto& count : framesInFlight)
+		count += 1;
+	emit sendDataToWorkers(frame, clicked);
+}
+
+void PlotWindow::handleFrameHandled(int idx)
+{
+	if (idx >= framesInFlight.size())
+		return;
+	framesInFlight[idx] = std::max(framesInFlight.at(idx) - 1, 0);
+	dispatchPendingFrames();
+	applyBackpressure();
+}
+
+void PlotWindow::applyBackpressure()
+{
+	/* Frames are dropped from the front of the queue, so that the
+	 * newest data is always plotted. When throttling, the source is
+	 * asked to stop as soon as any frame must wait, and frames are
+	 * only dropped if it keeps sending them anyway.
+	 */
+	auto dropped = 0;
+	auto limit = plotwindow::MaxPendingFrames;
+	if ((policy == BackpressurePolicy::SkipToLatest) && (pendingFrames.size() > limit))
+		limit = 1;
+	while (pendingFrames.size() > limit) {
+		pendingFrames.dequeue();
+		dropped += 1;
+	}
+	if (dropped > 0) {
+		droppedFrameCount += dropped;
+		emit framesDropped(droppedFrameCount);
+	}
+
+	auto throttle = (policy == BackpressurePolicy::Throttle) && !pendingFrames.isEmpty();
+	if (throttle != throttling) {
+		throttling = throttle;
+		emit throttleChanged(throttling);
+	}
+}
+
+void PlotWindow::resetBackpressure()
+{
+	pendingFrames.clear();
+	framesInFlight.fill(0);
+	if (throttling) {
+		throttling = false;
+		emit throttleChanged(false);
+	}
+}
+
+void PlotWindow::setBackpressurePolicy(BackpressurePolicy p)
+{
+	policy = p;
+	applyBackpressure();
 }
 
 
@@ -340,11 +577,15 @@ QMap<int, bool> PlotWindow::computeValidDataChannels()
 {
 	QMap<int, bool> valid;
 	if (settings.value("data/array").toString().startsWith("hidens")) {
-		/* Retrieve electrode positions */
+		/* Retrieve electrode positions. There is no configuration
+		 * for data played back from a file, and all channels are
+		 * then considered valid.
+		 */
 		auto electrodes = settings.value("data/hidens-configuration").toList();
 		for (auto i = 0; i < nsubplots; i++) {
 			/* Invalid channels have 0 for their index. */
-			valid.insert(i, electrodes.at(i).toList().at(0).toUInt() != 0);
+			valid.insert(i, (i >= electrodes.size()) || 
+					(electrodes.at(i).toList().at(0).toUInt() != 0));
 		}
 	} else {
 		for (auto i = 0; i < nsubplots; i++) {
@@ -370,6 +611,7 @@ void PlotWindow::updateChannelView()
 	/* Create new view and move subplots there. */
 	createChannelView();
 	moveSubplots();
+	plot->invalidateFrame();
 }
 
 void PlotWindow::moveSubplots()
@@ -442,24 +684,41 @@ void PlotWindow::computePlotColors(const QMap<int, bool>& valid)
 	settings.setValue("display/plot-pens", pens);
 }
 
-void PlotWindow::replot(int npoints)
+void PlotWindow::replot(int npoints, qint64 received)
 {
+	auto ready = latency::now();
+	lastReplotTime = ready;
+	if (received > 0)
+		latency::record(latency::Segment::Transfer, ready - received);
+
 	/* Thread-safe replotting. 
 	 *
-	 * A read-write lock is an unusual synchronization primitive, but
-	 * it maps perfectly onto what is done here. The many transfer
-	 * threads may be happily moving data to each subplot's back buffer,
-	 * which happens with no synchronization. When they want to swap
-	 * the front and back buffers, they must lock this for read. That's
-	 * to allow multiple transfer workers to proceed, as they manage
-	 * disjoint sets of subplots. This locks the lock for writing, meaning
-	 * that none of those front-back swaps may happen while the plot
-	 * is updating.
+	 * The transfer threads never touch the graphs. Each subplot publishes
+	 * its newest block through an atomic pointer, and the blocks are
+	 * adopted into the graphs here, in the GUI thread, just before the
+	 * replot. The transfer threads carry on filling the next blocks in
+	 * the meantime, and never wait for the replot to finish. While the
+	 * traces are hidden, the blocks are left for the first replot after
+	 * they are shown again.
 	 */
-	lock.lockForWrite();
-	plot->replot();
-	lock.unlock();
-	subplotsUpdated.fill(false);
+	if (showTraces) {
+		{
+			MEAVIEW_PROFILE_SCOPE(Adopt);
+			for (auto sp : subplots)
+				sp->updateGraph();
+		}
+		MEAVIEW_PROFILE_SCOPE(Replot);
+		plot->replot();
+	}
+	auto rendered = latency::now();
+	latency::record(latency::Segment::Render, rendered - ready);
+	if ((rendered - ready) > frameIntervalNs())
+		missDeadline();
+	if (received > 0)
+		latency::recordSince(latency::Segment::Total, received);
+	replotGeneration += 1;
+	workersPending = workers.size();
+	blockReceived = 0;
 	emit plotRefreshed(npoints);
 }
 
@@ -0,0 +1,76 @@
+/*! \file profiler.cc
+ *
+ * Implementation of the pipeline stage timers.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "profiler.h"
+
+#include <atomic>
+
+namespace meaview {
+namespace profiler {
+
+static const int NumStages = static_cast<int>(Stage::NumStages);
+
+/* Statistics of each stage, updated from any thread. */
+static std::atomic<qint64> counts[NumStages];
+static std::atomic<qint64> totals[NumStages];
+static std::atomic<qint64> maxima[NumStages];
+
+void record(Stage stage, qint64 ns)
+{
+	auto i = static_cast<int>(stage);
+	counts[i].fetch_add(1, std::memory_order_relaxed);
+	totals[i].fetch_add(ns, std::memory_order_relaxed);
+	auto max = maxima[i].load(std::memory_order_relaxed);
+	while ((ns > max) && !maxima[i].compare_exchange_weak(max, ns,
+				std::memory_order_relaxed)) {
+	}
+}
+
+StageStats stats(Stage stage)
+{
+	auto i = static_cast<int>(stage);
+	StageStats s;
+	s.count = counts[i].load(std::memory_order_relaxed);
+	s.totalNs = totals[i].load(std::memory_order_relaxed);
+	s.maxNs = maxima[i].load(std::memory_order_relaxed);
+	return s;
+}
+
+void reset()
+{
+	for (auto i = 0; i < NumStages; i++) {
+		counts[i].store(0, std::memory_order_relaxed);
+		totals[i].store(0, std::memory_order_relaxed);
+		maxima[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+QString stageName(Stage stage)
+{
+	switch (stage) {
+		case Stage::FanOut:
+			return "fan-out";
+		case Stage::HandleNewData:
+			return "handleNewData";
+		case Stage::FormatPlot:
+			return "formatPlot";
+		case Stage::Replot:
+			return "replot";
+		case Stage::Adopt:
+			return "adopt";
+		case Stage::DetectSpikes:
+			return "detectSpikes";
+		case Stage::Filter:
+			return "filter";
+		default:
+			return "unknown";
+	}
+}
+
+}; // end profiler namespace
+}; // end meaview namespace
+
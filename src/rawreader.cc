@@ -0,0 +1,114 @@
+/*! \file rawreader.cc
+ *
+ * Implementation of the RawReader class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "rawreader.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cmath>
+#include <algorithm>
+
+namespace meaview {
+namespace rawreader {
+
+RawReader::RawReader(const QString& filename)
+	: recordingreader::RecordingReader(filename)
+{
+}
+
+RawReader::~RawReader()
+{
+}
+
+void RawReader::open()
+{
+	/* Read the description of the file. */
+	QFile metadataFile(m_filename + rawreader::MetadataSuffix);
+	if (!metadataFile.open(QIODevice::ReadOnly)) {
+		emit error(QString("Could not read the description of the recording "
+					"file %1 from %2: %3").arg(m_filename).arg(
+					metadataFile.fileName()).arg(metadataFile.errorString()));
+		return;
+	}
+	QJsonParseError parseError;
+	auto doc = QJsonDocument::fromJson(metadataFile.readAll(), &parseError);
+	if ((parseError.error != QJsonParseError::NoError) || !doc.isObject()) {
+		emit error(QString("The description of the recording file %1 in %2 "
+					"is not a valid JSON object.").arg(m_filename).arg(
+					metadataFile.fileName()));
+		return;
+	}
+	auto metadata = doc.object();
+	m_nchannels = metadata["nchannels"].toInt();
+	m_headerSize = metadata["header-size"].toInt(0);
+	if ((m_nchannels <= 0) || (m_headerSize < 0) ||
+			(m_headerSize % sizeof(DataFrame::DataType))) {
+		emit error(QString("The description of the recording file %1 must "
+					"give a positive number of channels, and a header size "
+					"which is a whole number of samples.").arg(m_filename));
+		return;
+	}
+	auto array = metadata["array"].toString(
+			(m_nchannels > MaxMcsChannels) ? "hidens" : "mcs");
+	m_sampleRate = metadata["sample-rate"].toDouble(
+			array.startsWith("hidens") ? HiDensSampleRate : McsSampleRate);
+
+	/* Map the whole file. Pages are only read from disk when the
+	 * samples in them are first touched.
+	 */
+	auto mapping = std::make_shared<Mapping>();
+	mapping->file.setFileName(m_filename);
+	if (!mapping->file.open(QIODevice::ReadOnly)) {
+		emit error(QString("Could not open the recording file %1: %2").arg(
+					m_filename).arg(mapping->file.errorString()));
+		return;
+	}
+	auto size = mapping->file.size();
+	m_nsamples = std::max<qint64>(0, (size - m_headerSize) / (offsetOf(1) - offsetOf(0)));
+	if (m_nsamples > 0) {
+		mapping->data = mapping->file.map(0, size, QFileDevice::MapPrivateOption);
+		if (!mapping->data) {
+			emit error(QString("Could not map the recording file %1: %2").arg(
+						m_filename).arg(mapping->file.errorString()));
+			return;
+		}
+	}
+	m_mapping = mapping;
+
+	QJsonObject status;
+	status["device-type"] = array;
+	status["nchannels"] = m_nchannels;
+	status["gain"] = metadata["gain"].toDouble(1.0);
+	status["sample-rate"] = m_sampleRate;
+	status["recording-length"] = m_nsamples / m_sampleRate;
+	emit opened(status);
+}
+
+qint64 RawReader::sampleAt(double time) const
+{
+	return std::max<qint64>(0, std::llround(time * m_sampleRate));
+}
+
+void RawReader::requestData(double start, double stop)
+{
+	auto first = sampleAt(start);
+	auto last = std::min(sampleAt(stop), m_nsamples);
+	if (!m_mapping || (first >= last)) {
+		emit endOfFile();
+		return;
+	}
+	auto samples = reinterpret_cast<const DataFrame::DataType*>(
+			m_mapping->data + offsetOf(first));
+	emit data(first / m_sampleRate, last / m_sampleRate,
+			sampleframe::SampleFrame(samples, static_cast<int>(last - first),
+				m_nchannels, m_mapping));
+}
+
+}; // end rawreader namespace
+}; // end meaview namespace
+
@@ -0,0 +1,25 @@
+/*! \file recordingreader.cc
+ *
+ * Implementation of the RecordingReader class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "recordingreader.h"
+
+namespace meaview {
+namespace recordingreader {
+
+RecordingReader::RecordingReader(const QString& filename)
+	: QObject(nullptr),
+	m_filename(filename)
+{
+}
+
+RecordingReader::~RecordingReader()
+{
+}
+
+}; // end recordingreader namespace
+}; // end meaview namespace
+
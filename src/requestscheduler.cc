@@ -0,0 +1,155 @@
+/*! \file requestscheduler.cc
+ *
+ * Implementation of the RequestScheduler class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "requestscheduler.h"
+#include "settings.h"
+
+#include <cmath>
+
+namespace meaview {
+namespace requestscheduler {
+
+RequestScheduler::RequestScheduler(BldsClient* client, QObject* parent)
+	: QObject(parent),
+	m_client(client),
+	m_depth(meaviewwindow::DefaultRequestDepth),
+	m_chunkSize(meaviewwindow::DataChunkRequestSize / 1000.),
+	m_maxLag(meaviewwindow::MaxLiveLag)
+{
+}
+
+RequestScheduler::~RequestScheduler()
+{
+}
+
+void RequestScheduler::setDepth(int depth)
+{
+	m_depth = qMax(depth, 1);
+	fillPipeline();
+}
+
+void RequestScheduler::setChunkSize(double size)
+{
+	m_chunkSize = size;
+}
+
+void RequestScheduler::setMaxLag(double lag)
+{
+	m_maxLag = lag;
+}
+
+void RequestScheduler::start(double position, bool live)
+{
+	stop();
+	m_running = true;
+	m_live = live;
+	m_next = position;
+	m_liveOrigin = position;
+	m_liveTimer.start();
+	fillPipeline();
+}
+
+void RequestScheduler::stop()
+{
+	m_running = false;
+	m_outstanding.clear();
+	m_received.clear();
+}
+
+void RequestScheduler::setHeld(bool held)
+{
+	m_held = held;
+	fillPipeline();
+}
+
+void RequestScheduler::request(double start, double stop)
+{
+	if (!m_client)
+		return;
+	m_outstanding.append(Request{ start, stop, latency::now() });
+	m_client->getData(start, stop);
+}
+
+void RequestScheduler::fillPipeline()
+{
+	if (!m_client)
+		return;
+	while (m_running && !m_held && (m_outstanding.size() < m_depth)) {
+		request(m_next, m_next + m_chunkSize);
+		m_next += m_chunkSize;
+	}
+}
+
+double RequestScheduler::liveEstimate() const
+{
+	return m_liveOrigin + m_liveTimer.elapsed() / 1000.;
+}
+
+void RequestScheduler::handleData(const DataFrame& frame)
+{
+	/* Find the outstanding request satisfied by this frame. Frames
+	 * matching no request were abandoned by `stop()`, and are ignored.
+	 */
+	auto time = latency::now();
+	auto match = -1;
+	auto distance = 0.0;
+	for (auto i = 0; i < m_outstanding.size(); i++) {
+		const auto& req = m_outstanding.at(i);
+		auto d = std::abs(frame.start() - req.start);
+		if ((d < 0.5 * (req.stop - req.start)) && ((match < 0) || (d < distance))) {
+			match = i;
+			distance = d;
+		}
+	}
+	if (match < 0)
+		return;
+	const auto& req = m_outstanding.at(match);
+	latency::record(latency::Segment::Network, time - req.issued);
+	m_received.insert(req.start, Received{ frame, time });
+	releaseReadyFrames();
+	fillPipeline();
+}
+
+void RequestScheduler::handleError(const QString& /* msg */)
+{
+	if (m_outstanding.isEmpty())
+		return;
+
+	/* Any frame already received for the failed request is stale too. */
+	m_received.remove(m_outstanding.takeFirst().start);
+	m_dropped += 1;
+	emit framesDropped(m_dropped);
+	releaseReadyFrames();
+	fillPipeline();
+}
+
+void RequestScheduler::releaseReadyFrames()
+{
+	auto dropped = 0;
+	while (!m_outstanding.isEmpty() && m_received.contains(m_outstanding.first().start)) {
+		auto received = m_received.take(m_outstanding.takeFirst().start);
+		const auto& frame = received.frame;
+
+		/* Drop frames which are too far behind a live recording, and
+		 * skip subsequent requests ahead to catch up.
+		 */
+		if (m_running && m_live && (frame.stop() < (liveEstimate() - m_maxLag))) {
+			dropped += 1;
+			m_next = qMax(m_next, liveEstimate() - m_chunkSize);
+			continue;
+		}
+		emit frameReady(frame, received.time);
+	}
+	if (dropped > 0) {
+		m_dropped += dropped;
+		emit framesDropped(m_dropped);
+	}
+}
+
+}; // end requestscheduler namespace
+}; // end meaview namespace
+
@@ -0,0 +1,92 @@
+/*! \file samplebuffer.cc
+ *
+ * Implementation of the SampleBuffer class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "samplebuffer.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace meaview {
+namespace samplebuffer {
+
+SampleBuffer::SampleBuffer(int capacity)
+	: m_data(capacity)
+{
+}
+
+void SampleBuffer::setCapacity(int capacity)
+{
+	if (capacity != m_data.size())
+		m_data.resize(capacity);
+	clear();
+}
+
+void SampleBuffer::clear()
+{
+	m_start = 0;
+	m_size = 0;
+}
+
+void SampleBuffer::append(const DataFrame::DataType* data, int n)
+{
+	auto cap = m_data.size();
+	if ((cap == 0) || (n <= 0))
+		return;
+
+	/* Only the most recent `cap` samples can ever be retained. */
+	if (n >= cap) {
+		std::memcpy(m_data.data(), data + (n - cap),
+				sizeof(DataFrame::DataType) * cap);
+		m_start = 0;
+		m_size = cap;
+		return;
+	}
+
+	/* Copy up to the end of storage, and wrap any remainder to the front. */
+	auto write = m_start + m_size;
+	if (write >= cap)
+		write -= cap;
+	auto first = std::min(n, cap - write);
+	std::memcpy(m_data.data() + write, data,
+			sizeof(DataFrame::DataType) * first);
+	if (first < n) {
+		std::memcpy(m_data.data(), data + first,
+				sizeof(DataFrame::DataType) * (n - first));
+	}
+
+	/* Advance the start past any overwritten samples. */
+	m_size += n;
+	if (m_size > cap) {
+		m_start += (m_size - cap);
+		if (m_start >= cap)
+			m_start -= cap;
+		m_size = cap;
+	}
+}
+
+const DataFrame::DataType* SampleBuffer::firstSegment(int& length) const
+{
+	length = std::min(m_size, m_data.size() - m_start);
+	return m_data.constData() + m_start;
+}
+
+const DataFrame::DataType* SampleBuffer::secondSegment(int& length) const
+{
+	length = m_size - std::min(m_size, m_data.size() - m_start);
+	return m_data.constData();
+}
+
+void SampleBuffer::swap(SampleBuffer& other)
+{
+	m_data.swap(other.m_data);
+	std::swap(m_start, other.m_start);
+	std::swap(m_size, other.m_size);
+}
+
+}; // end samplebuffer namespace
+}; // end meaview namespace
+
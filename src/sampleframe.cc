@@ -0,0 +1,55 @@
+/*! \file sampleframe.cc
+ *
+ * Implementation of the SampleFrame class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "sampleframe.h"
+
+#include <utility>
+
+namespace meaview {
+namespace sampleframe {
+
+SampleFrame::SampleFrame()
+{
+}
+
+SampleFrame::SampleFrame(const DataFrame::Samples& samples)
+	: m_samples(new DataFrame::Samples(samples))
+{
+}
+
+SampleFrame::SampleFrame(DataFrame::Samples&& samples)
+	: m_samples(new DataFrame::Samples(std::move(samples)))
+{
+}
+
+SampleFrame::SampleFrame(const DataFrame::DataType* data, int nsamples, int nchannels,
+		const std::shared_ptr<const void>& owner)
+	: m_interleaved(true),
+	m_owner(owner)
+{
+	/* The matrix uses the samples in place, and is never written to. */
+	m_samples.reset(new DataFrame::Samples(const_cast<DataFrame::DataType*>(data),
+				nchannels, nsamples, false, true));
+}
+
+const DataFrame::DataType* SampleFrame::contiguousChannel(int chan,
+		QVector<DataFrame::DataType>* buffer) const
+{
+	auto data = channel(chan);
+	if (!m_interleaved)
+		return data;
+	auto n = nsamples(), step = stride();
+	buffer->resize(n);
+	auto out = buffer->data();
+	for (auto i = 0; i < n; i++)
+		out[i] = data[i * step];
+	return out;
+}
+
+}; // end sampleframe namespace
+}; // end meaview namespace
+
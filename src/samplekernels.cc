@@ -0,0 +1,204 @@
+/*! \file samplekernels.cc
+ *
+ * Implementation of the vectorized sample kernels.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "samplekernels.h"
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MEAVIEW_KERNELS_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MEAVIEW_KERNELS_SSE2
+#endif
+
+namespace meaview {
+namespace samplekernels {
+
+static_assert(std::is_same<DataFrame::DataType, int16_t>::value,
+		"The vectorized kernels operate on 16-bit samples");
+
+/* Number of vectors whose pairwise sums may be accumulated in 32-bit
+ * lanes before they could overflow, as each pair sums to at most 2^16.
+ * Pairwise sums of squares are at most 2^31, which fits an unsigned
+ * 32-bit lane, and are widened to 64 bits on every vector.
+ */
+static const int MaxVectorsPerFlush = 1 << 14;
+
+/* Scalar loop, used for the tail of each run and when no vector
+ * instructions are available.
+ */
+static void reduceScalar(const DataFrame::DataType* data, int n, Summary* summary)
+{
+	auto lo = summary->min, hi = summary->max;
+	qint64 sum = 0, sumSquares = 0;
+	for (auto i = 0; i < n; i++) {
+		auto sample = data[i];
+		lo = std::min(lo, sample);
+		hi = std::max(hi, sample);
+		sum += sample;
+		sumSquares += static_cast<qint64>(sample) * sample;
+	}
+	summary->min = lo;
+	summary->max = hi;
+	summary->sum += sum;
+	summary->sumSquares += sumSquares;
+	summary->count += n;
+}
+
+#if defined(MEAVIEW_KERNELS_AVX2)
+
+static const int VectorSize = 16;
+
+static int reduceVector(const DataFrame::DataType* data, int n, Summary* summary)
+{
+	auto nvectors = n / VectorSize;
+	if (nvectors == 0)
+		return 0;
+	auto lo = _mm256_set1_epi16(summary->min);
+	auto hi = _mm256_set1_epi16(summary->max);
+	auto ones = _mm256_set1_epi16(1);
+	auto zero = _mm256_setzero_si256();
+	auto squares = _mm256_setzero_si256();
+	qint64 total = 0;
+	for (auto first = 0; first < nvectors; first += MaxVectorsPerFlush) {
+		auto last = std::min(nvectors, first + MaxVectorsPerFlush);
+		auto sum = _mm256_setzero_si256();
+		for (auto v = first; v < last; v++) {
+			auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+					data + v * VectorSize));
+			lo = _mm256_min_epi16(lo, x);
+			hi = _mm256_max_epi16(hi, x);
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, ones));
+			auto sq = _mm256_madd_epi16(x, x);
+			squares = _mm256_add_epi64(squares, _mm256_unpacklo_epi32(sq, zero));
+			squares = _mm256_add_epi64(squares, _mm256_unpackhi_epi32(sq, zero));
+		}
+		alignas(32) int32_t sums[8];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(sums), sum);
+		for (auto s : sums)
+			total += s;
+	}
+	alignas(32) int16_t mins[VectorSize], maxs[VectorSize];
+	alignas(32) int64_t sumSquares[4];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(mins), lo);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(maxs), hi);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(sumSquares), squares);
+	summary->min = *std::min_element(mins, mins + VectorSize);
+	summary->max = *std::max_element(maxs, maxs + VectorSize);
+	summary->sum += total;
+	for (auto s : sumSquares)
+		summary->sumSquares += s;
+	summary->count += nvectors * VectorSize;
+	return nvectors * VectorSize;
+}
+
+#elif defined(MEAVIEW_KERNELS_SSE2)
+
+static const int VectorSize = 8;
+
+static int reduceVector(const DataFrame::DataType* data, int n, Summary* summary)
+{
+	auto nvectors = n / VectorSize;
+	if (nvectors == 0)
+		return 0;
+	auto lo = _mm_set1_epi16(summary->min);
+	auto hi = _mm_set1_epi16(summary->max);
+	auto ones = _mm_set1_epi16(1);
+	auto zero = _mm_setzero_si128();
+	auto squares = _mm_setzero_si128();
+	qint64 total = 0;
+	for (auto first = 0; first < nvectors; first += MaxVectorsPerFlush) {
+		auto last = std::min(nvectors, first + MaxVectorsPerFlush);
+		auto sum = _mm_setzero_si128();
+		for (auto v = first; v < last; v++) {
+			auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+					data + v * VectorSize));
+			lo = _mm_min_epi16(lo, x);
+			hi = _mm_max_epi16(hi, x);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(x, ones));
+			auto sq = _mm_madd_epi16(x, x);
+			squares = _mm_add_epi64(squares, _mm_unpacklo_epi32(sq, zero));
+			squares = _mm_add_epi64(squares, _mm_unpackhi_epi32(sq, zero));
+		}
+		alignas(16) int32_t sums[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(sums), sum);
+		for (auto s : sums)
+			total += s;
+	}
+	alignas(16) int16_t mins[VectorSize], maxs[VectorSize];
+	alignas(16) int64_t sumSquares[2];
+	_mm_store_si128(reinterpret_cast<__m128i*>(mins), lo);
+	_mm_store_si128(reinterpret_cast<__m128i*>(maxs), hi);
+	_mm_store_si128(reinterpret_cast<__m128i*>(sumSquares), squares);
+	summary->min = *std::min_element(mins, mins + VectorSize);
+	summary->max = *std::max_element(maxs, maxs + VectorSize);
+	summary->sum += total;
+	for (auto s : sumSquares)
+		summary->sumSquares += s;
+	summary->count += nvectors * VectorSize;
+	return nvectors * VectorSize;
+}
+
+#else
+
+static int reduceVector(const DataFrame::DataType*, int, Summary*)
+{
+	return 0;
+}
+
+#endif
+
+void summarize(const DataFrame::DataType* data, int n, Summary* summary)
+{
+	if (n <= 0)
+		return;
+	auto done = reduceVector(data, n, summary);
+	reduceScalar(data + done, n - done, summary);
+}
+
+int findBelow(const DataFrame::DataType* data, int n, DataFrame::DataType level)
+{
+	auto i = 0;
+#if defined(MEAVIEW_KERNELS_AVX2)
+	auto threshold = _mm256_set1_epi16(level);
+	for (; i + VectorSize <= n; i += VectorSize) {
+		auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		if (_mm256_movemask_epi8(_mm256_cmpgt_epi16(threshold, x)))
+			break; // the scalar loop finds the sample within this vector
+	}
+#elif defined(MEAVIEW_KERNELS_SSE2)
+	auto threshold = _mm_set1_epi16(level);
+	for (; i + VectorSize <= n; i += VectorSize) {
+		auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		if (_mm_movemask_epi8(_mm_cmplt_epi16(x, threshold)))
+			break;
+	}
+#endif
+	for (; i < n; i++) {
+		if (data[i] < level)
+			return i;
+	}
+	return n;
+}
+
+const char* instructionSet()
+{
+#if defined(MEAVIEW_KERNELS_AVX2)
+	return "avx2";
+#elif defined(MEAVIEW_KERNELS_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+}; // end samplekernels namespace
+}; // end meaview namespace
+
@@ -0,0 +1,147 @@
+/*! \file spikedetector.cc
+ *
+ * Implementation of the SpikeDetector class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "spikedetector.h"
+#include "samplekernels.h"
+#include "settings.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace meaview {
+namespace spikedetector {
+
+SpikeDetector::SpikeDetector()
+	: m_window(spikedetector::NoiseWindowSamples),
+	m_scratch(spikedetector::NoiseWindowSamples)
+{
+}
+
+void SpikeDetector::configure(double sampleRate, double threshold)
+{
+	if (sampleRate != m_sampleRate) {
+		m_sampleRate = sampleRate;
+		m_refractory = std::max(1,
+				static_cast<int>(std::lround(spikedetector::RefractoryPeriod * sampleRate)));
+		m_stride = std::max(1, static_cast<int>(std::lround(spikedetector::NoiseWindow *
+				sampleRate / spikedetector::NoiseWindowSamples)));
+		m_updateInterval = std::max(1, static_cast<int>(std::lround(
+				spikedetector::NoiseUpdateInterval * sampleRate)));
+		m_threshold = threshold;
+		reset();
+	} else if (threshold != m_threshold) {
+		m_threshold = threshold;
+		updateLevel();
+	}
+}
+
+void SpikeDetector::reset()
+{
+	m_refractoryEnd = m_position;
+	m_phase = 0;
+	m_sinceUpdate = 0;
+	m_windowPosition = 0;
+	m_windowSize = 0;
+	m_median = 0.0;
+	m_noise = 0.0;
+	updateLevel();
+}
+
+int SpikeDetector::detect(const DataFrame::DataType* data, int n, int channel,
+		SpikeList* spikes)
+{
+	if (n <= 0)
+		return 0;
+
+	/* Scan for crossings with the current level, starting after any
+	 * refractory period carried over from the last chunk. The trough
+	 * of a spike at the end of a chunk is found only within that chunk.
+	 */
+	auto count = 0;
+	auto i = static_cast<int>(std::min<qint64>(n,
+				std::max<qint64>(0, m_refractoryEnd - m_position)));
+	while (i < n) {
+		i += samplekernels::findBelow(data + i, n - i, m_level);
+		if (i >= n)
+			break;
+		auto end = std::min(n, i + m_refractory);
+		spikes->append({ m_position + i, channel, *std::min_element(data + i, data + end) });
+		count += 1;
+		i += m_refractory;
+	}
+	m_refractoryEnd = m_position + i;
+
+	/* The chunk is added to the noise window only after it has been
+	 * scanned, so the level is always estimated from earlier samples.
+	 */
+	sampleNoise(data, n);
+	m_position += n;
+	return count;
+}
+
+void SpikeDetector::skip(int n)
+{
+	m_position += std::max(n, 0);
+}
+
+void SpikeDetector::sampleNoise(const DataFrame::DataType* data, int n)
+{
+	if (m_sampleRate <= 0.0)
+		return;
+	auto i = m_phase;
+	for (; i < n; i += m_stride) {
+		m_window[m_windowPosition] = data[i];
+		m_windowPosition = (m_windowPosition + 1) % m_window.size();
+		m_windowSize = std::min(m_windowSize + 1, m_window.size());
+	}
+	m_phase = i - n;
+
+	m_sinceUpdate += n;
+	if (m_sinceUpdate >= m_updateInterval) {
+		m_sinceUpdate = 0;
+		estimateNoise();
+	}
+}
+
+void SpikeDetector::estimateNoise()
+{
+	if (m_windowSize == 0)
+		return;
+
+	/* The median, and then the median of the absolute deviations from
+	 * it, are each found in linear time with a partial sort.
+	 */
+	auto begin = m_scratch.begin(), end = m_scratch.begin() + m_windowSize;
+	auto middle = begin + m_windowSize / 2;
+	std::copy(m_window.cbegin(), m_window.cbegin() + m_windowSize, begin);
+	std::nth_element(begin, middle, end);
+	auto median = *middle;
+	std::transform(begin, end, begin,
+			[median](int sample) -> int { return std::abs(sample - median); });
+	std::nth_element(begin, middle, end);
+	m_median = median;
+	m_noise = spikedetector::MadToStandardDeviation * (*middle);
+	updateLevel();
+}
+
+void SpikeDetector::updateLevel()
+{
+	/* A channel with no noise, e.g., one which is not connected,
+	 * has no threshold, rather than one at its median.
+	 */
+	const auto lowest = std::numeric_limits<DataFrame::DataType>::lowest();
+	if (m_noise <= 0.0) {
+		m_level = lowest;
+		return;
+	}
+	auto level = std::ceil(m_median - m_threshold * m_noise);
+	m_level = static_cast<DataFrame::DataType>(std::max<double>(level, lowest));
+}
+
+}; // end spikedetector namespace
+}; // end meaview namespace
+
@@ -0,0 +1,243 @@
+/*! \file spikeraster.cc
+ *
+ * Implementation of the SpikeRaster class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "spikeraster.h"
+
+#include <QHelpEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <cmath>
+
+namespace meaview {
+namespace spikeraster {
+
+SpikeRaster::SpikeRaster(QWidget* parent)
+	: QWidget(parent),
+	store(spikestore::MemoryBudget / sizeof(qint64))
+{
+	setMinimumHeight(spikeraster::MinimumHeight);
+	windowDuration = qBound(spikeraster::MinWindow,
+			settings.value("display/raster-window",
+				spikeraster::DefaultWindow).toDouble(),
+			spikeraster::MaxWindow);
+	frameTimer = new QTimer(this);
+	QObject::connect(frameTimer, &QTimer::timeout,
+			this, &SpikeRaster::handleFrameTick);
+	setFrameRate(settings.value("display/frame-rate",
+				plotwindow::DefaultFrameRate).toDouble());
+}
+
+SpikeRaster::~SpikeRaster()
+{
+}
+
+QSize SpikeRaster::sizeHint() const
+{
+	return QSize(4 * spikeraster::MinimumHeight, 2 * spikeraster::MinimumHeight);
+}
+
+void SpikeRaster::setupRaster(const QString& arr, int n)
+{
+	array = arr;
+	nchannels = n;
+	store.reset(nchannels);
+	received.fill(0, nchannels);
+	now = 0;
+	dirty = true;
+}
+
+void SpikeRaster::clear()
+{
+	array.clear();
+	nchannels = 0;
+	store.reset(0);
+	received.clear();
+	now = 0;
+	render();
+	dirty = false;
+	update();
+}
+
+void SpikeRaster::setWindow(double duration)
+{
+	windowDuration = qBound(spikeraster::MinWindow, duration, spikeraster::MaxWindow);
+	settings.setValue("display/raster-window", windowDuration);
+	dirty = true;
+}
+
+void SpikeRaster::setFrameRate(double rate)
+{
+	rate = qBound(plotwindow::MinFrameRate, rate, plotwindow::MaxFrameRate);
+	frameTimer->setInterval(static_cast<int>(std::round(1000. / rate)));
+}
+
+void SpikeRaster::handleSpikes(const spikedetector::SpikeList& spikes)
+{
+	store.append(spikes);
+	dirty = true;
+}
+
+void SpikeRaster::handleActivity(const channelstats::ActivityList& activity)
+{
+	for (const auto& a : activity) {
+		if ((a.channel < 0) || (a.channel >= nchannels))
+			continue;
+		received[a.channel] += a.samples;
+		now = std::max(now, received.at(a.channel));
+	}
+	dirty = true;
+}
+
+void SpikeRaster::handleFrameTick()
+{
+	if (!dirty)
+		return;
+	dirty = false;
+	render();
+	update();
+}
+
+qint64 SpikeRaster::windowSamples()
+{
+	auto sampleRate = config.get().sampleRate;
+	if (sampleRate <= 0)
+		return 1;
+	return std::max<qint64>(1, static_cast<qint64>(windowDuration * sampleRate));
+}
+
+QRect SpikeRaster::rasterRect() const
+{
+	return rect().adjusted(spikeraster::Margin, spikeraster::Margin / 2,
+			-spikeraster::Margin, -spikeraster::Margin);
+}
+
+int SpikeRaster::channelAt(const QPoint& point) const
+{
+	auto area = rasterRect();
+	if ((nchannels == 0) || !area.contains(point))
+		return -1;
+	auto channel = static_cast<int>((static_cast<qint64>(point.y() - area.top()) *
+				nchannels) / area.height());
+	return std::min(channel, nchannels - 1);
+}
+
+void SpikeRaster::render()
+{
+	auto area = rasterRect();
+	if (area.isEmpty()) {
+		image = QImage();
+		return;
+	}
+	if (image.size() != area.size())
+		image = QImage(area.size(), QImage::Format_RGB32);
+	image.fill(plotwindow::BackgroundColor.color());
+	if (nchannels == 0)
+		return;
+
+	/* Each channel's row spans at least one line of pixels, and rows
+	 * share lines when there are more channels than lines. Spikes in
+	 * the window are found directly in the store, and each is a run of
+	 * pixels down its row.
+	 */
+	const auto span = windowSamples();
+	const auto begin = now - span;
+	const auto color = spikeraster::SpikeColor.rgb();
+	const auto w = image.width();
+	const auto h = image.height();
+	for (auto c = 0; c < nchannels; c++) {
+		auto top = (c * h) / nchannels;
+		auto bottom = std::max(top + 1, ((c + 1) * h) / nchannels);
+		int count = 0;
+		auto times = store.range(c, begin, now, &count);
+		for (auto i = 0; i < count; i++) {
+			auto x = static_cast<int>(((times[i] - begin) * w) / span);
+			if ((x < 0) || (x >= w))
+				continue;
+			for (auto y = top; y < bottom; y++)
+				reinterpret_cast<QRgb*>(image.scanLine(y))[x] = color;
+		}
+	}
+}
+
+void SpikeRaster::paintEvent(QPaintEvent*)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), plotwindow::BackgroundColor);
+	auto area = rasterRect();
+	if (!image.isNull())
+		painter.drawImage(area.topLeft(), image);
+
+	/* Time axis along the bottom, labeled with the window shown. */
+	if (nchannels == 0)
+		return;
+	painter.setPen(subplot::LabelColor);
+	painter.setFont(subplot::LabelFont);
+	painter.drawRect(area.adjusted(-1, -1, 0, 0));
+	QRect labels(area.left(), area.bottom(), area.width(), spikeraster::Margin);
+	painter.drawText(labels, Qt::AlignLeft | Qt::AlignVCenter,
+			QString("-%1 s").arg(windowDuration, 0, 'g', 3));
+	painter.drawText(labels, Qt::AlignHCenter | Qt::AlignVCenter,
+			QString("%1 channels").arg(nchannels));
+	painter.drawText(labels, Qt::AlignRight | Qt::AlignVCenter, "0 s");
+}
+
+void SpikeRaster::resizeEvent(QResizeEvent* event)
+{
+	render();
+	QWidget::resizeEvent(event);
+}
+
+void SpikeRaster::showEvent(QShowEvent* event)
+{
+	render();
+	frameTimer->start();
+	QWidget::showEvent(event);
+}
+
+void SpikeRaster::hideEvent(QHideEvent* event)
+{
+	frameTimer->stop();
+	QWidget::hideEvent(event);
+}
+
+void SpikeRaster::wheelEvent(QWheelEvent* event)
+{
+	/* Each step of the wheel widens or narrows the window by a quarter. */
+	auto steps = event->angleDelta().y() / 120.;
+	if (steps == 0) {
+		event->ignore();
+		return;
+	}
+	setWindow(windowDuration * std::pow(1.25, -steps));
+	event->accept();
+}
+
+bool SpikeRaster::event(QEvent* event)
+{
+	if (event->type() == QEvent::ToolTip) {
+		auto help = static_cast<QHelpEvent*>(event);
+		auto channel = channelAt(help->pos());
+		if (channel < 0) {
+			QToolTip::hideText();
+			event->ignore();
+		} else {
+			auto count = store.count(channel, now - windowSamples(), now);
+			QToolTip::showText(help->globalPos(),
+					QString("Channel %1: %2 spikes (%3 Hz)").arg(channel).arg(
+						count).arg(count / windowDuration, 0, 'f', 1));
+		}
+		return true;
+	}
+	return QWidget::event(event);
+}
+
+}; // end spikeraster namespace
+}; // end meaview namespace
+
@@ -0,0 +1,126 @@
+/*! \file spikestore.cc
+ *
+ * Implementation of the SpikeStore class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "spikestore.h"
+#include "settings.h"
+
+#include <algorithm>
+
+namespace meaview {
+namespace spikestore {
+
+SpikeStore::SpikeStore(qint64 capacity)
+	: m_capacity(std::max<qint64>(capacity, 1))
+{
+}
+
+void SpikeStore::reset(int nchannels)
+{
+	m_channels = QVector<Channel>(nchannels);
+	m_size = 0;
+	m_agedOut = 0;
+	m_latest = -1;
+	m_horizon = 0;
+}
+
+void SpikeStore::setCapacity(qint64 capacity)
+{
+	m_capacity = std::max<qint64>(capacity, 1);
+	enforceCapacity();
+}
+
+void SpikeStore::append(const spikedetector::SpikeList& spikes)
+{
+	for (const auto& spike : spikes) {
+		if ((spike.channel < 0) || (spike.channel >= m_channels.size()) ||
+				(spike.sample < m_horizon))
+			continue;
+		auto& times = m_channels[spike.channel].times;
+		if (!times.isEmpty() && (spike.sample < times.last()))
+			continue;
+		times.append(spike.sample);
+		m_latest = std::max(m_latest, spike.sample);
+		m_size += 1;
+	}
+	enforceCapacity();
+}
+
+const qint64* SpikeStore::range(int channel, qint64 begin, qint64 end, int* count) const
+{
+	*count = 0;
+	if ((channel < 0) || (channel >= m_channels.size()))
+		return nullptr;
+	const auto& ch = m_channels.at(channel);
+	auto first = std::lower_bound(ch.times.cbegin() + ch.head, ch.times.cend(), begin);
+	auto last = std::lower_bound(first, ch.times.cend(), std::max(begin, end));
+	*count = static_cast<int>(last - first);
+	return ch.times.constData() + (first - ch.times.cbegin());
+}
+
+int SpikeStore::count(int channel, qint64 begin, qint64 end) const
+{
+	int n = 0;
+	range(channel, begin, end, &n);
+	return n;
+}
+
+void SpikeStore::ageOutBefore(qint64 time)
+{
+	if (time <= m_horizon)
+		return;
+	m_horizon = time;
+	for (auto& ch : m_channels) {
+		auto first = std::lower_bound(ch.times.cbegin() + ch.head, ch.times.cend(), time);
+		auto head = static_cast<int>(first - ch.times.cbegin());
+		m_size -= (head - ch.head);
+		m_agedOut += (head - ch.head);
+		ch.head = head;
+
+		/* Reclaim the storage of aged-out spikes once they are half
+		 * the array, so each spike is moved at most once on average.
+		 */
+		if (ch.head > ch.times.size() / 2) {
+			ch.times.erase(ch.times.begin(), ch.times.begin() + ch.head);
+			ch.head = 0;
+		}
+	}
+}
+
+qint64 SpikeStore::countFrom(qint64 time) const
+{
+	qint64 n = 0;
+	for (const auto& ch : m_channels) {
+		auto first = std::lower_bound(ch.times.cbegin() + ch.head, ch.times.cend(), time);
+		n += ch.times.cend() - first;
+	}
+	return n;
+}
+
+void SpikeStore::enforceCapacity()
+{
+	if (m_size <= m_capacity)
+		return;
+
+	/* Find the earliest time from which the spikes on all channels fit
+	 * in the target, by bisecting the span of time held. Aging out to
+	 * well below the capacity means this is rarely needed.
+	 */
+	auto target = static_cast<qint64>(spikestore::AgeOutFraction * m_capacity);
+	auto lo = m_horizon, hi = m_latest + 1;
+	while ((hi - lo) > 1) {
+		auto mid = lo + (hi - lo) / 2;
+		if (countFrom(mid) <= target)
+			hi = mid;
+		else
+			lo = mid;
+	}
+	ageOutBefore(hi);
+}
+
+}; // end spikestore namespace
+}; // end meaview namespace
+
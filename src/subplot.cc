@@ -7,6 +7,9 @@
 
 #include "subplot.h"
 
+#include <algorithm>
+#include <atomic>
+
 namespace meaview {
 namespace subplot {
 
@@ -18,6 +21,10 @@ Subplot::Subplot(int chan, const QString& label,
 	m_label(label),
 	m_index(idx),
 	m_position(pos),
+	m_data(std::make_shared<traceblock::TraceData>()),
+	m_history(new lodpyramid::LodPyramid(channelinspector::HistoryLevelSize,
+			channelinspector::HistoryDecimationFactor,
+			channelinspector::HistoryLevels)),
 	m_ticks(3),
 	m_tickLabels(3)
 {
@@ -32,8 +39,12 @@ Subplot::Subplot(int chan, const QString& label,
 
 	/* Create subplot axis and graph for the data */
 	m_rect = new QCPAxisRect(parent); // parent will delete
-	m_graph = parent->addGraph(m_rect->axis(QCPAxis::atBottom), 
-			m_rect->axis(QCPAxis::atLeft)); // parent will delete
+	m_graph = new tracegraph::TraceGraph(m_rect->axis(QCPAxis::atBottom), 
+			m_rect->axis(QCPAxis::atLeft));
+	parent->addPlottable(m_graph); // parent will delete
+	m_graph->setLayer(gridplot::TraceLayerName);
+	m_graph->setPen(m_pen);
+	m_antialiased = m_graph->antialiased();
 
 	/* Format plot. */
 	auto keyAxis = m_graph->keyAxis();
@@ -62,6 +73,10 @@ Subplot::Subplot(int chan, const QString& label,
 	auto scale = m_settings.value("display/scale").toDouble()
 			* m_settings.value("display/scale-multiplier").toDouble();
 	valueAxis->setRange(-scale, scale);
+
+	/* The transfer thread formats each block starting from these ranges. */
+	m_keyRange = keyAxis->range();
+	m_valueRange = valueAxis->range();
 }
 
 Subplot::~Subplot()
@@ -76,109 +91,312 @@ void Subplot::requestDelete()
 	emit deleted(m_index);
 }
 
+void Subplot::enableHistory()
+{
+	/* The current block, and the back buffer holding everything
+	 * received since, are together the most recent contiguous data
+	 * for this channel.
+	 */
+	m_history->setEnabled(true);
+	for (auto buffer : { &m_data->samples, &m_backBuffer }) {
+		int length = 0;
+		auto segment = buffer->firstSegment(length);
+		m_history->append(segment, length);
+		segment = buffer->secondSegment(length);
+		m_history->append(segment, length);
+	}
+}
+
+void Subplot::disableHistory()
+{
+	m_history->setEnabled(false);
+}
+
 void Subplot::updatePlotBlockSize()
 {
-	m_plotBlockSize = static_cast<int>(
-			m_settings.value("display/refresh").toDouble() *
-			m_settings.value("data/sample-rate").toDouble());
+	m_plotBlockSize = m_config.get().plotBlockSize();
+
+	/* Discard any partial block, it is the wrong size. */
+	m_backBuffer.setCapacity(m_plotBlockSize);
+	m_decimator.reset(m_plotBlockSize, m_envelopeColumns);
+	m_backBufferPosition = 0;
 }
 
-void Subplot::handleNewData(Subplot* sp, QVector<DataFrame::DataType>* data, 
-		QReadWriteLock* lock, const bool clicked)
+int Subplot::handleNewData(const sampleframe::SampleFrame& frame, const bool clicked,
+		spikedetector::SpikeList* spikes)
 {
-	if (sp != this)
-		return;
+	MEAVIEW_PROFILE_SCOPE(HandleNewData);
+
+	/* Transfer single data block to back buffer. This is a bulk copy
+	 * of the raw samples, read in place from the shared frame, which
+	 * are converted to physical units only when they are drawn. The
+	 * chunk is also reduced into the envelope which is actually drawn,
+	 * so that this work is done here in the transfer thread rather
+	 * than during the replot. Channels of an interleaved frame are
+	 * gathered once, here in the transfer thread.
+	 */
+	auto data = frame.contiguousChannel(m_channel, &m_gatherBuffer);
+	auto size = frame.nsamples();
+	auto before = m_decimator.envelope().summary;
+	m_backBuffer.append(data, size);
+	m_decimator.append(data, size);
+	m_history->append(data, size);
+	m_backBufferPosition += size;
 
-	/* Transfer single data block to back buffer. */
-	auto gain = m_settings.value("data/gain").toDouble();
-	for (auto i = m_backBufferPosition; i < m_backBufferPosition + data->size(); i++) {
-		auto point = gain * static_cast<double>(
-				data->at(i - m_backBufferPosition));
-		m_backBuffer.insert(i, QCPData(i, point));
+	/* Search the chunk for spikes while it is still in cache. Chunks
+	 * are skipped rather than searched while detection is disabled, so
+	 * that the times of later spikes stay correct.
+	 */
+	const auto& config = m_config.get();
+	auto nspikes = 0;
+	if (config.spikeDetection) {
+		MEAVIEW_PROFILE_SCOPE(DetectSpikes);
+		m_spikeDetector.configure(config.sampleRate, config.spikeThreshold);
+		nspikes = m_spikeDetector.detect(data, size, m_channel, spikes);
+	} else {
+		m_spikeDetector.skip(size);
+	}
+
+	/* The sums of the chunk are the growth of those of the block, so
+	 * its variance costs no further pass over the samples. Samples past
+	 * the end of a block are not summarized, so a chunk completing a
+	 * block is measured only up to its end.
+	 */
+	const auto& after = m_decimator.envelope().summary;
+	samplekernels::Summary chunk;
+	chunk.count = after.count - before.count;
+	chunk.sum = after.sum - before.sum;
+	chunk.sumSquares = after.sumSquares - before.sumSquares;
+	m_activity.channel = m_channel;
+	m_activity.samples = size;
+	m_activity.spikes = nspikes;
+	m_activity.variance = (chunk.count > 0) ? static_cast<float>(
+			channelstats::SummaryStats::fromSummary(chunk).variance()) : -1.0f;
+
+	/* In sweep mode, draw the new chunk over the previous block right
+	 * away, rather than waiting for a full block. The back buffer holds
+	 * the current sweep, which is drawn incrementally over a tile of the
+	 * previous block. If the GUI thread still holds the last sweep tile,
+	 * painting detaches a copy of it, so the tile it draws never changes.
+	 */
+	auto pen = clicked ? m_selectedPen : m_pen;
+	QSize tileSize(m_tileWidth.load(std::memory_order_relaxed),
+			m_tileHeight.load(std::memory_order_relaxed));
+	auto shown = 0;
+	QRect dirtyRect;
+	if (config.sweep) {
+		auto end = std::min(m_backBufferPosition, m_plotBlockSize);
+		auto begin = std::max(0, end - size);
+		if (config.traces) {
+			auto rerendered = false;
+			if ((m_sweepTile.size() != tileSize) || (m_sweepPen != pen)) {
+				tracegraph::TraceGraph::renderTile(*m_data, &m_sweepTile, tileSize,
+						m_keyRange, m_valueRange, pen, m_antialiased);
+				m_sweepPen = pen;
+				rerendered = true;
+			}
+			auto rect = tracegraph::TraceGraph::sweepTile(&m_sweepTile, m_backBuffer,
+					begin, end, m_plotBlockSize, m_valueRange, config.gain, pen,
+					m_antialiased, subplot::SweepCursorWidth);
+			if (!rerendered)
+				dirtyRect = rect;
+		} else {
+			m_sweepTile = QImage(); // redrawn in full once traces are shown
+		}
+		shown = end;
 	}
-	m_backBufferPosition += data->size();
 
 	/* Full plot block available */
 	if (m_backBufferPosition >= m_plotBlockSize) {
 
-		/* Remove any excess data */
-		auto it = m_backBuffer.lowerBound(m_plotBlockSize);
-		while (it != m_backBuffer.end())
-			it = m_backBuffer.erase(it);
-
-		/* Lock the RW lock. This can be locked if any other thread
-		 * is performing a buffer swap, and is only blocked when the
-		 * main thread has acquired if for writing, during which the
-		 * actual drawing of the plot surface is done. In other words,
-		 * this prevents changing the data on the plot surface while
-		 * it is being rendered to the screen.
+		/* Move the block into fresh data, reusing the storage of the one
+		 * before the previous block if the GUI thread has released it. 
+		 * The fence pairs with the release of the last other reference,
+		 * so that the GUI thread's reads of it happen before it's reused.
+		 */
+		std::shared_ptr<traceblock::TraceData> next;
+		if (m_spareData && (m_spareData.use_count() == 1)) {
+			std::atomic_thread_fence(std::memory_order_acquire);
+			next = std::move(m_spareData);
+		} else {
+			next = std::make_shared<traceblock::TraceData>();
+		}
+		m_spareData = std::move(m_data);
+		next->samples.swap(m_backBuffer);
+		m_decimator.swapEnvelope(next->envelope);
+		next->gain = config.gain;
+		m_data = std::move(next);
+
+		/* In sweep mode, the tile already shows the new block, and 
+		 * the axes are formatted for the next sweep. Otherwise, the new
+		 * block is rasterized into a tile here, which the main thread
+		 * only has to copy onto the plot.
+		 */
+		formatPlot(config);
+		if (tileSize.width() > 0)
+			m_envelopeColumns = tileSize.width();
+		if (!config.sweep) {
+			m_sweepTile = QImage();
+			if (config.tileRendering && config.traces) {
+				if (!m_backTile.isDetached())
+					m_backTile = QImage(); // still drawn by the GUI thread
+				tracegraph::TraceGraph::renderTile(*m_data, &m_backTile, tileSize,
+						m_keyRange, m_valueRange, pen, m_antialiased);
+			}
+			dirtyRect = QRect();
+		}
+
+		/* The back buffer now holds the data from two blocks ago, if any.
+		 * Drop it, and make sure it matches the current block size, which
+		 * may have changed since it was allocated. The next envelope is
+		 * sized to the current width of the subplot.
 		 */
-		lock->lockForRead();
-		m_graph->data()->swap(m_backBuffer);
+		m_backBuffer.setCapacity(m_plotBlockSize);
+		m_decimator.reset(m_plotBlockSize, m_envelopeColumns);
 		m_backBufferPosition = 0;
-		formatPlot(clicked);
-		lock->unlock();
+		shown = m_plotBlockSize;
+	}
 
-		/* Notify PlotWindow. */
-		emit plotReady(m_index, m_plotBlockSize);
+	if (shown > 0)
+		publishBlock(config, pen, dirtyRect);
+	return shown;
+}
+
+void Subplot::publishBlock(const displayconfig::DisplayConfig& config,
+		const QPen& pen, const QRect& dirtyRect)
+{
+	auto block = std::make_shared<traceblock::TraceBlock>();
+	block->data = m_data;
+	if (config.traces) { // no tile is rendered while the traces are hidden
+		if (config.sweep)
+			block->tile = m_sweepTile;
+		else if (config.tileRendering)
+			block->tile = m_backTile;
 	}
-	delete data;
+	block->dirtyRect = dirtyRect;
+	block->pen = pen;
+	block->keyRange = m_keyRange;
+	block->valueRange = m_valueRange;
+	block->ticks = m_ticksShown;
+	block->tickVector = m_ticks;
+	block->tickLabels = m_tickLabels;
+	m_slot.publish(block);
+
+	/* Render the next block into the other tile. */
+	if (!config.sweep && config.tileRendering && config.traces)
+		m_backTile.swap(m_spareTile);
 }
 
-void Subplot::formatPlot(bool clicked) 
+void Subplot::updateGraph()
 {
-	/* Set pen, brighter for selected plots. */
-	if (clicked) {
-		m_graph->setPen(m_selectedPen);
+	m_tileWidth.store(m_rect->width(), std::memory_order_relaxed);
+	m_tileHeight.store(m_rect->height(), std::memory_order_relaxed);
+	auto block = m_slot.take();
+	if (!block)
+		return;
+
+	/* Only part of the graph need be redrawn if the new tile replaces
+	 * one of the same size, and the rest of it is unchanged. A tile drawn
+	 * with a different pen than the graph's, because the plot has been
+	 * clicked since, is not used.
+	 */
+	auto partial = (!block->dirtyRect.isNull() && !m_graph->tile().isNull() &&
+			(m_graph->tile().size() == block->tile.size()));
+	m_graph->setTraceData(block->data);
+	if (!block->tile.isNull() && (block->pen == m_graph->pen())) {
+		m_graph->setTile(block->tile);
 	} else {
-		m_graph->setPen(m_pen);
+		m_graph->clearTile();
+		partial = false;
 	}
+	if (partial)
+		m_graph->addDirtyRect(block->dirtyRect);
+	else
+		m_graph->setDirty(true);
 
-	if ( m_settings.value("display/autoscale").toBool() || m_autoscale ) {
+	/* The axes need only be redrawn if their ticks change. Ticks are
+	 * always at the bottom, center and top of the axis, so only their
+	 * visibility and labels can change.
+	 */
+	auto valueAxis = m_graph->valueAxis();
+	if ((valueAxis->ticks() != block->ticks) ||
+			(block->ticks && (valueAxis->tickVectorLabels() != block->tickLabels)))
+		m_graph->setFrameDirty(true);
+	valueAxis->setTicks(block->ticks);
+	valueAxis->setTickLabels(block->ticks);
+	if (block->ticks) {
+		valueAxis->setTickVector(block->tickVector);
+		valueAxis->setTickVectorLabels(block->tickLabels);
+	}
+	valueAxis->setRange(block->valueRange);
+	m_graph->keyAxis()->setRange(block->keyRange);
+}
+
+void Subplot::setClicked(bool clicked)
+{
+	m_graph->setPen(clicked ? m_selectedPen : m_pen);
+	m_graph->clearTile(); // drawn with the previous pen
+	m_graph->setDirty(true);
+}
+
+/* Return the range to which an axis showing the current range is rescaled
+ * to fit the given range of data, as QCPAxis::rescale() does. An empty range
+ * is centered in an axis of the current size.
+ */
+static QCPRange rescaled(const QCPRange& current, const QCPRange& range, bool foundRange)
+{
+	if (!foundRange)
+		return current;
+	if (!QCPRange::validRange(range)) {
+		auto center = range.center();
+		return QCPRange(center - current.size() / 2.0, center + current.size() / 2.0);
+	}
+	return range;
+}
+
+void Subplot::formatPlot(const displayconfig::DisplayConfig& config)
+{
+	MEAVIEW_PROFILE_SCOPE(FormatPlot);
+
+	bool foundRange = false;
+	if ( config.autoscale || m_autoscale ) {
 
 		/* Auto scale this subplot's y-axis to fit the data. This is just
 		 * done by rescaling the axis, and then drawing tick marks at
-		 * the values corresponding to true voltage values.
+		 * the values corresponding to true voltage values. The extrema
+		 * come from the block's statistics, accumulated as its chunks
+		 * arrived, rather than from another pass over the samples.
 		 */
-		m_graph->rescaleValueAxis();
-		m_graph->valueAxis()->setTicks(true);
-		m_graph->valueAxis()->setTickLabels(true);
+		auto range = m_data->valueRange(foundRange);
+		m_valueRange = rescaled(m_valueRange, range, foundRange);
+		m_ticksShown = true;
 
 		/* Write 3 ticks at upper/lower range and center, but draw
 		 * tick labels offset by that center (so center is 0)
 		 */
-		auto range = m_graph->valueAxis()->range();
-		auto center = range.center();
-		auto multiplier = m_settings.value("display/scale-multiplier").toDouble();
-		m_ticks = { range.lower, center, range.upper };
+		auto center = m_valueRange.center();
+		auto multiplier = config.scaleMultiplier;
+		m_ticks = { m_valueRange.lower, center, m_valueRange.upper };
 		m_tickLabels = { 
-				QString::number(((range.lower - center) / multiplier), 'f', 1),
+				QString::number(((m_valueRange.lower - center) / multiplier), 'f', 1),
 				"0",
-				QString::number(((range.upper - center) / multiplier), 'f', 1)
+				QString::number(((m_valueRange.upper - center) / multiplier), 'f', 1)
 			};
-		m_graph->valueAxis()->setTickVector(m_ticks);
-		m_graph->valueAxis()->setTickVectorLabels(m_tickLabels);
 
 	} else {
 
-		/* Compute mean. */
-		auto mean = 0.0;
-		auto data = m_graph->data();
-		for (auto i = 0; i < data->size(); i++) {
-			mean += data->value(i).value;
-		}
-		mean /= data->size();
+		/* The mean is also read from the block's statistics. */
+		auto mean = m_data->mean();
 
 		/* Turn off ticks and set y-axis limits to the full scale. */
-		m_graph->valueAxis()->setTicks(false);
-		m_graph->valueAxis()->setTickLabels(false);
-		auto scale = (m_settings.value("display/scale").toDouble()  *
-				m_settings.value("display/scale-multiplier").toDouble());
-		m_graph->valueAxis()->setRange(mean - scale, mean + scale);
+		m_ticksShown = false;
+		auto scale = config.scale * config.scaleMultiplier;
+		m_valueRange = QCPRange(mean - scale, mean + scale);
 
 	}
 
-	m_graph->rescaleKeyAxis();
+	auto range = m_data->keyRange(foundRange);
+	m_keyRange = rescaled(m_keyRange, range, foundRange);
 }
 
 }; // end subplot namespace
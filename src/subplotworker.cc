@@ -0,0 +1,60 @@
+/*! \file subplotworker.cc
+ *
+ * Implementation of the SubplotWorker class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "subplotworker.h"
+
+#include <algorithm>
+
+namespace meaview {
+namespace subplotworker {
+
+SubplotWorker::SubplotWorker(int index, const QList<subplot::Subplot*>& subplots)
+	: QObject(nullptr),
+	m_index(index),
+	m_subplots(subplots)
+{
+}
+
+SubplotWorker::~SubplotWorker()
+{
+}
+
+void SubplotWorker::handleNewData(const sampleframe::SampleFrame& frame,
+		const QBitArray& clicked)
+{
+	/* All subplots receive the same data and share a block size, 
+	 * so they are ready to be replotted on the same frame.
+	 */
+	auto npoints = 0;
+	spikedetector::SpikeList spikes;
+	channelstats::ActivityList activity;
+	activity.reserve(m_subplots.size());
+	for (auto& sp : m_subplots) {
+		npoints = std::max(npoints, sp->handleNewData(frame,
+					clicked.testBit(sp->index()), &spikes));
+		activity.append(sp->activity());
+	}
+	if (npoints > 0)
+		emit plotsReady(m_index, npoints, frame.received());
+	if (!spikes.isEmpty())
+		emit spikesDetected(spikes);
+	if (!activity.isEmpty())
+		emit activityMeasured(activity);
+	emit frameHandled(m_index);
+}
+
+void SubplotWorker::requestDelete()
+{
+	for (auto& sp : m_subplots)
+		sp->requestDelete();
+	m_subplots.clear();
+	deleteLater();
+}
+
+}; // end subplotworker namespace
+}; // end meaview namespace
+
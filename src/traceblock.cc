@@ -0,0 +1,120 @@
+/*! \file traceblock.cc
+ *
+ * Implementation of the TraceData and BlockSlot classes.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "traceblock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace meaview {
+namespace traceblock {
+
+bool TraceData::hasSummary() const
+{
+	return (!samples.isEmpty() && (envelope.summary.count == samples.size()));
+}
+
+channelstats::SummaryStats TraceData::stats() const
+{
+	if (hasSummary())
+		return channelstats::SummaryStats::fromSummary(envelope.summary);
+
+	/* Data not built by a Subplot, e.g., copied into an inspector. */
+	samplekernels::Summary summary;
+	int length = 0;
+	auto segment = samples.firstSegment(length);
+	samplekernels::summarize(segment, length, &summary);
+	segment = samples.secondSegment(length);
+	samplekernels::summarize(segment, length, &summary);
+	return channelstats::SummaryStats::fromSummary(summary);
+}
+
+double TraceData::mean() const
+{
+	return gain * stats().mean();
+}
+
+QCPRange TraceData::keyRange(bool& foundRange,
+		QCPAbstractPlottable::SignDomain inSignDomain) const
+{
+	/* Keys are sample indices, and so are never negative. If there are
+	 * no samples, the keys are those spanned by the envelope.
+	 */
+	double lower = 0, upper = samples.size() - 1;
+	if (samples.isEmpty() && (envelope.size > 0)) {
+		lower = envelope.offset;
+		upper = envelope.key(envelope.size - 1);
+	}
+	if (inSignDomain == QCPAbstractPlottable::sdPositive)
+		lower = std::max(lower, 1.0);
+	if ((inSignDomain == QCPAbstractPlottable::sdNegative) || (upper < lower)) {
+		foundRange = false;
+		return QCPRange();
+	}
+	foundRange = true;
+	return QCPRange(lower, upper);
+}
+
+QCPRange TraceData::valueRange(bool& foundRange,
+		QCPAbstractPlottable::SignDomain inSignDomain) const
+{
+	auto lower = std::numeric_limits<double>::max();
+	auto upper = std::numeric_limits<double>::lowest();
+	foundRange = false;
+	auto include = [&](double value) -> void {
+		if ((inSignDomain == QCPAbstractPlottable::sdNegative && value >= 0) ||
+				(inSignDomain == QCPAbstractPlottable::sdPositive && value <= 0))
+			return;
+		lower = std::min(lower, value);
+		upper = std::max(upper, value);
+		foundRange = true;
+	};
+
+	/* The statistics of the samples contain their extrema, as does the
+	 * envelope, if either is available.
+	 */
+	if (hasSummary() && (inSignDomain == QCPAbstractPlottable::sdBoth)) {
+		auto s = stats();
+		include(gain * s.min());
+		include(gain * s.max());
+	} else if ((envelope.columns() > 0) && (envelope.size == envelope.columns())) {
+		for (auto i = 0; i < envelope.size; i++) {
+			include(gain * envelope.min.at(i));
+			include(gain * envelope.max.at(i));
+		}
+	} else {
+		for (auto i = 0; i < samples.size(); i++)
+			include(gain * samples.at(i));
+	}
+	return foundRange ? QCPRange(lower, upper) : QCPRange();
+}
+
+void BlockSlot::publish(const std::shared_ptr<TraceBlock>& block)
+{
+	/* If the GUI thread takes the previous block between the load and
+	 * the store, the merged region is merely larger than needed. Only
+	 * this thread stores non-null blocks, so none can be missed.
+	 */
+	auto pending = std::atomic_load(&m_block);
+	if (pending) {
+		if (pending->dirtyRect.isNull() || block->dirtyRect.isNull())
+			block->dirtyRect = QRect();
+		else
+			block->dirtyRect |= pending->dirtyRect;
+	}
+	std::atomic_store(&m_block, std::shared_ptr<const TraceBlock>(block));
+}
+
+std::shared_ptr<const TraceBlock> BlockSlot::take()
+{
+	return std::atomic_exchange(&m_block, std::shared_ptr<const TraceBlock>());
+}
+
+}; // end traceblock namespace
+}; // end meaview namespace
+
@@ -0,0 +1,310 @@
+/*! \file tracegraph.cc
+ *
+ * Implementation of the TraceGraph class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "tracegraph.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <QPainter>
+
+namespace meaview {
+namespace tracegraph {
+
+TraceGraph::TraceGraph(QCPAxis* keyAxis, QCPAxis* valueAxis)
+	: QCPAbstractPlottable(keyAxis, valueAxis),
+	m_data(std::make_shared<traceblock::TraceData>())
+{
+	setPen(QPen(Qt::blue, 0));
+	setBrush(Qt::NoBrush);
+	setSelectable(false);
+}
+
+TraceGraph::~TraceGraph()
+{
+}
+
+void TraceGraph::setTraceData(std::shared_ptr<const traceblock::TraceData> data)
+{
+	if (data)
+		m_data = std::move(data);
+	else
+		m_data = std::make_shared<traceblock::TraceData>();
+}
+
+void TraceGraph::setData(const samplebuffer::SampleBuffer& data, double gain)
+{
+	auto copy = std::make_shared<traceblock::TraceData>();
+	copy->samples = data;
+	copy->gain = gain;
+	m_data = copy;
+}
+
+void TraceGraph::clearData()
+{
+	m_data = std::make_shared<traceblock::TraceData>();
+	m_tile = QImage();
+}
+
+double TraceGraph::selectTest(const QPointF& /* pos */, bool /* onlySelectable */,
+		QVariant* /* details */) const
+{
+	return -1;
+}
+
+void TraceGraph::draw(QCPPainter* painter)
+{
+	if (!mKeyAxis || !mValueAxis)
+		return;
+
+	/* Draw the pre-rendered tile, if any, stretching it to cover the axis rect. */
+	if (!m_tile.isNull()) {
+		painter->drawImage(mKeyAxis.data()->axisRect()->rect(), m_tile);
+		return;
+	}
+
+	if (m_data->isEmpty())
+		return;
+	if (mKeyAxis.data()->range().size() <= 0)
+		return;
+
+	QVector<QPointF> points;
+	getPoints(*m_data, plotPixelMap(), &points);
+	if (points.size() < 2)
+		return;
+
+	applyDefaultAntialiasingHint(painter);
+	painter->setPen(mainPen());
+	painter->setBrush(Qt::NoBrush);
+	painter->drawPolyline(points.constData(), points.size());
+}
+
+void TraceGraph::renderTile(const traceblock::TraceData& data, QImage* tile,
+		const QSize& size, const QCPRange& keyRange, const QCPRange& valueRange,
+		const QPen& pen, bool antialiased)
+{
+	if (tile->size() != size)
+		*tile = QImage(size, QImage::Format_ARGB32_Premultiplied);
+	tile->fill(Qt::transparent);
+	if ((size.isEmpty()) || (keyRange.size() <= 0) || (valueRange.size() <= 0) ||
+			data.isEmpty())
+		return;
+
+	/* Map the key range onto the width of the tile, and the value
+	 * range onto its height, with values increasing upwards.
+	 */
+	PixelMap map;
+	map.keyRange = keyRange;
+	map.keyScale = (size.width() - 1) / keyRange.size();
+	map.keyOffset = -keyRange.lower * map.keyScale;
+	map.valueScale = -(size.height() - 1) / valueRange.size();
+	map.valueOffset = -valueRange.upper * map.valueScale;
+
+	QVector<QPointF> points;
+	getPoints(data, map, &points);
+	if (points.size() < 2)
+		return;
+
+	QPainter painter(tile);
+	painter.setRenderHint(QPainter::Antialiasing, antialiased);
+	painter.setPen(pen);
+	painter.setBrush(Qt::NoBrush);
+	painter.drawPolyline(points.constData(), points.size());
+}
+
+QRect TraceGraph::sweepTile(QImage* tile, const samplebuffer::SampleBuffer& sweep,
+		int begin, int end, int blockSize, const QCPRange& valueRange,
+		double gain, const QPen& pen, bool antialiased, int cursorWidth)
+{
+	end = std::min(end, sweep.size());
+	if (tile->isNull() || (begin >= end) || (blockSize < 2) || (valueRange.size() <= 0))
+		return QRect();
+
+	/* Find the columns spanned by the new samples, and the first sample 
+	 * in the leftmost of these, which may have been drawn before.
+	 */
+	auto width = tile->width(), height = tile->height();
+	auto keyScale = static_cast<double>(width - 1) / (blockSize - 1);
+	auto first = static_cast<int>(std::floor(begin * keyScale));
+	auto last = static_cast<int>(std::floor((end - 1) * keyScale));
+	auto sample = qBound(0, static_cast<int>(std::ceil(first / keyScale)), begin);
+	auto dirty = QRect(first, 0, last - first + 1 + cursorWidth, height) & tile->rect();
+
+	/* Reduce the samples within each column to their min/max. */
+	auto valueScale = -(height - 1) / valueRange.size();
+	auto valueOffset = -valueRange.upper * valueScale;
+	QVector<QPointF> points;
+	points.reserve(2 * (last - first + 1) + 1);
+
+	/* Join the line to the last sample of the previous column, which is
+	 * not cleared, so there is no break where a chunk starts a column.
+	 */
+	if (sample > 0) {
+		points.append(QPointF(std::floor((sample - 1) * keyScale),
+				valueOffset + valueScale * gain * sweep.at(sample - 1)));
+	}
+	auto column = static_cast<int>(std::floor(sample * keyScale));
+	auto lo = sweep.at(sample), hi = lo;
+	for (auto i = sample; i <= end; i++) {
+		auto x = (i < end) ? static_cast<int>(std::floor(i * keyScale)) : -1;
+		if (x != column) {
+			points.append(QPointF(column, valueOffset + valueScale * gain * lo));
+			points.append(QPointF(column, valueOffset + valueScale * gain * hi));
+			if (i == end)
+				break;
+			column = x;
+			lo = hi = sweep.at(i);
+		} else {
+			lo = std::min(lo, sweep.at(i));
+			hi = std::max(hi, sweep.at(i));
+		}
+	}
+
+	/* Clear the new columns and the cursor, and draw over them. */
+	QPainter painter(tile);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+	painter.fillRect(dirty, Qt::transparent);
+	painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+	painter.setRenderHint(QPainter::Antialiasing, antialiased);
+	painter.setPen(pen);
+	painter.setBrush(Qt::NoBrush);
+	painter.drawPolyline(points.constData(), points.size());
+	return dirty;
+}
+
+TraceGraph::PixelMap TraceGraph::plotPixelMap() const
+{
+	/* Both axes are linear, so the map is determined by the pixel
+	 * positions of the coordinates 0 and 1.
+	 */
+	auto keyAxis = mKeyAxis.data();
+	auto valueAxis = mValueAxis.data();
+	PixelMap map;
+	map.keyRange = keyAxis->range();
+	map.keyOffset = keyAxis->coordToPixel(0);
+	map.keyScale = keyAxis->coordToPixel(1) - map.keyOffset;
+	map.valueOffset = valueAxis->coordToPixel(0);
+	map.valueScale = valueAxis->coordToPixel(1) - map.valueOffset;
+	return map;
+}
+
+void TraceGraph::getPoints(const traceblock::TraceData& data, const PixelMap& map,
+		QVector<QPointF>* points)
+{
+	if (useEnvelope(data, map.keyRange))
+		getEnvelopePoints(data, map, points);
+	else
+		getLinePoints(data, map, points);
+}
+
+bool TraceGraph::useEnvelope(const traceblock::TraceData& data, const QCPRange& range)
+{
+	const auto& envelope = data.envelope;
+	if ((envelope.columns() == 0) || (envelope.size == 0))
+		return false;
+
+	/* Without samples, as for a channel's history, the envelope is all there
+	 * is. Its columns are aligned to the bins it was built from rather than
+	 * to the range, so it is drawn clipped to the range.
+	 */
+	if (data.samples.isEmpty())
+		return true;
+	if (envelope.size < envelope.columns())
+		return false;
+	return ((range.lower <= envelope.offset) && 
+			(range.upper >= (envelope.offset + envelope.blockSize - 1)));
+}
+
+void TraceGraph::getEnvelopePoints(const traceblock::TraceData& data,
+		const PixelMap& map, QVector<QPointF>* points)
+{
+	/* Only compute points for the columns inside the visible key range,
+	 * along with one on either side, so the line runs off the edges.
+	 */
+	const auto& envelope = data.envelope;
+	const auto& range = map.keyRange;
+	auto columnsPerSample = static_cast<double>(envelope.columns()) /
+			std::max(envelope.blockSize, 1);
+	auto first = static_cast<int>(std::floor((range.lower - envelope.offset) *
+			columnsPerSample)) - 1;
+	auto last = static_cast<int>(std::floor((range.upper - envelope.offset) *
+			columnsPerSample)) + 2;
+	first = qBound(0, first, envelope.size);
+	last = qBound(first, last, envelope.size);
+
+	/* Draw a vertical line spanning each column, connected to its neighbors. */
+	points->reserve(2 * (last - first));
+	for (auto i = first; i < last; i++) {
+		auto key = envelope.key(i);
+		points->append(map(key, data.gain * envelope.min.at(i)));
+		points->append(map(key, data.gain * envelope.max.at(i)));
+	}
+}
+
+void TraceGraph::getLinePoints(const traceblock::TraceData& data,
+		const PixelMap& map, QVector<QPointF>* points)
+{
+	const auto& samples = data.samples;
+	auto n = samples.size();
+
+	/* Only compute points for samples inside the visible key range. */
+	const auto& range = map.keyRange;
+	auto begin = qBound(0, static_cast<int>(std::floor(range.lower)), n);
+	auto end = qBound(begin, static_cast<int>(std::ceil(range.upper)) + 1, n);
+	if (end <= begin)
+		return;
+
+	auto pixelsPerSample = std::abs(map.keyScale);
+	if (pixelsPerSample >= 0.5) {
+
+		/* Fewer samples than pixels, draw every sample. */
+		points->reserve(end - begin);
+		for (auto i = begin; i < end; i++)
+			points->append(map(i, data.gain * samples.at(i)));
+
+	} else {
+
+		/* More samples than pixels. Reduce the samples within each pixel
+		 * column to their minimum and maximum, and draw a line through these.
+		 */
+		auto samplesPerColumn = static_cast<int>(std::ceil(1.0 / pixelsPerSample));
+		points->reserve(2 * ((end - begin) / samplesPerColumn + 1));
+		for (auto i = begin; i < end; i += samplesPerColumn) {
+			auto stop = std::min(i + samplesPerColumn, end);
+			auto min = samples.at(i), max = samples.at(i);
+			for (auto j = i + 1; j < stop; j++) {
+				auto sample = samples.at(j);
+				min = std::min(min, sample);
+				max = std::max(max, sample);
+			}
+			points->append(map(i, data.gain * min));
+			points->append(map(i, data.gain * max));
+		}
+	}
+}
+
+void TraceGraph::drawLegendIcon(QCPPainter* painter, const QRectF& rect) const
+{
+	applyDefaultAntialiasingHint(painter);
+	painter->setPen(mPen);
+	painter->drawLine(QLineF(rect.left(), rect.top() + rect.height() / 2.0,
+			rect.right() + 5, rect.top() + rect.height() / 2.0));
+}
+
+QCPRange TraceGraph::getKeyRange(bool& foundRange, SignDomain inSignDomain) const
+{
+	return m_data->keyRange(foundRange, inSignDomain);
+}
+
+QCPRange TraceGraph::getValueRange(bool& foundRange, SignDomain inSignDomain) const
+{
+	return m_data->valueRange(foundRange, inSignDomain);
+}
+
+}; // end tracegraph namespace
+}; // end meaview namespace
+
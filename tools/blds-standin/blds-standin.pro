@@ -0,0 +1,22 @@
+######################################################################
+# Local stand-in for the BLDS, serving synthesized data to meaview.
+######################################################################
+
+TEMPLATE = app
+TARGET = blds-standin
+OBJECTS_DIR = build
+MOC_DIR = build
+
+QT += network
+QT -= gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += .
+
+# Input
+HEADERS += standinserver.h \
+           synthesizer.h
+SOURCES += main.cc \
+           standinserver.cc \
+           synthesizer.cc
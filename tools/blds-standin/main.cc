@@ -0,0 +1,100 @@
+/*! \file main.cc
+ *
+ * Main entry point for the BLDS stand-in server, which serves synthesized
+ * data to meaview for testing without any hardware.
+ *
+ * See the README.md in this directory for details.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "standinserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+/*! \function main
+ * The main entry point for the `blds-standin` application.
+ */
+int main(int argc, char *argv[])
+{
+	using namespace bldsstandin::standinserver;
+
+	QCoreApplication app(argc, argv);
+	app.setApplicationName("blds-standin");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Local stand-in for the BLDS, serving "
+			"synthesized array data to meaview.");
+	parser.addHelpOption();
+	parser.addOptions({
+			{ "array", "Type of array, \"mcs\" or \"hidens\".", "array", "mcs" },
+			{ "nchannels", "Number of channels (default: 64 for MCS, 1028 for HiDens).",
+				"n" },
+			{ "sample-rate", "Sample rate in Hz (default: 10000 for MCS, 20000 for HiDens).",
+				"rate" },
+			{ "speed", "Rate at which the recording advances, relative to real time.",
+				"factor", "1" },
+			{ "length", "Length of the recording in seconds, or 0 for no end.",
+				"seconds", "0" },
+			{ "latency", "Delay added to each reply to a request for data.", "ms", "0" },
+			{ "jitter", "Maximum random deviation from the delay.", "ms", "0" },
+			{ "seed", "Seed for the synthesized data and jitter.", "seed", "0" },
+			{ "http-port", "Port for the HTTP interface.", "port",
+				QString::number(DefaultHttpPort) },
+			{ "data-port", "Port for the data interface.", "port",
+				QString::number(DefaultDataPort) },
+			{ "unverified-protocol", "Serve data although the data protocol has "
+				"not been checked against libblds-client (see README.md)." },
+		});
+	parser.process(app);
+
+	Options options;
+	options.array = parser.value("array");
+	auto isHidens = options.array.startsWith("hidens");
+	options.nchannels = parser.isSet("nchannels") ? parser.value("nchannels").toInt() :
+		(isHidens ? HiDensChannels : McsChannels);
+	options.sampleRate = parser.isSet("sample-rate") ?
+		parser.value("sample-rate").toDouble() :
+		(isHidens ? HiDensSampleRate : McsSampleRate);
+	options.speed = parser.value("speed").toDouble();
+	options.length = parser.value("length").toDouble();
+	options.latency = parser.value("latency").toDouble();
+	options.jitter = parser.value("jitter").toDouble();
+	options.seed = parser.value("seed").toULongLong();
+	options.httpPort = parser.value("http-port").toUShort();
+	options.dataPort = parser.value("data-port").toUShort();
+
+	QTextStream err(stderr);
+	if (((options.array != "mcs") && !isHidens) || (options.nchannels <= 0) ||
+			(options.sampleRate <= 0) || (options.speed <= 0)) {
+		err << "Invalid options, see --help.\n";
+		return 1;
+	}
+
+	/* The framing and layout of the data messages are reconstructed from
+	 * meaview's use of BldsClient, so nothing is served until the user
+	 * acknowledges that they may not match the real BLDS.
+	 */
+	if (!parser.isSet("unverified-protocol")) {
+		err << "The data protocol of the stand-in has not been checked against "
+			"libblds-client,\nso meaview may fail to read its frames. See the "
+			"\"Protocol\" section of README.md,\nand pass --unverified-protocol "
+			"to run it anyway.\n";
+		return 1;
+	}
+
+	StandinServer server(options);
+	if (!server.listen()) {
+		err << QString("Could not listen on ports %1 and %2.\n").arg(
+				options.httpPort).arg(options.dataPort);
+		return 1;
+	}
+	err << QString("Serving %1 channels of %2 data at %3 Hz on ports %4 (HTTP) "
+			"and %5 (data).\n").arg(options.nchannels).arg(options.array).arg(
+			options.sampleRate).arg(options.httpPort).arg(options.dataPort);
+	err.flush();
+	return app.exec();
+}
+
@@ -0,0 +1,313 @@
+/*! \file standinserver.cc
+ *
+ * Implementation of the StandinServer class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "standinserver.h"
+
+#include <QDataStream>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QtEndian>
+
+#include <cmath>
+#include <algorithm>
+
+namespace bldsstandin {
+namespace standinserver {
+
+StandinServer::StandinServer(const Options& options, QObject* parent)
+	: QObject(parent),
+	m_options(options),
+	m_synthesizer(options.nchannels, options.sampleRate, options.seed),
+	m_random(options.seed)
+{
+	if (m_options.array.startsWith("hidens"))
+		m_synthesizer.setAmplitude(standinserver::HiDensAmplitude,
+				standinserver::HiDensNoise);
+	QObject::connect(&m_httpServer, &QTcpServer::newConnection,
+			this, &StandinServer::acceptHttpConnection);
+	QObject::connect(&m_dataServer, &QTcpServer::newConnection,
+			this, &StandinServer::acceptDataConnection);
+	QObject::connect(&m_reportTimer, &QTimer::timeout,
+			this, &StandinServer::reportThroughput);
+}
+
+StandinServer::~StandinServer()
+{
+}
+
+bool StandinServer::listen()
+{
+	if (!m_httpServer.listen(QHostAddress::Any, m_options.httpPort) ||
+			!m_dataServer.listen(QHostAddress::Any, m_options.dataPort))
+		return false;
+	m_clock.start();
+	m_reportTimer.start(standinserver::ReportInterval);
+	return true;
+}
+
+double StandinServer::recordingPosition() const
+{
+	auto position = m_options.speed * m_clock.elapsed() / 1000.;
+	if (m_options.length > 0)
+		position = std::min(position, m_options.length);
+	return position;
+}
+
+void StandinServer::acceptHttpConnection()
+{
+	while (auto socket = m_httpServer.nextPendingConnection()) {
+		QObject::connect(socket, &QTcpSocket::readyRead,
+				this, &StandinServer::readHttpSocket);
+		QObject::connect(socket, &QTcpSocket::disconnected, [this, socket]() -> void {
+					m_buffers.remove(socket);
+					socket->deleteLater();
+				});
+	}
+}
+
+void StandinServer::acceptDataConnection()
+{
+	while (auto socket = m_dataServer.nextPendingConnection()) {
+		QObject::connect(socket, &QTcpSocket::readyRead,
+				this, &StandinServer::readDataSocket);
+		QObject::connect(socket, &QTcpSocket::disconnected, [this, socket]() -> void {
+					m_buffers.remove(socket);
+					socket->deleteLater();
+				});
+	}
+}
+
+void StandinServer::readHttpSocket()
+{
+	auto socket = qobject_cast<QTcpSocket*>(sender());
+	auto& buffer = m_buffers[socket];
+	buffer.append(socket->readAll());
+
+	/* Requests carry no bodies that matter, so each ends at a blank line. */
+	int end;
+	while ((end = buffer.indexOf("\r\n\r\n")) >= 0) {
+		auto request = buffer.left(end);
+		buffer.remove(0, end + 4);
+		auto line = request.left(request.indexOf("\r\n")).split(' ');
+		if (line.size() < 2) {
+			sendHttpResponse(socket, 400, "Bad Request", "Malformed request line");
+			continue;
+		}
+
+		/* Skip any body. */
+		for (auto& header : request.split('\n')) {
+			if (header.toLower().startsWith("content-length:")) {
+				auto length = header.mid(header.indexOf(':') + 1).trimmed().toInt();
+				buffer.remove(0, std::min(length, buffer.size()));
+			}
+		}
+		handleHttpRequest(socket, line.at(0), line.at(1));
+	}
+}
+
+void StandinServer::handleHttpRequest(QTcpSocket* socket, const QByteArray& method,
+		const QByteArray& path)
+{
+	if (method != "GET") {
+		sendHttpResponse(socket, 405, "Method Not Allowed",
+				"The stand-in server cannot control the source or recording.");
+		return;
+	}
+
+	auto parts = QString::fromUtf8(path).split('/', QString::SkipEmptyParts);
+	QJsonValue body;
+	if (parts == QStringList{ "status" }) {
+		body = serverStatus();
+	} else if (parts == QStringList{ "source" }) {
+		body = sourceStatus();
+	} else if ((parts.size() == 2) && (parts.at(0) == "source")) {
+		body = parameter(parts.at(1), true);
+	} else if (parts.size() == 1) {
+		body = parameter(parts.at(0), false);
+	}
+	if (body.isUndefined()) {
+		sendHttpResponse(socket, 404, "Not Found",
+				QString("Unknown parameter or endpoint: %1").arg(
+					QString::fromUtf8(path)).toUtf8());
+		return;
+	}
+	auto doc = body.isObject() ? QJsonDocument(body.toObject()) :
+		QJsonDocument(QJsonObject{ { parts.last(), body } });
+	sendHttpResponse(socket, 200, "OK", doc.toJson(QJsonDocument::Compact));
+}
+
+void StandinServer::sendHttpResponse(QTcpSocket* socket, int code,
+		const QByteArray& reason, const QByteArray& body)
+{
+	QByteArray response;
+	QTextStream stream(&response);
+	stream << "HTTP/1.1 " << code << " " << reason << "\r\n"
+		<< "Content-Type: " << ((code == 200) ? "application/json" : "text/plain") << "\r\n"
+		<< "Content-Length: " << body.size() << "\r\n"
+		<< "Connection: keep-alive\r\n\r\n";
+	stream.flush();
+	response.append(body);
+	socket->write(response);
+}
+
+QJsonObject StandinServer::serverStatus() const
+{
+	return QJsonObject{
+		{ "source-exists", true },
+		{ "source-type", "standin" },
+		{ "device-type", m_options.array },
+		{ "recording-exists", true },
+		{ "recording-length", m_options.length },
+		{ "recording-position", recordingPosition() },
+	};
+}
+
+QJsonObject StandinServer::sourceStatus() const
+{
+	auto isHidens = m_options.array.startsWith("hidens");
+	return QJsonObject{
+		{ "source-type", "standin" },
+		{ "device-type", m_options.array },
+		{ "nchannels", m_options.nchannels },
+		{ "sample-rate", m_options.sampleRate },
+		{ "gain", isHidens ? standinserver::HiDensGain : standinserver::McsGain },
+		{ "state", "streaming" },
+	};
+}
+
+QJsonValue StandinServer::parameter(const QString& name, bool source) const
+{
+	if (source && (name == "configuration")) {
+
+		/* A HiDens configuration, with electrodes on a square grid. */
+		QJsonArray config;
+		auto side = static_cast<int>(std::ceil(std::sqrt(m_options.nchannels)));
+		for (auto i = 0; i < m_options.nchannels; i++) {
+			config.append(QJsonObject{
+					{ "index", i },
+					{ "xpos", (i % side) * 18 },
+					{ "x", i % side },
+					{ "ypos", (i / side) * 18 },
+					{ "y", i / side },
+				});
+		}
+		return config;
+	}
+	auto status = source ? sourceStatus() : serverStatus();
+	return status.contains(name) ? status.value(name) : QJsonValue(QJsonValue::Undefined);
+}
+
+void StandinServer::readDataSocket()
+{
+	auto socket = qobject_cast<QTcpSocket*>(sender());
+	auto& buffer = m_buffers[socket];
+	buffer.append(socket->readAll());
+
+	/* Messages are prefixed with their length, as a 32-bit big-endian integer. */
+	while (buffer.size() >= static_cast<int>(sizeof(quint32))) {
+		QDataStream stream(buffer);
+		quint32 size;
+		stream >> size;
+		if (buffer.size() < static_cast<int>(sizeof(quint32) + size))
+			break;
+		auto message = buffer.mid(sizeof(quint32), size);
+		buffer.remove(0, sizeof(quint32) + size);
+		handleDataMessage(socket, message);
+	}
+}
+
+void StandinServer::handleDataMessage(QTcpSocket* socket, const QByteArray& message)
+{
+	auto newline = message.indexOf('\n');
+	auto type = message.left(newline);
+	if ((newline < 0) || (type != "get-data")) {
+		sendDataMessage(socket, "error", "Unknown message type: " + type);
+		return;
+	}
+	QDataStream stream(message.mid(newline + 1));
+	double start, stop;
+	stream >> start >> stop;
+	if ((stream.status() != QDataStream::Ok) || (start < 0) || (stop <= start)) {
+		sendDataMessage(socket, "error", "Invalid request for data");
+		return;
+	}
+	if ((m_options.length > 0) && (stop > m_options.length)) {
+		sendDataMessage(socket, "error", "Requested data is past the end of the recording");
+		return;
+	}
+	scheduleData(socket, start, stop);
+}
+
+void StandinServer::scheduleData(QTcpSocket* socket, double start, double stop)
+{
+	/* Wait until the data has been "recorded", then for the latency. */
+	auto wait = std::max(0., (stop - recordingPosition()) / m_options.speed) * 1000.;
+	auto delay = m_options.latency;
+	if (m_options.jitter > 0) {
+		std::uniform_real_distribution<double> jitter(-m_options.jitter, m_options.jitter);
+		delay += jitter(m_random);
+	}
+	auto ms = static_cast<int>(std::ceil(wait + std::max(0., delay)));
+	QPointer<QTcpSocket> target(socket);
+	QTimer::singleShot(ms, this, [this, target, start, stop]() -> void {
+				sendData(target, start, stop);
+			});
+}
+
+void StandinServer::sendData(QPointer<QTcpSocket> socket, double start, double stop)
+{
+	if (!socket || (socket->state() != QAbstractSocket::ConnectedState))
+		return;
+
+	/* Frames are sent as their start and stop times, the number of
+	 * samples and channels, and the raw samples with each channel
+	 * contiguous, in little-endian byte order.
+	 */
+	auto first = static_cast<qint64>(std::round(start * m_options.sampleRate));
+	auto nsamples = static_cast<int>(std::round(stop * m_options.sampleRate) - first);
+	QByteArray payload;
+	QDataStream stream(&payload, QIODevice::WriteOnly);
+	stream << start << stop << static_cast<quint32>(nsamples)
+		<< static_cast<quint32>(m_options.nchannels);
+	auto header = payload.size();
+	payload.resize(header + nsamples * m_options.nchannels * sizeof(qint16));
+	auto samples = reinterpret_cast<qint16*>(payload.data() + header);
+	m_synthesizer.generate(first, nsamples, samples);
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+	for (auto i = 0; i < nsamples * m_options.nchannels; i++)
+		samples[i] = qToLittleEndian(samples[i]);
+#endif
+	sendDataMessage(socket, "data", payload);
+	m_framesSent += 1;
+}
+
+void StandinServer::sendDataMessage(QTcpSocket* socket, const QByteArray& type,
+		const QByteArray& payload)
+{
+	QByteArray message;
+	QDataStream stream(&message, QIODevice::WriteOnly);
+	stream << static_cast<quint32>(type.size() + 1 + payload.size());
+	message.append(type).append('\n').append(payload);
+	m_bytesSent += message.size();
+	socket->write(message);
+}
+
+void StandinServer::reportThroughput()
+{
+	auto seconds = standinserver::ReportInterval / 1000.;
+	QTextStream(stderr) << QString("t = %1 s: %2 frames/s, %3 MB/s\n").arg(
+			recordingPosition(), 0, 'f', 1).arg(
+			m_framesSent / seconds, 0, 'f', 1).arg(
+			m_bytesSent / seconds / (1 << 20), 0, 'f', 2);
+	m_framesSent = 0;
+	m_bytesSent = 0;
+}
+
+}; // end standinserver namespace
+}; // end bldsstandin namespace
+
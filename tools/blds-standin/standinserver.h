@@ -0,0 +1,200 @@
+/*! \file standinserver.h
+ *
+ * Class implementing a local stand-in for the BLDS.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _BLDS_STANDIN_SERVER_H_
+#define _BLDS_STANDIN_SERVER_H_
+
+#include "synthesizer.h"
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QHash>
+#include <QTimer>
+
+#include <random>
+
+namespace bldsstandin {
+
+/*! \namespace standinserver
+ *
+ * The standinserver namespace contains the StandinServer class, which
+ * serves synthesized data to meaview as if it were the BLDS.
+ */
+namespace standinserver {
+
+	/*! Default port for the HTTP interface to the server. */
+	const quint16 DefaultHttpPort = 8000;
+
+	/*! Default port for the binary data interface. */
+	const quint16 DefaultDataPort = 12345;
+
+	/*! Default number of channels of MCS and HiDens arrays. */
+	const int McsChannels = 64;
+	const int HiDensChannels = 1028;
+
+	/*! Default sample rates of MCS and HiDens arrays. */
+	const double McsSampleRate = 10000.;
+	const double HiDensSampleRate = 20000.;
+
+	/*! Gains converting ADC counts to volts. */
+	const double McsGain = 1e-4;
+	const double HiDensGain = 5. / 256. / 900.;
+
+	/*! Default oscillation and noise amplitudes of HiDens data, in ADC counts. */
+	const double HiDensAmplitude = 5.;
+	const double HiDensNoise = 1.5;
+
+	/*! Interval between reports of throughput, in milliseconds. */
+	const int ReportInterval = 5000;
+
+/*! Options controlling the stand-in server. */
+struct Options {
+
+	/*! Type of array, either "mcs" or "hidens". */
+	QString array = "mcs";
+
+	/*! Number of channels. */
+	int nchannels = standinserver::McsChannels;
+
+	/*! Sample rate, in Hz. */
+	double sampleRate = standinserver::McsSampleRate;
+
+	/*! Rate at which the recording advances, relative to real time. */
+	double speed = 1.;
+
+	/*! Length of the recording, in seconds. If zero, it never ends. */
+	double length = 0.;
+
+	/*! Fixed delay added to every reply to a request for data, in ms. */
+	double latency = 0.;
+
+	/*! Maximum random deviation of each reply from the fixed delay, in ms. */
+	double jitter = 0.;
+
+	/*! Seed for the synthesized data and the jitter. */
+	quint64 seed = 0;
+
+	/*! Ports for the HTTP and data interfaces. */
+	quint16 httpPort = standinserver::DefaultHttpPort;
+	quint16 dataPort = standinserver::DefaultDataPort;
+};
+
+/*! \class StandinServer
+ *
+ * The StandinServer class mimics the BLDS closely enough for meaview to
+ * connect to it, so that meaview can be tested and load-tested without
+ * any hardware.
+ *
+ * The server pretends that a source exists and has been recording since
+ * the server started, with data synthesized by a Synthesizer. Status and
+ * parameters are served as JSON over HTTP, and data over a separate TCP
+ * socket. Requests for data which has not yet been "recorded" are held
+ * until it has, as the BLDS does. Each reply may be further delayed by a
+ * fixed latency and a random jitter, which may reorder replies.
+ *
+ * NOTE: The protocol is reconstructed from how meaview uses BldsClient,
+ * not from the BLDS sources, and must be checked against libblds-client
+ * before measurements are trusted. See the README in this directory.
+ */
+class StandinServer : public QObject {
+	Q_OBJECT
+
+	public:
+		/*! Construct a StandinServer with the given options. */
+		StandinServer(const Options& options, QObject* parent = nullptr);
+
+		/*! Destroy a StandinServer. */
+		~StandinServer();
+
+		/*! Start listening on both ports, returning false on failure. */
+		bool listen();
+
+		/*! Return the time up to which data is available, in seconds. */
+		double recordingPosition() const;
+
+	private slots:
+
+		/* Accept connections to the HTTP and data interfaces. */
+		void acceptHttpConnection();
+		void acceptDataConnection();
+
+		/* Read from sockets connected to either interface. */
+		void readHttpSocket();
+		void readDataSocket();
+
+		/* Report the throughput since the last report. */
+		void reportThroughput();
+
+	private:
+
+		/* Respond to a single HTTP request. */
+		void handleHttpRequest(QTcpSocket* socket, const QByteArray& method,
+				const QByteArray& path);
+
+		/* Write an HTTP response to a socket. */
+		void sendHttpResponse(QTcpSocket* socket, int code, const QByteArray& reason,
+				const QByteArray& body);
+
+		/* Return the status of the server and the source. */
+		QJsonObject serverStatus() const;
+		QJsonObject sourceStatus() const;
+
+		/* Return the value of a single parameter of the server or source. */
+		QJsonValue parameter(const QString& name, bool source) const;
+
+		/* Handle a single message received on a data socket. */
+		void handleDataMessage(QTcpSocket* socket, const QByteArray& message);
+
+		/* Schedule the reply to a request for data, once it is available
+		 * and after any injected latency.
+		 */
+		void scheduleData(QTcpSocket* socket, double start, double stop);
+
+		/* Synthesize and send the data between two times. */
+		void sendData(QPointer<QTcpSocket> socket, double start, double stop);
+
+		/* Send a length-prefixed message on a data socket. */
+		void sendDataMessage(QTcpSocket* socket, const QByteArray& type,
+				const QByteArray& payload);
+
+		/* Options for the server. */
+		Options m_options;
+
+		/* Source of the data. */
+		synthesizer::Synthesizer m_synthesizer;
+
+		/* Servers for the HTTP and data interfaces. */
+		QTcpServer m_httpServer;
+		QTcpServer m_dataServer;
+
+		/* Partial requests received on each socket. */
+		QHash<QTcpSocket*, QByteArray> m_buffers;
+
+		/* Time since the recording started. */
+		QElapsedTimer m_clock;
+
+		/* Random number generator for the jitter. */
+		std::mt19937_64 m_random;
+
+		/* Timer for reporting throughput. */
+		QTimer m_reportTimer;
+
+		/* Frames and bytes sent since the last report. */
+		int m_framesSent = 0;
+		qint64 m_bytesSent = 0;
+
+}; // end StandinServer class
+
+}; // end standinserver namespace
+}; // end bldsstandin namespace
+
+#endif
+
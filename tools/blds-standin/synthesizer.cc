@@ -0,0 +1,119 @@
+/*! \file synthesizer.cc
+ *
+ * Implementation of the Synthesizer class.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "synthesizer.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace bldsstandin {
+namespace synthesizer {
+
+/* The splitmix64 finalizer, used as a cheap hash of (seed, channel, sample). */
+static inline quint64 mix(quint64 x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+Synthesizer::Synthesizer(int nchannels, double sampleRate, quint64 seed)
+	: m_nchannels(nchannels),
+	m_sampleRate(sampleRate),
+	m_seed(seed),
+	m_frequencies(nchannels)
+{
+	/* Oscillations between 1 and 20 Hz, fixed by the seed. */
+	for (auto c = 0; c < m_nchannels; c++) {
+		auto hz = 1. + 19. * uniform(c, -1, 0);
+		m_frequencies[c] = 2 * M_PI * hz / m_sampleRate;
+	}
+}
+
+void Synthesizer::setAmplitude(double amplitude, double noise)
+{
+	m_amplitude = amplitude;
+	m_noise = noise;
+}
+
+void Synthesizer::setSpikeRate(double rate)
+{
+	m_spikeRate = rate;
+}
+
+quint64 Synthesizer::hash(int channel, qint64 index, int stream) const
+{
+	return mix(m_seed ^ mix((static_cast<quint64>(stream) << 58) ^
+				(static_cast<quint64>(channel) << 40) ^ static_cast<quint64>(index)));
+}
+
+double Synthesizer::uniform(int channel, qint64 index, int stream) const
+{
+	return (hash(channel, index, stream) >> 11) * (1.0 / (1ULL << 53));
+}
+
+void Synthesizer::generate(qint64 first, int n, qint16* out) const
+{
+	/* Time is divided into blocks as long as a spike, and each block
+	 * contains at most one spike, starting at a random sample within it.
+	 * A sample can thus only be inside a spike from its own block or
+	 * the one before.
+	 */
+	auto spikeLength = std::max(2, static_cast<int>(synthesizer::SpikeDuration * m_sampleRate));
+	auto spikeProbability = std::min(1., m_spikeRate * spikeLength);
+	const auto NoSpike = std::numeric_limits<qint64>::min();
+	auto spikeStart = [&](int channel, qint64 block) -> qint64 {
+		if (uniform(channel, block, 1) >= spikeProbability)
+			return NoSpike;
+		return block * spikeLength + static_cast<qint64>(uniform(channel, block, 2) * spikeLength);
+	};
+
+	auto lo = static_cast<double>(std::numeric_limits<qint16>::min());
+	auto hi = static_cast<double>(std::numeric_limits<qint16>::max());
+	for (auto c = 0; c < m_nchannels; c++) {
+		auto channel = out + static_cast<qint64>(c) * n;
+		auto block = NoSpike;
+		qint64 starts[2] = { NoSpike, NoSpike };
+		for (auto i = 0; i < n; i++) {
+			auto sample = first + i;
+			auto value = m_amplitude * std::sin(m_frequencies[c] * sample);
+
+			/* Approximately Gaussian noise, from the sum of four 16-bit
+			 * uniform numbers taken from a single hash.
+			 */
+			auto bits = hash(c, sample, 3);
+			auto sum = 0.;
+			for (auto k = 0; k < 4; k++)
+				sum += ((bits >> (16 * k)) & 0xffff) / 65536.;
+			value += m_noise * (sum - 2.) * std::sqrt(3.);
+
+			/* Spikes are negative-going triangles. */
+			auto b = sample / spikeLength;
+			if (b != block) {
+				starts[0] = spikeStart(c, b - 1);
+				starts[1] = spikeStart(c, b);
+				block = b;
+			}
+			for (auto start : starts) {
+				if (start == NoSpike)
+					continue;
+				auto k = sample - start;
+				if ((k >= 0) && (k < spikeLength)) {
+					value -= synthesizer::SpikeAmplitude * m_amplitude *
+						(1. - std::abs(2. * k / spikeLength - 1.));
+				}
+			}
+			channel[i] = static_cast<qint16>(std::round(std::min(hi, std::max(lo, value))));
+		}
+	}
+}
+
+}; // end synthesizer namespace
+}; // end bldsstandin namespace
+
@@ -0,0 +1,116 @@
+/*! \file synthesizer.h
+ *
+ * Class for synthesizing deterministic array data.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#ifndef _BLDS_STANDIN_SYNTHESIZER_H_
+#define _BLDS_STANDIN_SYNTHESIZER_H_
+
+#include <QtGlobal>
+#include <QVector>
+
+namespace bldsstandin {
+
+/*! \namespace synthesizer
+ *
+ * The synthesizer namespace contains the Synthesizer class, which
+ * generates fake data for each channel of an array.
+ */
+namespace synthesizer {
+
+	/*! Default amplitude of the slow oscillation on each channel. */
+	const double DefaultAmplitude = 200.;
+
+	/*! Default standard deviation of the noise on each channel. */
+	const double DefaultNoise = 40.;
+
+	/*! Default probability of a spike starting at each sample. */
+	const double DefaultSpikeRate = 5e-4;
+
+	/*! Amplitude of spikes, relative to the oscillation. */
+	const double SpikeAmplitude = 4.;
+
+	/*! Duration of each spike, in seconds. */
+	const double SpikeDuration = 1e-3;
+
+/*! \class Synthesizer
+ *
+ * The Synthesizer class generates fake data from an array.
+ *
+ * Each channel carries a slow sinusoid at its own frequency, Gaussian
+ * noise, and occasional negative-going spikes. Every sample is a pure
+ * function of the seed, its channel and its index in the recording, so
+ * that any range of data may be generated in any order, and the same
+ * range always yields exactly the same samples.
+ */
+class Synthesizer {
+
+	public:
+		/*! Construct a Synthesizer.
+		 *
+		 * \param nchannels The number of channels.
+		 * \param sampleRate The sample rate, in Hz.
+		 * \param seed Seed from which all samples are derived.
+		 */
+		Synthesizer(int nchannels, double sampleRate, quint64 seed);
+
+		/*! Set the amplitude of the oscillation and the noise, in ADC counts. */
+		void setAmplitude(double amplitude, double noise);
+
+		/*! Set the probability of a spike starting at each sample. */
+		void setSpikeRate(double rate);
+
+		/*! Return the number of channels. */
+		inline int nchannels() const { return m_nchannels; }
+
+		/*! Return the sample rate. */
+		inline double sampleRate() const { return m_sampleRate; }
+
+		/*! Generate samples from every channel.
+		 *
+		 * \param first The index of the first sample to generate.
+		 * \param n The number of samples of each channel.
+		 * \param out Buffer for `n * nchannels()` samples. The samples
+		 * 	of each channel are contiguous.
+		 */
+		void generate(qint64 first, int n, qint16* out) const;
+
+	private:
+
+		/* Return 64 random bits, which are a pure function of the seed,
+		 * a channel, an index such as that of a sample, and a stream
+		 * distinguishing independent uses of the same index.
+		 */
+		quint64 hash(int channel, qint64 index, int stream) const;
+
+		/* Return a uniform random number in [0, 1), derived from a hash. */
+		double uniform(int channel, qint64 index, int stream) const;
+
+		/* Number of channels. */
+		int m_nchannels;
+
+		/* Sample rate. */
+		double m_sampleRate;
+
+		/* Seed for all samples. */
+		quint64 m_seed;
+
+		/* Oscillation and noise amplitudes. */
+		double m_amplitude = synthesizer::DefaultAmplitude;
+		double m_noise = synthesizer::DefaultNoise;
+
+		/* Probability of a spike starting at each sample. */
+		double m_spikeRate = synthesizer::DefaultSpikeRate;
+
+		/* Angular frequency of each channel's oscillation, per sample. */
+		QVector<double> m_frequencies;
+
+}; // end Synthesizer class
+
+}; // end synthesizer namespace
+}; // end bldsstandin namespace
+
+#endif
+
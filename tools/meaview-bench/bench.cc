@@ -0,0 +1,277 @@
+/*! \file bench.cc
+ *
+ * Headless benchmark of the meaview transfer and render pipeline.
+ *
+ * The benchmark drives a PlotWindow with synthetic frames of data, on the
+ * offscreen QPA platform unless another is requested, and reports the time
+ * spent in each stage of the pipeline, as recorded by the timers in
+ * profiler.h, and the latency from sending each frame to drawing it, as
+ * recorded in latency.h. Run with --help for the options.
+ *
+ * (C) 2017 Benjamin Naecker bnaecker@stanford.edu
+ */
+
+#include "settings.h"
+#include "plotwindow.h"
+#include "displayconfig.h"
+#include "profiler.h"
+#include "latency.h"
+#include "samplekernels.h"
+
+#include "data-frame.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cmath>
+
+using namespace meaview;
+
+/* Number of distinct synthetic frames, cycled through during the run. */
+static const int NumSyntheticFrames = 8;
+
+/* Maximum time to wait for a single replot, in milliseconds. */
+static const int ReplotTimeout = 30000;
+
+/* Create a frame of noisy sinusoids, different on every channel. */
+static DataFrame::Samples makeFrame(int nsamples, int nchannels, int index)
+{
+	DataFrame::Samples samples(nsamples, nchannels);
+	for (auto c = 0; c < nchannels; c++) {
+		auto channel = samples.colptr(c);
+		for (auto i = 0; i < nsamples; i++) {
+			auto t = static_cast<double>(index * nsamples + i);
+			auto noise = ((c * 7919 + i * 104729 + index * 1299709) % 201) - 100;
+			channel[i] = static_cast<DataFrame::DataType>(
+					200 * std::sin(t * (c + 1) * 1e-3) + noise);
+		}
+	}
+	return samples;
+}
+
+/*! \function main
+ * The main entry point for the `meaview-bench` application.
+ */
+int main(int argc, char *argv[])
+{
+	if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	QApplication app(argc, argv);
+	app.setOrganizationName("baccuslab");
+	app.setApplicationName("MeaView-bench");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmark of the meaview transfer and "
+			"render pipeline, with synthetic data.");
+	parser.addHelpOption();
+	parser.addOptions({
+			{ "array", "Type of array, \"mcs\" or \"hidens\".", "array", "mcs" },
+			{ "nchannels", "Number of channels.", "n", "64" },
+			{ "sample-rate", "Sample rate in Hz.", "rate", "10000" },
+			{ "refresh", "Refresh interval in seconds.", "seconds",
+				QString::number(plotwindow::DefaultRefreshInterval) },
+			{ "chunk", "Size of each frame of data, in milliseconds.", "ms",
+				QString::number(meaviewwindow::DataChunkRequestSize) },
+			{ "blocks", "Number of refresh intervals to time.", "n", "20" },
+			{ "frame-rate", "Target frame rate of the replots.", "fps",
+				QString::number(plotwindow::DefaultFrameRate) },
+			{ "no-tiles", "Render every subplot in the main thread." },
+			{ "sweep", "Draw each frame as it arrives." },
+			{ "no-spikes", "Do not detect spikes." },
+			{ "no-traces", "Do not draw traces, as when showing the activity map." },
+			{ "filter", "Bandpass filter the data before plotting it." },
+			{ "json", "Print the results as JSON." },
+		});
+	parser.process(app);
+
+	auto array = parser.value("array");
+	auto isHidens = array.startsWith("hidens");
+	auto nchannels = parser.value("nchannels").toInt();
+	auto sampleRate = parser.value("sample-rate").toDouble();
+	auto refresh = parser.value("refresh").toDouble();
+	auto chunk = parser.value("chunk").toDouble() / 1000.;
+	auto nblocks = parser.value("blocks").toInt();
+	auto frameRate = parser.value("frame-rate").toDouble();
+	QTextStream out(stdout);
+	if ((nchannels <= 0) || (sampleRate <= 0) || (refresh <= 0) || (chunk <= 0) ||
+			(nblocks <= 0) || (frameRate <= 0)) {
+		out << "Invalid options, see --help.\n";
+		return 1;
+	}
+
+	/* The settings read by the plots, as the MeaviewWindow would set them. */
+	QSettings settings;
+	settings.clear();
+	settings.setValue("data/array", array);
+	settings.setValue("data/nchannels", nchannels);
+	settings.setValue("data/gain", 1.0);
+	settings.setValue("data/sample-rate", sampleRate);
+	settings.setValue("display/scale", isHidens ?
+			plotwindow::HiDensDefaultDisplayRange : plotwindow::McsDefaultDisplayRange);
+	settings.setValue("display/scale-multiplier", isHidens ? 1e-6 : 1.0);
+	settings.setValue("display/refresh", refresh);
+	settings.setValue("display/view", plotwindow::DefaultChannelView);
+	settings.setValue("display/autoscale", false);
+	settings.setValue("display/sweep", parser.isSet("sweep"));
+	settings.setValue("display/tile-rendering", !parser.isSet("no-tiles"));
+	settings.setValue("display/spike-detection", !parser.isSet("no-spikes"));
+	settings.setValue("display/spike-threshold", spikedetector::DefaultThreshold);
+	settings.setValue("display/traces", !parser.isSet("no-traces"));
+	settings.setValue("display/filter", parser.isSet("filter"));
+	settings.setValue("display/filter-low", bandpass::DefaultLowCutoff);
+	settings.setValue("display/filter-high", bandpass::DefaultHighCutoff);
+	displayconfig::publish(settings);
+
+	plotwindow::PlotWindow window;
+	window.resize(meaviewwindow::WindowSize.first, meaviewwindow::WindowSize.second);
+	window.setupWindow(array, nchannels);
+	window.setBackpressurePolicy(plotwindow::BackpressurePolicy::Throttle);
+	window.setFrameRate(frameRate);
+	window.setTracesShown(!parser.isSet("no-traces"));
+	qint64 nspikes = 0;
+	QObject::connect(&window, &plotwindow::PlotWindow::spikesDetected,
+			[&](const spikedetector::SpikeList& spikes) { nspikes += spikes.size(); });
+
+	auto chunkSamples = static_cast<int>(std::round(chunk * sampleRate));
+	auto blockSamples = static_cast<int>(std::round(refresh * sampleRate));
+	auto chunksPerBlock = (blockSamples + chunkSamples - 1) / chunkSamples;
+	QList<sampleframe::SampleFrame> frames;
+	for (auto i = 0; i < NumSyntheticFrames; i++)
+		frames << sampleframe::SampleFrame(makeFrame(chunkSamples, nchannels, i));
+
+	/* Send one block of data, and wait for the grid to be replotted. */
+	auto frameIndex = 0;
+	auto runBlock = [&]() -> bool {
+		QEventLoop loop;
+		QTimer timeout;
+		timeout.setSingleShot(true);
+		QObject::connect(&timeout, &QTimer::timeout, &loop, [&]() { loop.exit(1); });
+		auto connection = QObject::connect(&window, &plotwindow::PlotWindow::plotRefreshed,
+				&loop, [&](int npoints) {
+					if (npoints >= blockSamples)
+						loop.exit(0);
+				});
+
+		/* Send frames as fast as the window accepts them, like the
+		 * application does while playing back a file.
+		 */
+		auto sent = 0;
+		auto send = [&]() {
+			while ((sent < chunksPerBlock) && !window.isThrottling()) {
+				auto frame = frames.at(frameIndex++ % frames.size());
+				frame.setReceived(latency::now());
+				window.transferDataToSubplots(frame);
+				sent += 1;
+			}
+		};
+		auto throttle = QObject::connect(&window, &plotwindow::PlotWindow::throttleChanged,
+				&loop, [&](bool throttling) {
+					if (!throttling)
+						send();
+				});
+		send();
+		timeout.start(ReplotTimeout);
+		auto result = loop.exec();
+		QObject::disconnect(connection);
+		QObject::disconnect(throttle);
+		return (result == 0);
+	};
+
+	/* The first block lays out the grid, and is not timed. */
+	if (!runBlock()) {
+		out << "Timed out waiting for the first replot.\n";
+		return 1;
+	}
+	profiler::reset();
+	latency::reset();
+	auto missedBefore = window.missedDeadlines();
+	nspikes = 0;
+	QElapsedTimer wall;
+	wall.start();
+	for (auto i = 0; i < nblocks; i++) {
+		if (!runBlock()) {
+			out << QString("Timed out waiting for replot %1.\n").arg(i + 1);
+			return 1;
+		}
+	}
+	auto elapsed = wall.nsecsElapsed() / 1e9;
+	auto missed = window.missedDeadlines() - missedBefore;
+
+	if (parser.isSet("json")) {
+		QJsonObject stages;
+		for (auto i = 0; i < static_cast<int>(profiler::Stage::NumStages); i++) {
+			auto stage = static_cast<profiler::Stage>(i);
+			auto s = profiler::stats(stage);
+			stages.insert(profiler::stageName(stage), QJsonObject{
+						{ "count", s.count },
+						{ "total-ms", s.totalNs / 1e6 },
+						{ "max-ms", s.maxNs / 1e6 },
+					});
+		}
+		QJsonObject results {
+			{ "array", array },
+			{ "nchannels", nchannels },
+			{ "sample-rate", sampleRate },
+			{ "refresh", refresh },
+			{ "chunk-ms", chunk * 1000 },
+			{ "blocks", nblocks },
+			{ "frame-rate", window.frameRate() },
+			{ "tile-rendering", !parser.isSet("no-tiles") },
+			{ "sweep", parser.isSet("sweep") },
+			{ "spike-detection", !parser.isSet("no-spikes") },
+			{ "traces", !parser.isSet("no-traces") },
+			{ "filter", parser.isSet("filter") },
+			{ "kernels", samplekernels::instructionSet() },
+			{ "wall-time", elapsed },
+			{ "real-time-factor", nblocks * refresh / elapsed },
+			{ "missed-deadlines", missed },
+			{ "spikes", nspikes },
+			{ "stages", stages },
+			{ "latency", latency::toJson() },
+		};
+		out << QJsonDocument(results).toJson();
+		return 0;
+	}
+
+	out << QString("%1 channels of %2 data at %3 Hz, %4 s refresh, %5 ms chunks, "
+			"%6 blocks%7%8%9%10%11, %12 kernels\n\n").arg(nchannels).arg(array).arg(sampleRate).arg(
+			refresh).arg(chunk * 1000).arg(nblocks).arg(
+			parser.isSet("no-tiles") ? ", no tiles" : "").arg(
+			parser.isSet("sweep") ? ", sweep" : "").arg(
+			parser.isSet("no-spikes") ? ", no spikes" : "").arg(
+			parser.isSet("no-traces") ? ", no traces" : "").arg(
+			parser.isSet("filter") ? ", filtered" : "").arg(
+			samplekernels::instructionSet());
+	out << QString("%1 %2 %3 %4 %5\n").arg("stage", -16).arg("count", 10).arg(
+			"mean (us)", 12).arg("max (us)", 12).arg("total (ms)", 12);
+	for (auto i = 0; i < static_cast<int>(profiler::Stage::NumStages); i++) {
+		auto stage = static_cast<profiler::Stage>(i);
+		auto s = profiler::stats(stage);
+		auto mean = s.count ? (s.totalNs / 1e3 / s.count) : 0.;
+		out << QString("%1 %2 %3 %4 %5\n").arg(profiler::stageName(stage), -16).arg(
+				s.count, 10).arg(mean, 12, 'f', 1).arg(s.maxNs / 1e3, 12, 'f', 1).arg(
+				s.totalNs / 1e6, 12, 'f', 2);
+	}
+	out << QString("\n%1 %2 %3 %4 %5\n").arg("latency", -16).arg("count", 10).arg(
+			"p50 (ms)", 12).arg("p99 (ms)", 12).arg("max (ms)", 12);
+	for (auto i = 0; i < static_cast<int>(latency::Segment::NumSegments); i++) {
+		auto segment = static_cast<latency::Segment>(i);
+		auto s = latency::summarize(segment);
+		out << QString("%1 %2 %3 %4 %5\n").arg(latency::segmentName(segment), -16).arg(
+				s.count, 10).arg(s.p50, 12, 'f', 2).arg(s.p99, 12, 'f', 2).arg(
+				s.max, 12, 'f', 2);
+	}
+	out << QString("\nwall time %1 s, %2 blocks/s, %3x real time, "
+			"%4 missed deadlines at %5 fps, %6 spikes\n").arg(
+			elapsed, 0, 'f', 3).arg(nblocks / elapsed, 0, 'f', 2).arg(
+			nblocks * refresh / elapsed, 0, 'f', 2).arg(missed).arg(
+			window.frameRate()).arg(nspikes);
+	return 0;
+}
+
@@ -0,0 +1,56 @@
+######################################################################
+# Headless benchmark of the meaview transfer and render pipeline.
+######################################################################
+
+TEMPLATE = app
+TARGET = meaview-bench
+OBJECTS_DIR = build
+MOC_DIR = build
+
+QT += network printsupport widgets gui
+CONFIG += c++11 console
+CONFIG -= no_pkgconfig app_bundle
+QT_CONFIG += link_pkg_config
+
+# Stage timers are always compiled into the benchmark.
+DEFINES += MEAVIEW_PROFILE
+
+# As for meaview, "qmake CONFIG+=meaview_avx2" uses AVX2 in the sample kernels.
+meaview_avx2 {
+	QMAKE_CXXFLAGS += -mavx2
+}
+
+MEAVIEW = $$PWD/../..
+
+QMAKE_RPATHDIR += $$(PWD)/../../../libblds-client/lib/ \
+	$$(PWD)/../../../libdata-source/lib/ \
+	$$(PWD)/../../../libdatafile/lib/
+
+INCLUDEPATH += . \
+	$$MEAVIEW/include \
+	$$MEAVIEW/../ \
+	$$MEAVIEW/../blds/include \
+	$$MEAVIEW/../libdata-source/include \
+	$$MEAVIEW/../libblds-client/include \
+	/usr/local/include
+
+LIBS += -L$$MEAVIEW/../libblds-client/lib \
+	-L/usr/local/lib
+
+linux {
+	LIBS += -L/usr/lib/x86_64-linux-gnu/hdf5/serial
+}
+
+win32 {
+	LIBS += -lblds-client0
+} else {
+	LIBS += -lblds-client
+}
+
+LIBS += -lhdf5_cpp -lhdf5 -larmadillo
+
+# Input, all of meaview except its entry point.
+HEADERS += $$files($$MEAVIEW/include/*.h)
+SOURCES += $$files($$MEAVIEW/src/*.cc) \
+           bench.cc
+SOURCES -= $$MEAVIEW/src/main.cc